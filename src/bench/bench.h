@@ -0,0 +1,33 @@
+// Microbenchmarks do simulador (executados via "make bench")
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <string>
+
+using namespace std;
+
+// Tempo médio em nanossegundos de uma chamada de f() ao longo de reps repetições
+template <typename Func>
+double medirNs(Func&& f, size_t reps) {
+    auto inicio = chrono::steady_clock::now();
+    for (size_t i = 0; i < reps; i++) f();
+    auto fim = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(fim - inicio).count() / reps;
+}
+
+// Cada benchmark imprime uma tabela própria em stdout
+void benchAlocacao();
+void benchDedup();
+void benchCache();
+void benchJournal();
+void benchImagem();
+void benchInodes();
+void benchDiretorio();
+void benchNomes();
+void benchEmbutidos();
+void benchCaminhos();
+void benchConcorrencia();
+void benchSessoes();
+
+#endif // BENCH_H
@@ -0,0 +1,107 @@
+// Latência de alocação de blocos em função da ocupação do disco (1M blocos)
+#include "bench.h"
+#include "../header/disco_virtual.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+const size_t NUM_BLOCOS = 1 << 20;
+const size_t TAM_BLOCO = 64;
+const size_t REPETICOES = 20000;
+// A varredura linear custa O(disco) por chamada: menos repetições
+const size_t REPETICOES_LINEAR = 200;
+
+// Alocador antigo (vector<bool> varrido bit a bit desde o bloco 0), como referência
+struct AlocadorLinear {
+    vector<bool> mapa;
+
+    explicit AlocadorLinear(size_t n) : mapa(n, false) {}
+
+    vector<int> alocar(size_t blocos) {
+        vector<int> indices;
+        for (size_t i = 0; i < mapa.size() && indices.size() < blocos; i++) {
+            if (!mapa[i]) {
+                indices.push_back((int)i);
+                mapa[i] = true;
+            }
+        }
+        return indices;
+    }
+
+    void liberar(const vector<int>& indices) {
+        for (int idx : indices) mapa[idx] = false;
+    }
+};
+
+// Ocupa a fração pedida do disco: "sequencial" enche o início do disco,
+// "aleatorio" espalha os buracos uniformemente
+vector<int> blocosOcupados(double ocupacao, bool aleatorio) {
+    vector<int> ocupados;
+    mt19937 gerador(42);
+    bernoulli_distribution sorteio(ocupacao);
+    for (size_t i = 0; i < NUM_BLOCOS; i++) {
+        bool ocupa = aleatorio ? sorteio(gerador) : i < (size_t)(ocupacao * NUM_BLOCOS);
+        if (ocupa) ocupados.push_back((int)i);
+    }
+    return ocupados;
+}
+
+void medir(double ocupacao, bool aleatorio, size_t blocosPorAlocacao) {
+    vector<int> ocupados = blocosOcupados(ocupacao, aleatorio);
+
+    // Disco novo: aloca tudo e devolve os blocos que devem ficar livres
+    VirtualDisk disco(TAM_BLOCO, NUM_BLOCOS);
+    disco.alocarBlocos(NUM_BLOCOS * TAM_BLOCO);
+    vector<bool> manter(NUM_BLOCOS, false);
+    for (int idx : ocupados) manter[idx] = true;
+    vector<Extent> livres;
+    for (size_t idx = 0; idx < NUM_BLOCOS; idx++) {
+        if (!manter[idx]) livres.push_back({(int)idx, 1});
+    }
+    disco.liberarBlocos(livres);
+
+    AlocadorLinear linear(NUM_BLOCOS);
+    for (int idx : ocupados) linear.mapa[idx] = true;
+
+    // Cada iteração aloca e devolve, mantendo a ocupação constante
+    double nsAlocador = medirNs([&] {
+        vector<Extent> v = disco.alocarBlocos(blocosPorAlocacao * TAM_BLOCO);
+        disco.liberarBlocos(v);
+    }, REPETICOES);
+    double nsLinear = medirNs([&] {
+        vector<int> v = linear.alocar(blocosPorAlocacao);
+        linear.liberar(v);
+    }, REPETICOES_LINEAR);
+
+    cout << left << setw(12) << (aleatorio ? "aleatorio" : "sequencial")
+         << setw(10) << (to_string((int)(ocupacao * 100)) + "%")
+         << setw(10) << blocosPorAlocacao
+         << setw(18) << fixed << setprecision(1) << nsAlocador
+         << setw(18) << nsLinear
+         << disco.blocosLivres() << endl;
+}
+
+} // namespace
+
+void benchAlocacao() {
+    cout << "Disco: " << NUM_BLOCOS << " blocos x " << TAM_BLOCO << " bytes, "
+         << REPETICOES << " (extents) / " << REPETICOES_LINEAR
+         << " (linear) alocacoes+liberacoes por linha\n";
+    cout << left << setw(12) << "PADRAO"
+         << setw(10) << "OCUPACAO"
+         << setw(10) << "BLOCOS"
+         << setw(18) << "EXTENTS(ns)"
+         << setw(18) << "LINEAR(ns)"
+         << "LIVRES" << endl;
+    for (bool aleatorio : {false, true}) {
+        for (double ocupacao : {0.10, 0.50, 0.95}) {
+            for (size_t blocos : {1, 16}) {
+                medir(ocupacao, aleatorio, blocos);
+            }
+        }
+    }
+}
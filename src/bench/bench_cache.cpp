@@ -0,0 +1,81 @@
+// Cache de blocos sobre imagem pread/pwrite: LRU vs ARC num trace com
+// conjunto quente relido e varreduras sequenciais periódicas
+#include "bench.h"
+#include "../header/disco_virtual.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const size_t TAM_BLOCO = 4096;
+const size_t NUM_BLOCOS = 16384;
+const size_t ORCAMENTO = 4 << 20;     // 1024 quadros
+const size_t ARQUIVOS_QUENTES = 200;  // 4 blocos cada: cabem no cache
+const size_t BLOCOS_FRIOS = 8192;     // Varredura maior que o cache
+const size_t OPERACOES = 40000;
+const size_t VARREDURA_A_CADA = 4000;
+
+void medir(const string& politica) {
+    string caminho = "/tmp/fs_bench_cache_" + to_string(getpid()) + ".img";
+    {
+        VirtualDisk disco(ArmazenamentoArquivo::abrir(caminho, TAM_BLOCO, NUM_BLOCOS));
+        disco.configurarCache(ORCAMENTO, politica);
+
+        vector<vector<Extent>> quentes;
+        string conteudo(4 * TAM_BLOCO, 'q');
+        for (size_t i = 0; i < ARQUIVOS_QUENTES; i++) {
+            quentes.push_back(disco.alocarBlocos(conteudo.size()));
+            disco.escreverDados(quentes.back(), conteudo);
+        }
+        vector<Extent> frio = disco.alocarExtents(BLOCOS_FRIOS);
+        disco.escreverDados(frio, string(BLOCOS_FRIOS * TAM_BLOCO, 'f'));
+        disco.sincronizar();
+        EstatisticasCache antes = disco.obterCache()->estatisticas();
+
+        mt19937 gerador(7);
+        uniform_int_distribution<size_t> sorteio(0, ARQUIVOS_QUENTES - 1);
+        vector<char> buffer(BLOCOS_FRIOS * TAM_BLOCO);
+        // Faltas das varreduras são inevitáveis (maiores que o cache): conta à parte
+        size_t faltasVarredura = 0;
+        auto inicio = chrono::steady_clock::now();
+        for (size_t op = 1; op <= OPERACOES; op++) {
+            if (op % VARREDURA_A_CADA == 0) {
+                size_t faltasAntes = disco.obterCache()->estatisticas().faltas;
+                disco.lerPara(frio, buffer.data(), BLOCOS_FRIOS * TAM_BLOCO);
+                faltasVarredura += disco.obterCache()->estatisticas().faltas - faltasAntes;
+            } else {
+                disco.lerPara(quentes[sorteio(gerador)], buffer.data(), 4 * TAM_BLOCO);
+            }
+        }
+        auto fim = chrono::steady_clock::now();
+
+        EstatisticasCache e = disco.obterCache()->estatisticas();
+        size_t acertos = e.acertos - antes.acertos;
+        size_t faltas = e.faltas - antes.faltas;
+        double us = chrono::duration<double, micro>(fim - inicio).count() / OPERACOES;
+        cout << left << setw(10) << politica
+             << setw(14) << fixed << setprecision(1) << 100.0 * acertos / (acertos + faltas)
+             << setw(12) << faltas
+             << setw(16) << faltas - faltasVarredura
+             << setw(12) << setprecision(2) << us << endl;
+    }
+    unlink(caminho.c_str());
+}
+
+} // namespace
+
+void benchCache() {
+    cout << "Imagem pread/pwrite " << NUM_BLOCOS << " x " << TAM_BLOCO << " bytes, cache de "
+         << (ORCAMENTO >> 20) << " MiB; " << ARQUIVOS_QUENTES << " arquivos quentes (4 blocos), varredura de "
+         << BLOCOS_FRIOS << " blocos a cada " << VARREDURA_A_CADA << " operacoes\n";
+    cout << left << setw(10) << "POLITICA"
+         << setw(14) << "ACERTOS(%)"
+         << setw(12) << "FALTAS"
+         << setw(16) << "FALTAS QUENTES"
+         << setw(12) << "us/op" << endl;
+    for (const char* politica : {"lru", "arc"}) medir(politica);
+}
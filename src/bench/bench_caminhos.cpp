@@ -0,0 +1,118 @@
+// Cache de caminhos: cat de um arquivo no fundo de uma árvore profunda pelo
+// caminho absoluto, percorrendo a árvore componente por componente ou
+// acertando o cache (como root e como usuário comum), e o custo da
+// permissão de execução de cada diretório do caminho para o usuário comum
+// com o memo de travessia valendo ou invalidado (su) a cada leitura. Por
+// fim, o prompt (caminho do diretório atual) e um cd relativo no fundo da
+// árvore, que só mexem na pilha de componentes do caminho atual.
+#include "bench.h"
+#include "../header/sistema_arquivos.h"
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+namespace {
+
+const int IRMAOS = 32;        // Entradas vizinhas em cada nível
+const size_t LEITURAS = 200000;
+
+// Descarta a saída; blocos inteiros de uma vez, para o prompt não custar um
+// overflow por caractere
+struct SaidaNula : streambuf {
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+// Cadeia nivel0/nivel1/... com IRMAOS arquivos em cada nível; devolve o
+// caminho absoluto do arquivo no fundo
+string criarCadeia(FileSystem& fs, int profundidade) {
+    string caminho;
+    for (int nivel = 0; nivel < profundidade; nivel++) {
+        caminho += "/nivel" + to_string(nivel);
+        fs.mkdir(caminho);
+        for (int i = 0; i < IRMAOS; i++) fs.touch(caminho + "/vizinho" + to_string(i));
+    }
+    caminho += "/dados.txt";
+    fs.echo(caminho, "conteudo do arquivo no fundo");
+    return caminho;
+}
+
+double medirCat(int profundidade, bool cache, int uid, bool invalidarMemo = false) {
+    FileSystem fs(4096, 1024);
+    fs.ativarCacheCaminhos(cache);
+    SaidaNula nula;
+    streambuf* original = cout.rdbuf(&nula);
+    string caminho = criarCadeia(fs, profundidade);
+    fs.trocarUsuario(uid, uid);
+    double ns = medirNs([&] {
+        if (invalidarMemo) fs.trocarUsuario(uid, uid);
+        fs.cat(caminho);
+    }, LEITURAS);
+    cout.rdbuf(original);
+    return ns;
+}
+
+// ns por prompt do fs_sim (descartado) e por cd ("cd .." + "cd nivelN") no fundo da cadeia
+pair<double, double> medirPrompt(int profundidade) {
+    FileSystem fs(4096, 1024);
+    SaidaNula nula;
+    streambuf* original = cout.rdbuf(&nula);
+    string arquivo = criarCadeia(fs, profundidade);
+    string fundo = arquivo.substr(0, arquivo.rfind('/'));
+    string ultimo = fundo.substr(fundo.rfind('/') + 1);
+    fs.cd(fundo);
+    double prompt = medirNs([&] { cout << "user@" << fs.obterCaminho() << "$ "; }, LEITURAS);
+    double cd = medirNs([&] {
+        fs.cd("..");
+        fs.cd(ultimo);
+    }, LEITURAS);
+    cout.rdbuf(original);
+    return {prompt, cd / 2};
+}
+
+} // namespace
+
+void benchCaminhos() {
+    cout << "cat pelo caminho absoluto, " << IRMAOS << " entradas por diretorio, " << LEITURAS << " leituras\n";
+    cout << left << setw(14) << "PROFUNDIDADE"
+         << setw(10) << "USUARIO"
+         << setw(14) << "sem cache ns"
+         << setw(14) << "com cache ns"
+         << "ganho" << endl;
+    for (int profundidade : {2, 8, 32, 64}) {
+        for (int uid : {0, 1000}) {
+            double sem = medirCat(profundidade, false, uid);
+            double com = medirCat(profundidade, true, uid);
+            cout << left << setw(14) << profundidade
+                 << setw(10) << (uid == 0 ? "root" : "comum")
+                 << setw(14) << fixed << setprecision(0) << sem
+                 << setw(14) << com
+                 << setprecision(2) << sem / com << "x" << endl;
+        }
+    }
+
+    // su a cada leitura também custa a própria chamada (mensagem descartada)
+    cout << "\nUsuario comum com cache de caminhos: memo de travessia valendo vs invalidado a cada leitura\n";
+    cout << left << setw(14) << "PROFUNDIDADE"
+         << setw(14) << "memo ns"
+         << "su + cat ns" << endl;
+    for (int profundidade : {8, 64}) {
+        double memo = medirCat(profundidade, true, 1000);
+        double invalidado = medirCat(profundidade, true, 1000, true);
+        cout << left << setw(14) << profundidade
+             << setw(14) << fixed << setprecision(0) << memo
+             << invalidado << endl;
+    }
+
+    cout << "\nPrompt e cd relativo no fundo da arvore (pilha de componentes do caminho atual)\n";
+    cout << left << setw(14) << "PROFUNDIDADE"
+         << setw(14) << "prompt ns"
+         << "cd ns" << endl;
+    for (int profundidade : {2, 8, 32, 64}) {
+        auto [prompt, cd] = medirPrompt(profundidade);
+        cout << left << setw(14) << profundidade
+             << setw(14) << fixed << setprecision(0) << prompt
+             << cd << endl;
+    }
+}
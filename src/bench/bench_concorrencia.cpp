@@ -0,0 +1,248 @@
+// Modo concorrente: vazão de cats de arquivos diferentes de 4 KiB com 1 a 8
+// threads (e o mesmo cat fora do modo concorrente, para o custo das travas),
+// e um teste de carga em que cada thread mistura leituras de arquivos dos
+// outros, reescritas dos seus e mudanças na árvore; no fim, nenhuma leitura
+// pode ter visto um arquivo pela metade ou falhado e o fsck não pode achar
+// problemas. A imagem roda também com o cache mínimo (4 quadros para 8
+// threads): quem não acha quadro livre espera um ser solto.
+#include "bench.h"
+#include "../header/sistema_arquivos.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const size_t TAM_ARQUIVO = 4096;
+const int ARQUIVOS = 64;
+const size_t LEITURAS = 400000;     // Total, divididas entre os threads
+const int THREADS_CARGA = 8;
+const size_t OPERACOES_CARGA = 20000; // Por thread
+const int ARQUIVOS_POR_THREAD = 4;
+const size_t BLOCOS_CARGA = 16384;    // 64 MiB
+const size_t CACHE_CARGA = 1 << 20;
+const size_t CACHE_MINIMO = 4 * 4096; // 4 quadros
+
+struct SaidaNula : streambuf {
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+// cats por segundo com o total de LEITURAS dividido entre threads; cada
+// thread lê só os seus arquivos (i % threads == t)
+double medirCats(int threads, bool concorrente) {
+    FileSystem fs(4096, 16384);
+    for (int i = 0; i < ARQUIVOS; i++) fs.echo("arq" + to_string(i), string(TAM_ARQUIVO, 'a' + i % 26));
+    if (concorrente) fs.ativarConcorrencia();
+    auto inicio = chrono::steady_clock::now();
+    vector<thread> ativos;
+    for (int t = 0; t < threads; t++) {
+        ativos.emplace_back([&, t] {
+            size_t leituras = LEITURAS / threads;
+            for (size_t i = 0; i < leituras; i++) {
+                int arquivo = t + (int)(i % (ARQUIVOS / threads)) * threads;
+                fs.cat("arq" + to_string(arquivo));
+            }
+        });
+    }
+    for (thread& ativo : ativos) ativo.join();
+    double segundos = chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+    return (LEITURAS / threads) * threads / segundos;
+}
+
+// Arquivos de conteúdo uniforme: o dono sempre troca o arquivo inteiro por
+// outro caractere (echo >, pwrite do começo ao fim) ou acrescenta o mesmo
+// (echo >>). Uma leitura com dois caracteres diferentes viu metade de uma
+// escrita.
+struct Proprio {
+    string nome;
+    char letra;
+    size_t tamanho;
+};
+
+bool uniforme(const string& conteudo) {
+    return conteudo.find_first_not_of(conteudo.empty() ? 'x' : conteudo[0]) == string::npos;
+}
+
+struct ResultadoCarga {
+    size_t operacoes = 0;
+    size_t leiturasVerificadas = 0;
+    size_t leiturasRasgadas = 0;
+    size_t leiturasFalhas = 0;
+    size_t problemasFsck = 0;
+    double segundos = 0;
+};
+
+// Os arquivos de /dados nunca são removidos: ler um deles não pode falhar
+void cargaThread(FileSystem& fs, int t, atomic<size_t>& verificadas, atomic<size_t>& rasgadas,
+                 atomic<size_t>& falhas) {
+    mt19937 gerador(100 + t);
+    vector<Proprio> proprios;
+    for (int k = 0; k < ARQUIVOS_POR_THREAD; k++) {
+        proprios.push_back({"/dados/t" + to_string(t) + "_" + to_string(k), 'a', TAM_ARQUIVO});
+    }
+    string area = "/area" + to_string(t);
+    auto alheio = [&] {
+        return "/dados/t" + to_string(gerador() % THREADS_CARGA) + "_" + to_string(gerador() % ARQUIVOS_POR_THREAD);
+    };
+
+    for (size_t op = 0; op < OPERACOES_CARGA; op++) {
+        Proprio& meu = proprios[gerador() % proprios.size()];
+        unsigned sorteio = gerador() % 100;
+        if (sorteio < 30) {
+            string conteudo;
+            if (fs.lerConteudo(alheio(), conteudo)) {
+                verificadas++;
+                if (!uniforme(conteudo)) rasgadas++;
+            } else {
+                falhas++;
+            }
+        } else if (sorteio < 40) {
+            fs.cat(alheio());
+        } else if (sorteio < 47) {
+            fs.lerEm(alheio(), gerador() % TAM_ARQUIVO, 64);
+        } else if (sorteio < 52) {
+            fs.stat(alheio());
+        } else if (sorteio < 55) {
+            fs.ls("/dados");
+        } else if (sorteio < 57) {
+            fs.executar(alheio());
+        } else if (sorteio < 67) {
+            // Tamanhos variados: blocos a mais ou a menos, e às vezes embutido
+            meu.letra = 'a' + gerador() % 26;
+            meu.tamanho = gerador() % 4 == 0 ? 1 + gerador() % 40 : 64 + gerador() % (3 * TAM_ARQUIVO);
+            fs.echo(meu.nome, string(meu.tamanho, meu.letra));
+        } else if (sorteio < 77) {
+            size_t bytes = 1 + gerador() % 512;
+            fs.echo(meu.nome, string(bytes, meu.letra), true);
+            meu.tamanho += bytes;
+        } else if (sorteio < 85) {
+            meu.letra = 'a' + gerador() % 26;
+            fs.escreverEm(meu.nome, 0, string(meu.tamanho, meu.letra));
+        } else {
+            // Mudanças na árvore, na área de cada thread
+            string item = area + "/d" + to_string(gerador() % 3);
+            switch (gerador() % 7) {
+                case 0: fs.mkdir(item); break;
+                case 1: fs.touch(item + "/vazio"); break;
+                case 2: fs.rm(item, true); break;
+                case 3: fs.mv(item, area + "/d" + to_string(gerador() % 3)); break;
+                case 4: fs.cp(alheio(), item + "/copia"); break;
+                case 5: fs.chmod(item, gerador() % 2 ? 755 : 700); break;
+                case 6: fs.echo(item + "/copia", string(100, 'z'), true); break;
+            }
+        }
+    }
+}
+
+// Disco em memória (com ou sem compressão) ou imagem pread/pwrite com cache
+// LRU (de 1 MiB ou de 4 quadros) e journal
+enum class Disco { MEMORIA, COMPRESSAO, IMAGEM, IMAGEM_CACHE_MINIMO };
+
+ResultadoCarga executarCarga(FileSystem& fs, Disco tipo) {
+    if (tipo == Disco::COMPRESSAO) fs.ativarCompressao(true);
+    if (tipo == Disco::IMAGEM || tipo == Disco::IMAGEM_CACHE_MINIMO) {
+        fs.configurarCache(tipo == Disco::IMAGEM ? CACHE_CARGA : CACHE_MINIMO, "lru");
+        fs.ativarJournal("group");
+    }
+    fs.mkdir("/dados");
+    for (int t = 0; t < THREADS_CARGA; t++) {
+        fs.mkdir("/area" + to_string(t));
+        for (int k = 0; k < ARQUIVOS_POR_THREAD; k++) {
+            fs.echo("/dados/t" + to_string(t) + "_" + to_string(k), string(TAM_ARQUIVO, 'a'));
+        }
+    }
+    fs.ativarConcorrencia();
+
+    atomic<size_t> verificadas{0}, rasgadas{0}, falhas{0};
+    auto inicio = chrono::steady_clock::now();
+    vector<thread> ativos;
+    for (int t = 0; t < THREADS_CARGA; t++) {
+        ativos.emplace_back([&, t] { cargaThread(fs, t, verificadas, rasgadas, falhas); });
+    }
+    for (thread& ativo : ativos) ativo.join();
+
+    ResultadoCarga resultado;
+    resultado.segundos = chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+    resultado.operacoes = THREADS_CARGA * OPERACOES_CARGA;
+    resultado.leiturasVerificadas = verificadas;
+    resultado.leiturasRasgadas = rasgadas;
+    resultado.leiturasFalhas = falhas;
+    resultado.problemasFsck = fs.fsck();
+    return resultado;
+}
+
+ResultadoCarga medirCarga(Disco tipo) {
+    string caminho = "/tmp/fs_bench_concorrencia_" + to_string(getpid()) + ".img";
+    ResultadoCarga resultado;
+    {
+        bool imagem = tipo == Disco::IMAGEM || tipo == Disco::IMAGEM_CACHE_MINIMO;
+        unique_ptr<FileSystem> disco = imagem
+                                           ? make_unique<FileSystem>(caminho, 4096, BLOCOS_CARGA, false)
+                                           : make_unique<FileSystem>(4096, BLOCOS_CARGA);
+        resultado = executarCarga(*disco, tipo);
+    }
+    unlink(caminho.c_str());
+    return resultado;
+}
+
+} // namespace
+
+void benchConcorrencia() {
+    unsigned nucleos = thread::hardware_concurrency();
+    cout << "cat de " << ARQUIVOS << " arquivos de " << TAM_ARQUIVO << " bytes, " << LEITURAS
+         << " leituras divididas entre os threads (" << nucleos << " nucleos nesta maquina)\n";
+    if (nucleos < 8) cout << "Com menos nucleos que threads o ganho fica limitado aos nucleos disponiveis\n";
+    cout << left << setw(10) << "THREADS"
+         << setw(14) << "modo"
+         << setw(14) << "cats/s"
+         << "ganho" << endl;
+
+    SaidaNula nula;
+    streambuf* original = cout.rdbuf(&nula);
+    double base = medirCats(1, false);
+    vector<pair<int, double>> vazoes;
+    for (int threads : {1, 2, 4, 8}) vazoes.push_back({threads, medirCats(threads, true)});
+    cout.rdbuf(original);
+
+    cout << left << setw(10) << 1
+         << setw(14) << "sequencial"
+         << setw(14) << fixed << setprecision(0) << base
+         << "-" << endl;
+    for (auto [threads, vazao] : vazoes) {
+        cout << left << setw(10) << threads
+             << setw(14) << "concorrente"
+             << setw(14) << fixed << setprecision(0) << vazao
+             << setprecision(2) << vazao / vazoes[0].second << "x" << endl;
+    }
+
+    cout << "\nCarga mista: " << THREADS_CARGA << " threads x " << OPERACOES_CARGA
+         << " comandos (leituras, reescritas dos proprios arquivos, mudancas na arvore)\n";
+    cout << left << setw(26) << "DISCO"
+         << setw(12) << "cmds/s"
+         << setw(14) << "verificadas"
+         << setw(12) << "rasgadas"
+         << setw(10) << "falhas"
+         << "fsck" << endl;
+    const pair<Disco, const char*> discos[] = {{Disco::MEMORIA, "memoria"},
+                                               {Disco::COMPRESSAO, "memoria, --compress"},
+                                               {Disco::IMAGEM, "imagem, cache e journal"},
+                                               {Disco::IMAGEM_CACHE_MINIMO, "imagem, 4 quadros"}};
+    for (auto [tipo, nome] : discos) {
+        cout.rdbuf(&nula);
+        ResultadoCarga r = medirCarga(tipo);
+        cout.rdbuf(original);
+        cout << left << setw(26) << nome
+             << setw(12) << fixed << setprecision(0) << r.operacoes / r.segundos
+             << setw(14) << r.leiturasVerificadas
+             << setw(12) << r.leiturasRasgadas
+             << setw(10) << r.leiturasFalhas
+             << r.problemasFsck << " problemas" << endl;
+    }
+}
@@ -0,0 +1,75 @@
+// Vazão de escrita (echo) com e sem deduplicação de blocos
+#include "bench.h"
+#include "../header/sistema_arquivos.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+const size_t TAM_BLOCO = 512;
+const size_t NUM_BLOCOS = 1 << 18;
+const size_t NUM_ARQUIVOS = 4000;
+const size_t TAM_ARQUIVO = 8192;
+
+// Descarta a saída dos comandos ("Gravado com sucesso.") durante a medição
+struct SaidaNula : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+// "modelos": todos os arquivos iguais; "parcial": metade dos blocos é comum
+// a todos; "unicos": nenhum bloco se repete
+vector<string> gerarConteudos(const string& padrao) {
+    mt19937_64 gerador(42);
+    auto aleatorio = [&](size_t n) {
+        string s(n, '\0');
+        for (char& c : s) c = (char)('a' + gerador() % 26);
+        return s;
+    };
+    string modelo = aleatorio(TAM_ARQUIVO);
+    vector<string> conteudos;
+    for (size_t i = 0; i < NUM_ARQUIVOS; i++) {
+        if (padrao == "modelos") conteudos.push_back(modelo);
+        else if (padrao == "parcial") conteudos.push_back(modelo.substr(0, TAM_ARQUIVO / 2) + aleatorio(TAM_ARQUIVO / 2));
+        else conteudos.push_back(aleatorio(TAM_ARQUIVO));
+    }
+    return conteudos;
+}
+
+void medir(const string& padrao, bool dedup) {
+    vector<string> conteudos = gerarConteudos(padrao);
+    FileSystem fs(TAM_BLOCO, NUM_BLOCOS);
+    fs.ativarDeduplicacao(dedup);
+
+    SaidaNula nula;
+    streambuf* original = cout.rdbuf(&nula);
+    auto inicio = chrono::steady_clock::now();
+    for (size_t i = 0; i < NUM_ARQUIVOS; i++) fs.echo("f" + to_string(i), conteudos[i]);
+    auto fim = chrono::steady_clock::now();
+    cout.rdbuf(original);
+
+    double segundos = chrono::duration<double>(fim - inicio).count();
+    double mbs = (double)(NUM_ARQUIVOS * TAM_ARQUIVO) / (1 << 20) / segundos;
+    size_t usados = fs.numBlocos() - fs.blocosLivres();
+    cout << left << setw(10) << padrao
+         << setw(8) << (dedup ? "sim" : "nao")
+         << setw(12) << fixed << setprecision(1) << mbs
+         << setw(12) << usados
+         << setprecision(2) << (double)(NUM_ARQUIVOS * TAM_ARQUIVO / TAM_BLOCO) / usados << "x" << endl;
+}
+
+} // namespace
+
+void benchDedup() {
+    cout << NUM_ARQUIVOS << " arquivos x " << TAM_ARQUIVO << " bytes, blocos de " << TAM_BLOCO << " bytes\n";
+    cout << left << setw(10) << "PADRAO"
+         << setw(8) << "DEDUP"
+         << setw(12) << "MB/s"
+         << setw(12) << "BLOCOS"
+         << "RAZAO" << endl;
+    for (const char* padrao : {"modelos", "parcial", "unicos"}) {
+        for (bool dedup : {false, true}) medir(padrao, dedup);
+    }
+}
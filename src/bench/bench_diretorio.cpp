@@ -0,0 +1,98 @@
+// Diretório muito grande: criar (touch), buscar por nome, listar (ls) e
+// remover (rm) de 100 mil a 1 milhão de entradas num único diretório
+#include "bench.h"
+#include "../header/sistema_arquivos.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <malloc.h>
+
+using namespace std;
+
+namespace {
+
+const size_t BUSCAS = 1000000;
+
+struct SaidaNula : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+// Heap em uso, incluindo blocos grandes servidos por mmap
+size_t heapUsado() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+double nsPor(chrono::steady_clock::time_point inicio, size_t operacoes) {
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - inicio).count() / operacoes;
+}
+
+void medir(size_t entradas) {
+    vector<string> nomes;
+    nomes.reserve(entradas);
+    for (size_t i = 0; i < entradas; i++) nomes.push_back("arquivo_" + to_string(i));
+    mt19937 gerador(11);
+    vector<uint32_t> sorteio(BUSCAS);
+    for (uint32_t& i : sorteio) i = gerador() % entradas;
+    vector<string> ausentes;
+    for (size_t i = 0; i < 1000; i++) ausentes.push_back("ausente_" + to_string(i));
+
+    // Blocos de 64 bytes: cada arquivo vazio ocupa um
+    FileSystem fs(64, entradas + 1024);
+    SaidaNula nula;
+    streambuf* original = cout.rdbuf(&nula);
+    fs.mkdir("grande");
+    fs.cd("grande");
+
+    size_t heapAntes = heapUsado();
+    auto inicio = chrono::steady_clock::now();
+    for (const string& nome : nomes) fs.touch(nome);
+    double criarNs = nsPor(inicio, entradas);
+    size_t heapDepois = heapUsado();
+
+    size_t achados = 0;
+    inicio = chrono::steady_clock::now();
+    for (uint32_t i : sorteio) achados += fs.procurar(nomes[i]) != INODE_NULO;
+    double buscarNs = nsPor(inicio, BUSCAS);
+    inicio = chrono::steady_clock::now();
+    for (size_t r = 0; r < BUSCAS / ausentes.size(); r++) {
+        for (const string& nome : ausentes) achados += fs.procurar(nome) != INODE_NULO;
+    }
+    double ausenteNs = nsPor(inicio, BUSCAS);
+
+    inicio = chrono::steady_clock::now();
+    fs.ls();
+    double lsMs = nsPor(inicio, 1) / 1e6;
+
+    // Remoção em ordem aleatória
+    shuffle(nomes.begin(), nomes.end(), gerador);
+    inicio = chrono::steady_clock::now();
+    for (const string& nome : nomes) fs.rm(nome);
+    double removerNs = nsPor(inicio, entradas);
+    cout.rdbuf(original);
+    if (achados != BUSCAS) cout << "Erro: busca nao achou todas as entradas\n";
+    if (fs.procurar(nomes[0]) != INODE_NULO) cout << "Erro: entrada sobreviveu ao rm\n";
+
+    cout << left << setw(12) << entradas
+         << setw(12) << fixed << setprecision(0) << criarNs
+         << setw(12) << buscarNs
+         << setw(12) << ausenteNs
+         << setw(12) << removerNs
+         << setw(12) << setprecision(1) << lsMs
+         << (double)(heapDepois - heapAntes) / entradas << endl;
+}
+
+} // namespace
+
+void benchDiretorio() {
+    cout << "Todas as entradas num diretorio; " << BUSCAS << " buscas por nome sorteado (e por nome ausente), "
+         << "rm em ordem aleatoria\n";
+    cout << left << setw(12) << "ENTRADAS"
+         << setw(12) << "touch ns"
+         << setw(12) << "busca ns"
+         << setw(12) << "ausente ns"
+         << setw(12) << "rm ns"
+         << setw(12) << "ls ms"
+         << "heap B/ent" << endl;
+    for (size_t entradas : {100000, 1000000}) medir(entradas);
+}
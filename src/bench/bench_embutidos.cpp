@@ -0,0 +1,106 @@
+// Arquivos embutidos: quantos arquivos de uma árvore típica (muitos marcadores
+// pequenos, alguns maiores) cabem no disco com e sem conteúdo no inode, e a
+// latência do pread de um arquivo pequeno numa imagem pread/pwrite com cache
+#include "bench.h"
+#include "../header/sistema_arquivos.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const size_t TAM_BLOCO = 4096;
+const size_t NUM_BLOCOS = 16384;       // 64 MiB
+const size_t MAX_ARQUIVOS = 1000000;
+const size_t ARQUIVOS_LEITURA = 20000;
+const size_t CACHE_LEITURA = 256 << 10; // 64 quadros: quase toda leitura é falta
+const size_t LEITURAS = 200000;
+
+struct SaidaNula : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+// 90% de 1 a 48 bytes (flags, marcadores), 10% de 512 bytes a 8 KiB
+size_t sortearTamanho(mt19937& gerador) {
+    if (gerador() % 10 != 0) return 1 + gerador() % 48;
+    return 512 + gerador() % (8192 - 512);
+}
+
+void medirCapacidade(size_t limite) {
+    FileSystem fs(TAM_BLOCO, NUM_BLOCOS);
+    fs.configurarEmbutidos(limite);
+    mt19937 gerador(11);
+    SaidaNula nula;
+    streambuf* original = cout.rdbuf(&nula);
+    size_t arquivos = 0, bytes = 0;
+    for (; arquivos < MAX_ARQUIVOS; arquivos++) {
+        string nome = "f" + to_string(arquivos);
+        size_t tamanho = sortearTamanho(gerador);
+        fs.echo(nome, string(tamanho, 'x'));
+        // Sem espaço: o arquivo não foi criado ou ficou sem o conteúdo
+        RefInode ref = fs.procurar(nome);
+        if (ref == INODE_NULO || fs.inode(ref).tamanho != tamanho) break;
+        bytes += tamanho;
+    }
+    cout.rdbuf(original);
+
+    size_t usados = fs.numBlocos() - fs.blocosLivres();
+    cout << left << setw(10) << (limite == 0 ? "desligado" : to_string(limite) + " B")
+         << setw(12) << arquivos
+         << setw(12) << fs.tabelaInodes().numEmbutidos()
+         << setw(12) << usados
+         << setw(16) << fixed << setprecision(1) << (double)bytes / 1024
+         << setw(14) << (double)fs.tabelaInodes().bytesEmbutidos() / 1024
+         << (arquivos == MAX_ARQUIVOS ? " (limite do bench)" : "") << endl;
+}
+
+// ns por pread de um arquivo pequeno sorteado
+double medirLeitura(size_t limite) {
+    string caminho = "/tmp/fs_bench_embutidos_" + to_string(getpid()) + ".img";
+    double ns;
+    {
+        FileSystem fs(caminho, TAM_BLOCO, NUM_BLOCOS, false);
+        fs.configurarCache(CACHE_LEITURA, "lru");
+        fs.configurarEmbutidos(limite);
+        SaidaNula nula;
+        streambuf* original = cout.rdbuf(&nula);
+        vector<string> nomes;
+        for (size_t i = 0; i < ARQUIVOS_LEITURA; i++) {
+            nomes.push_back("flag" + to_string(i));
+            fs.echo(nomes.back(), "ativo=1 desde=2026-10-16");
+        }
+        fs.sincronizar();
+        mt19937 gerador(5);
+        ns = medirNs([&] { fs.lerEm(nomes[gerador() % nomes.size()], 0, 64); }, LEITURAS);
+        cout.rdbuf(original);
+    }
+    unlink(caminho.c_str());
+    return ns;
+}
+
+} // namespace
+
+void benchEmbutidos() {
+    cout << "Disco de " << NUM_BLOCOS << " x " << TAM_BLOCO << " bytes, arquivos de 1-48 bytes (90%) e "
+         << "512 B-8 KiB (10%) ate faltar espaco\n";
+    cout << left << setw(10) << "INLINE"
+         << setw(12) << "ARQUIVOS"
+         << setw(12) << "EMBUTIDOS"
+         << setw(12) << "BLOCOS"
+         << setw(16) << "conteudo KiB"
+         << setw(14) << "no inode KiB" << endl;
+    medirCapacidade(0);
+    medirCapacidade(INLINE_DATA_BYTES);
+
+    cout << "\npread de " << ARQUIVOS_LEITURA << " arquivos de 24 bytes sorteados, imagem pread/pwrite com cache LRU de "
+         << (CACHE_LEITURA >> 10) << " KiB\n";
+    cout << left << setw(10) << "INLINE" << "ns/pread" << endl;
+    for (size_t limite : {(size_t)0, (size_t)INLINE_DATA_BYTES}) {
+        double ns = medirLeitura(limite);
+        cout << left << setw(10) << (limite == 0 ? "desligado" : to_string(limite) + " B")
+             << fixed << setprecision(0) << ns << endl;
+    }
+}
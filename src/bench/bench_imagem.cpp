@@ -0,0 +1,85 @@
+// Montagem de uma imagem compacta: árvores de 10 mil a 1 milhão de inodes
+// (1000 arquivos por diretório) gravadas com save e montadas de volta, inteiras
+// e sob demanda (--lazy: raiz mais um cd até o primeiro arquivo)
+#include "bench.h"
+#include "../header/sistema_arquivos.h"
+#include <iostream>
+#include <iomanip>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const size_t TAM_BLOCO = 64;
+const size_t ARQUIVOS_POR_DIRETORIO = 1000;
+
+struct SaidaNula : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+double milissegundos(chrono::steady_clock::time_point inicio) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - inicio).count();
+}
+
+void medir(size_t arquivos) {
+    string caminho = "/tmp/fs_bench_imagem_" + to_string(getpid()) + ".img";
+    size_t diretorios = arquivos / ARQUIVOS_POR_DIRETORIO;
+    // Arquivos vazios não ocupam blocos (ficam embutidos no inode): a montagem
+    // tem que achar o disco todo livre
+    size_t blocos = arquivos + 1024;
+    double salvarMs, montarMs, lazyMs;
+    {
+        FileSystem fs(TAM_BLOCO, blocos);
+        SaidaNula nula;
+        streambuf* original = cout.rdbuf(&nula);
+        for (size_t d = 0; d < diretorios; d++) {
+            string dir = "d" + to_string(d);
+            fs.mkdir(dir);
+            fs.cd(dir);
+            for (size_t i = 0; i < ARQUIVOS_POR_DIRETORIO; i++) fs.touch("arquivo_" + to_string(i));
+            fs.cd("..");
+        }
+        auto inicio = chrono::steady_clock::now();
+        fs.salvar(caminho);
+        salvarMs = milissegundos(inicio);
+        cout.rdbuf(original);
+    }
+    {
+        auto inicio = chrono::steady_clock::now();
+        FileSystem montado(caminho, TAM_BLOCO, blocos);
+        montarMs = milissegundos(inicio);
+        // Montagem tem que devolver a mesma ocupação
+        if (montado.blocosLivres() != blocos) cout << "Erro: ocupacao divergente apos montar\n";
+    }
+    {
+        SaidaNula nula;
+        streambuf* original = cout.rdbuf(&nula);
+        auto inicio = chrono::steady_clock::now();
+        FileSystem montado(caminho, TAM_BLOCO, blocos, true, true);
+        montado.cd("d0");
+        lazyMs = milissegundos(inicio);
+        cout.rdbuf(original);
+        if (montado.blocosLivres() != blocos) cout << "Erro: ocupacao divergente apos montar (lazy)\n";
+    }
+    size_t inodes = 1 + diretorios + arquivos;
+    cout << left << setw(12) << inodes
+         << setw(12) << fixed << setprecision(1) << salvarMs
+         << setw(12) << montarMs
+         << setw(12) << setprecision(0) << montarMs * 1e6 / inodes
+         << setprecision(2) << lazyMs << endl;
+    unlink(caminho.c_str());
+}
+
+} // namespace
+
+void benchImagem() {
+    cout << "Disco de blocos de " << TAM_BLOCO << " bytes, " << ARQUIVOS_POR_DIRETORIO
+         << " arquivos vazios por diretorio; save para imagem nova e montagem dela\n";
+    cout << left << setw(12) << "INODES"
+         << setw(12) << "SAVE ms"
+         << setw(12) << "MONTAR ms"
+         << setw(12) << "ns/inode"
+         << "LAZY+cd ms" << endl;
+    for (size_t arquivos : {10000, 100000, 1000000}) medir(arquivos);
+}
@@ -0,0 +1,92 @@
+// Tabela de inodes: memória por inode e latência de busca (por nome no
+// diretório e por inodeId) em árvores de 100 mil e 1 milhão de arquivos
+#include "bench.h"
+#include "../header/sistema_arquivos.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <malloc.h>
+
+using namespace std;
+
+namespace {
+
+const size_t ARQUIVOS_POR_DIRETORIO = 1000;
+const size_t BUSCAS = 1000000;
+
+struct SaidaNula : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+// Heap em uso, incluindo blocos grandes servidos por mmap (os slabs)
+size_t heapUsado() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+void medir(size_t arquivos) {
+    size_t diretorios = arquivos / ARQUIVOS_POR_DIRETORIO;
+    vector<string> nomes;
+    for (size_t i = 0; i < ARQUIVOS_POR_DIRETORIO; i++) nomes.push_back("arquivo_" + to_string(i));
+
+    // Blocos de 64 bytes: cada arquivo vazio ocupa um
+    FileSystem fs(64, arquivos + 1024);
+    SaidaNula nula;
+    streambuf* original = cout.rdbuf(&nula);
+    size_t heapAntes = heapUsado();
+    for (size_t d = 0; d < diretorios; d++) {
+        string dir = "d" + to_string(d);
+        fs.mkdir(dir);
+        fs.cd(dir);
+        for (const string& nome : nomes) fs.touch(nome);
+        fs.cd("..");
+    }
+    size_t heapDepois = heapUsado();
+    size_t inodes = fs.tabelaInodes().vivos();
+
+    // Busca por nome: BUSCAS nomes aleatórios, espalhados por todos os diretórios
+    mt19937 gerador(7);
+    size_t porDiretorio = BUSCAS / diretorios;
+    vector<uint32_t> sorteio(porDiretorio);
+    size_t soma = 0;
+    chrono::steady_clock::duration nome{};
+    for (size_t d = 0; d < diretorios; d++) {
+        fs.cd("/d" + to_string(d));
+        for (uint32_t& i : sorteio) i = gerador() % ARQUIVOS_POR_DIRETORIO;
+        auto inicio = chrono::steady_clock::now();
+        for (uint32_t i : sorteio) soma += fs.inode(fs.procurar(nomes[i])).tamanho;
+        nome += chrono::steady_clock::now() - inicio;
+    }
+    cout.rdbuf(original);
+
+    // Busca por inodeId (índice da tabela)
+    const TabelaInodes& tabela = fs.tabelaInodes();
+    vector<int> ids(BUSCAS);
+    for (int& id : ids) id = 1 + (int)(gerador() % inodes);
+    auto inicio = chrono::steady_clock::now();
+    for (int id : ids) {
+        RefInode r = tabela.buscarId(id);
+        if (r != INODE_NULO) soma += tabela[r].tamanho;
+    }
+    auto porId = chrono::steady_clock::now() - inicio;
+    if (soma != 0) cout << "Erro: arquivos vazios com tamanho\n";
+
+    cout << left << setw(12) << inodes
+         << setw(14) << fixed << setprecision(1) << (double)(heapDepois - heapAntes) / inodes
+         << setw(14) << (double)tabela.bytesTabela() / inodes
+         << setw(14) << chrono::duration<double, nano>(nome).count() / (porDiretorio * diretorios)
+         << chrono::duration<double, nano>(porId).count() / BUSCAS << endl;
+}
+
+} // namespace
+
+void benchInodes() {
+    cout << "sizeof(FCB) = " << sizeof(FCB) << " bytes, " << INODES_PER_SLAB << " FCBs por slab; "
+         << ARQUIVOS_POR_DIRETORIO << " arquivos vazios por diretorio\n";
+    cout << left << setw(12) << "INODES"
+         << setw(14) << "heap B/inode"
+         << setw(14) << "tabela B/ino"
+         << setw(14) << "nome ns"
+         << "inodeId ns" << endl;
+    for (size_t arquivos : {100000, 1000000}) medir(arquivos);
+}
@@ -0,0 +1,70 @@
+// Vazão de operações de metadados (mkdir, touch, chmod, mv, rm) numa imagem
+// em disco sem journal e com cada política de sincronização do journal
+#include "bench.h"
+#include "../header/sistema_arquivos.h"
+#include <iostream>
+#include <iomanip>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const size_t TAM_BLOCO = 512;
+const size_t NUM_BLOCOS = 1 << 14;
+const size_t RODADAS = 600; // 5 operações por rodada
+
+// Descarta a saída dos comandos durante a medição
+struct SaidaNula : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+void medir(const string& politica) {
+    string caminho = "/tmp/fs_bench_journal_" + to_string(getpid()) + ".img";
+    {
+        FileSystem fs(caminho, TAM_BLOCO, NUM_BLOCOS);
+        SaidaNula nula;
+        streambuf* original = cout.rdbuf(&nula);
+        if (!politica.empty()) fs.ativarJournal(politica);
+
+        auto inicio = chrono::steady_clock::now();
+        for (size_t i = 0; i < RODADAS; i++) {
+            string n = to_string(i);
+            fs.mkdir("d" + n);
+            fs.touch("f" + n);
+            fs.chmod("f" + n, 600);
+            fs.mv("f" + n, "g" + n);
+            fs.rm("d" + n);
+        }
+        fs.sincronizar(); // Tudo durável antes de parar o relógio
+        auto fim = chrono::steady_clock::now();
+        cout.rdbuf(original);
+
+        double segundos = chrono::duration<double>(fim - inicio).count();
+        size_t operacoes = RODADAS * 5;
+        cout << left << setw(10) << (politica.empty() ? "nenhum" : politica)
+             << setw(14) << fixed << setprecision(0) << operacoes / segundos
+             << setw(12) << setprecision(2) << segundos * 1e6 / operacoes;
+        if (const Journal* j = fs.obterJournal()) {
+            EstatisticasJournal e = j->estatisticas();
+            cout << setw(10) << e.grupos << e.sincronizacoes;
+        } else {
+            cout << setw(10) << "-" << "-";
+        }
+        cout << endl;
+    }
+    for (const char* sufixo : {"", ".wal", ".ckpt"}) unlink((caminho + sufixo).c_str());
+}
+
+} // namespace
+
+void benchJournal() {
+    cout << "Imagem mmap " << NUM_BLOCOS << " x " << TAM_BLOCO << " bytes; " << RODADAS * 5
+         << " operacoes de metadados (mkdir, touch, chmod, mv, rm), sync no fim\n";
+    cout << left << setw(10) << "JOURNAL"
+         << setw(14) << "OPS/S"
+         << setw(12) << "us/op"
+         << setw(10) << "GRUPOS"
+         << "FDATASYNC" << endl;
+    for (const char* politica : {"", "sync", "group", "async"}) medir(politica);
+}
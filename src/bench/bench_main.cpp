@@ -0,0 +1,48 @@
+#include "bench.h"
+#include <iostream>
+#include <map>
+#include <functional>
+
+using namespace std;
+
+// Uso: fs_bench [nome...]  (sem argumentos roda todos)
+int main(int argc, char* argv[]) {
+    map<string, function<void()>> benchmarks = {
+        {"alocacao", benchAlocacao},
+        {"dedup", benchDedup},
+        {"cache", benchCache},
+        {"journal", benchJournal},
+        {"imagem", benchImagem},
+        {"inodes", benchInodes},
+        {"diretorio", benchDiretorio},
+        {"nomes", benchNomes},
+        {"embutidos", benchEmbutidos},
+        {"caminhos", benchCaminhos},
+        {"concorrencia", benchConcorrencia},
+        {"sessoes", benchSessoes},
+    };
+
+    if (argc == 1) {
+        for (auto& [nome, bench] : benchmarks) {
+            cout << "=== " << nome << " ===\n";
+            bench();
+            cout << "\n";
+        }
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        auto it = benchmarks.find(argv[i]);
+        if (it == benchmarks.end()) {
+            cout << "Benchmark desconhecido: " << argv[i] << "\n";
+            cout << "Disponiveis:";
+            for (auto& [nome, bench] : benchmarks) cout << " " << nome;
+            cout << "\n";
+            return 1;
+        }
+        cout << "=== " << it->first << " ===\n";
+        it->second();
+        cout << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+// Arena de nomes: memória dos nomes numa árvore profunda de projeto (nomes
+// que se repetem em cada diretório) e numa árvore de nomes todos distintos,
+// comparada com a estimativa de antes (std::string no FCB e outra como chave
+// do map de filhos)
+#include "bench.h"
+#include "../header/sistema_arquivos.h"
+#include <iostream>
+#include <iomanip>
+#include <functional>
+
+using namespace std;
+
+namespace {
+
+const vector<string> SUBDIRETORIOS = {"src", "include", "tests", "docs"};
+const vector<string> ARQUIVOS = {"README.md", "Makefile", "CMakeLists.txt", "configuracao_do_modulo.json",
+                                 "implementacao_principal.cpp"};
+
+struct SaidaNula : streambuf {
+    int overflow(int c) override { return c; }
+};
+
+// Bytes de um std::string com esse texto (libstdc++: 15 caracteres cabem no
+// objeto; acima disso, um bloco do malloc com 8 bytes de cabeçalho, múltiplo de 16)
+size_t bytesString(size_t tamanho) {
+    size_t heap = tamanho <= 15 ? 0 : max<size_t>(32, (tamanho + 1 + 8 + 15) & ~(size_t)15);
+    return sizeof(string) + heap;
+}
+
+// Diretórios de profundidade até 'profundidade', cada um com os mesmos nomes
+void criarProjeto(FileSystem& fs, int profundidade) {
+    for (const string& arquivo : ARQUIVOS) fs.touch(arquivo);
+    if (profundidade == 0) return;
+    for (const string& sub : SUBDIRETORIOS) {
+        fs.mkdir(sub);
+        fs.cd(sub);
+        criarProjeto(fs, profundidade - 1);
+        fs.cd("..");
+    }
+}
+
+// Mesma forma, mas todo nome é único no sistema inteiro
+void criarUnicos(FileSystem& fs, int profundidade, size_t& contador) {
+    for (size_t i = 0; i < ARQUIVOS.size(); i++) fs.touch("arquivo_unico_" + to_string(contador++) + ".txt");
+    if (profundidade == 0) return;
+    for (size_t i = 0; i < SUBDIRETORIOS.size(); i++) {
+        string sub = "diretorio_" + to_string(contador++);
+        fs.mkdir(sub);
+        fs.cd(sub);
+        criarUnicos(fs, profundidade - 1, contador);
+        fs.cd("..");
+    }
+}
+
+void medir(const string& arvore, int profundidade, const function<void(FileSystem&)>& criar) {
+    FileSystem fs(64, 2000000);
+    SaidaNula nula;
+    streambuf* original = cout.rdbuf(&nula);
+    criar(fs);
+    cout.rdbuf(original);
+
+    const TabelaInodes& tabela = fs.tabelaInodes();
+    const ArenaNomes& nomes = tabela.arenaNomes();
+    size_t antes = 0;
+    size_t entradas = 0;
+    for (RefInode r = 0; entradas < tabela.vivos(); r++) {
+        if (!tabela.valido(r)) continue;
+        entradas++;
+        // Nome no FCB e de novo como chave no diretório pai (a raiz não tinha chave)
+        size_t tamanho = tabela.nome(r).size();
+        antes += bytesString(tamanho) * (tabela[r].pai == r ? 1 : 2);
+    }
+    // Depois: RefNome no FCB e no índice do diretório, mais a arena
+    size_t depois = entradas * 2 * sizeof(RefNome) + nomes.bytes();
+
+    cout << left << setw(10) << arvore
+         << setw(6) << profundidade
+         << setw(10) << entradas
+         << setw(11) << nomes.nomesDistintos()
+         << setw(14) << fixed << setprecision(1) << (double)nomes.bytesTextoSemInternar() / 1024
+         << setw(14) << (double)nomes.bytesTexto() / 1024
+         << setw(14) << (double)antes / entradas
+         << setw(14) << (double)depois / entradas
+         << setprecision(1) << 100.0 * (antes - (double)depois) / antes << "%" << endl;
+}
+
+} // namespace
+
+void benchNomes() {
+    cout << "Memoria dos nomes: antes = std::string no FCB + chave do map de filhos (estimativa libstdc++); "
+         << "depois = RefNome no FCB e no indice + arena\n";
+    cout << left << setw(10) << "ARVORE"
+         << setw(6) << "PROF"
+         << setw(10) << "ENTRADAS"
+         << setw(11) << "DISTINTOS"
+         << setw(14) << "texto KiB"
+         << setw(14) << "internado KiB"
+         << setw(14) << "antes B/ent"
+         << setw(14) << "depois B/ent"
+         << "economia" << endl;
+    for (int profundidade : {4, 7}) {
+        medir("projeto", profundidade, [profundidade](FileSystem& fs) { criarProjeto(fs, profundidade); });
+        medir("unicos", profundidade, [profundidade](FileSystem& fs) {
+            size_t contador = 0;
+            criarUnicos(fs, profundidade, contador);
+        });
+    }
+}
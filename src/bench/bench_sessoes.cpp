@@ -0,0 +1,184 @@
+// Sessões sobre um FileSystem compartilhado: custo de criar uma sessão, um
+// pedido (sessão nova, cd e cat) contra a mesma sessão reaproveitada,
+// memória de muitas sessões com diretórios diferentes e, no modo
+// concorrente, milhares de sessões de usuários diferentes: cada uma precisa
+// ver só o seu diretório e os seus arquivos, e o fsck não pode achar
+// problemas no fim.
+#include "bench.h"
+#include "../header/sistema_arquivos.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const int USUARIOS = 64;
+const size_t REPETICOES = 200000;
+const size_t PEDIDOS = 100000;
+const size_t SESSOES_MEMORIA = 10000;
+const int THREADS = 8;
+const int SESSOES_POR_THREAD = 1000;
+const int UID_BASE = 1000;
+
+struct SaidaNula : streambuf {
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+string casa(int usuario) { return "/home/u" + to_string(usuario); }
+
+// /home/uN/docs/arquivo de cada usuário, dono dele e fechado para os outros
+void criarCasas(FileSystem& fs, int usuarios) {
+    fs.mkdir("/home");
+    for (int u = 0; u < usuarios; u++) {
+        Sessao s(fs, UID_BASE + u, UID_BASE + u);
+        fs.mkdir(casa(u));
+        fs.chmod(casa(u), 777);
+        s.mkdir(casa(u) + "/docs");
+        s.echo(casa(u) + "/docs/arquivo", "conteudo de u" + to_string(u));
+        s.chmod(casa(u) + "/docs", 700);
+    }
+}
+
+// Pedidos por segundo: cada pedido é de um usuário (em rodízio) e faz cd e
+// cat relativo, com uma sessão nova ou com a sessão já aberta do usuário
+double medirPedidos(FileSystem& fs, bool sessaoNova) {
+    vector<Sessao> abertas;
+    abertas.reserve(USUARIOS);
+    for (int u = 0; u < USUARIOS; u++) abertas.emplace_back(fs, UID_BASE + u, UID_BASE + u);
+    size_t pedido = 0;
+    double ns = medirNs([&] {
+        int u = (int)(pedido++ % USUARIOS);
+        if (sessaoNova) {
+            Sessao s(fs, UID_BASE + u, UID_BASE + u);
+            s.cd(casa(u) + "/docs");
+            s.cat("arquivo");
+        } else {
+            abertas[u].cd(casa(u) + "/docs");
+            abertas[u].cat("arquivo");
+        }
+    }, PEDIDOS);
+    return 1e9 / ns;
+}
+
+// Bytes de uma sessão: o objeto, o caminho quando não cabe na string curta
+// e a pilha de componentes (uint32_t por componente)
+size_t bytesSessao(const Sessao& s) {
+    string_view caminho = s.obterCaminho();
+    size_t componentes = count(caminho.begin(), caminho.end(), '/');
+    return sizeof(Sessao) + (caminho.size() > 15 ? caminho.size() + 1 : 0) + componentes * sizeof(uint32_t);
+}
+
+struct ResultadoIsolamento {
+    size_t sessoes = 0;
+    size_t violacoes = 0;
+    size_t problemasFsck = 0;
+    double segundos = 0;
+};
+
+// Cada sessão é de um usuário e grupo próprios: cria a sua casa fechada,
+// entra nela, escreve e lê o seu arquivo e tenta ler o da sessão anterior do
+// mesmo thread (que precisa ser negado). Qualquer diferença no diretório,
+// na identidade ou no conteúdo conta como violação.
+void isolamentoThread(FileSystem& fs, int t, atomic<size_t>& violacoes) {
+    for (int i = 0; i < SESSOES_POR_THREAD; i++) {
+        int id = t * SESSOES_POR_THREAD + i;
+        int uid = UID_BASE + id;
+        Sessao s(fs, uid, uid);
+        string minha = casa(id);
+        string esperado = "segredo " + to_string(id);
+        s.mkdir(minha);
+        s.chmod(minha, 700);
+        s.cd(minha);
+        s.echo("arquivo", esperado);
+        s.echo("arquivo", " fim", true);
+        string lido;
+        bool ok = s.obterCaminho() == minha && s.uid() == uid && s.gid() == uid &&
+                  s.lerConteudo("arquivo", lido) && lido == esperado + " fim";
+        if (i > 0 && s.lerConteudo(casa(id - 1) + "/arquivo", lido)) ok = false;
+        if (!ok) violacoes++;
+    }
+}
+
+ResultadoIsolamento medirIsolamento() {
+    FileSystem fs(4096, 16384);
+    fs.mkdir("/home");
+    fs.chmod("/home", 777);
+    fs.ativarConcorrencia();
+
+    atomic<size_t> violacoes{0};
+    auto inicio = chrono::steady_clock::now();
+    vector<thread> ativos;
+    for (int t = 0; t < THREADS; t++) {
+        ativos.emplace_back([&, t] { isolamentoThread(fs, t, violacoes); });
+    }
+    for (thread& ativo : ativos) ativo.join();
+
+    ResultadoIsolamento resultado;
+    resultado.segundos = chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+    resultado.sessoes = (size_t)THREADS * SESSOES_POR_THREAD;
+    resultado.violacoes = violacoes;
+    resultado.problemasFsck = fs.fsck();
+    return resultado;
+}
+
+} // namespace
+
+void benchSessoes() {
+    SaidaNula nula;
+    streambuf* original = cout.rdbuf(&nula);
+    FileSystem fs(4096, 16384);
+    criarCasas(fs, USUARIOS);
+    volatile int destino = 0;
+    double nsRoot = medirNs([&] {
+        Sessao s(fs);
+        destino = s.uid();
+    }, REPETICOES);
+    double nsUsuario = medirNs([&] {
+        Sessao s(fs, UID_BASE + (int)(destino % USUARIOS), UID_BASE);
+        destino = destino + s.uid();
+    }, REPETICOES);
+    double nova = medirPedidos(fs, true);
+    double aberta = medirPedidos(fs, false);
+
+    vector<Sessao> sessoes;
+    sessoes.reserve(SESSOES_MEMORIA);
+    size_t bytes = 0;
+    for (size_t i = 0; i < SESSOES_MEMORIA; i++) {
+        int u = (int)(i % USUARIOS);
+        sessoes.emplace_back(fs, UID_BASE + u, UID_BASE + u);
+        sessoes.back().cd(casa(u) + "/docs");
+        bytes += bytesSessao(sessoes.back());
+    }
+    cout.rdbuf(original);
+
+    cout << "Criar uma sessao (" << REPETICOES << " vezes)\n";
+    cout << left << setw(24) << "USUARIO" << "ns/sessao" << endl;
+    cout << left << setw(24) << "root" << fixed << setprecision(1) << nsRoot << endl;
+    cout << left << setw(24) << "uid " + to_string(UID_BASE) + "+" << nsUsuario << endl;
+
+    cout << "\nPedidos de " << USUARIOS << " usuarios em rodizio (cd na casa e cat), " << PEDIDOS << " pedidos\n";
+    cout << left << setw(24) << "SESSAO" << "pedidos/s" << endl;
+    cout << left << setw(24) << "nova a cada pedido" << setprecision(0) << nova << endl;
+    cout << left << setw(24) << "aberta, reaproveitada" << aberta << endl;
+
+    cout << "\n" << SESSOES_MEMORIA << " sessoes abertas, cada uma em /home/uN/docs (arvore compartilhada)\n";
+    cout << "sizeof(Sessao) = " << sizeof(Sessao) << " bytes; total aprox. " << bytes / 1024 << " KiB ("
+         << bytes / SESSOES_MEMORIA << " bytes/sessao)\n";
+
+    cout << "\nIsolamento: " << THREADS << " threads x " << SESSOES_POR_THREAD
+         << " sessoes, cada uma com uid/gid e casa proprios (modo concorrente)\n";
+    cout.rdbuf(&nula);
+    ResultadoIsolamento r = medirIsolamento();
+    cout.rdbuf(original);
+    cout << left << setw(12) << "sessoes" << setw(14) << "sessoes/s" << setw(12) << "violacoes" << "fsck" << endl;
+    cout << left << setw(12) << r.sessoes
+         << setw(14) << setprecision(0) << r.sessoes / r.segundos
+         << setw(12) << r.violacoes
+         << r.problemasFsck << " problemas" << endl;
+}
@@ -0,0 +1,78 @@
+// Requisito 3.1: arena de nomes internados (um registro por nome distinto)
+#ifndef ARENA_NOMES_H
+#define ARENA_NOMES_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+using namespace std;
+
+// Referência a um nome: offset do registro na arena
+using RefNome = uint32_t;
+const RefNome NOME_NULO = UINT32_MAX;
+
+// ==========================================
+// ARENA DE NOMES
+// ==========================================
+// Cada nome distinto é guardado uma vez, num registro com prefixo de
+// tamanho: [referências u32][tamanho u32][bytes]. FCBs e índices de
+// diretório guardam só o RefNome (4 bytes), e "arquivo.txt" em mil
+// diretórios ocupa um registro com mil referências. Nomes iguais têm o
+// mesmo RefNome, então comparar nomes internados é comparar inteiros.
+// Um registro sem referências vira espaço livre, reaproveitado pelo próximo
+// nome do mesmo tamanho; a arena inteira recomeça quando esvazia.
+class ArenaNomes {
+private:
+    struct Posicao {
+        uint32_t hash;
+        RefNome nome; // NOME_NULO: posição livre
+    };
+    string dados;
+    vector<Posicao> posicoes;                // Hash do texto -> registro (sondagem linear)
+    map<uint32_t, vector<RefNome>> livres;  // Registros sem referência, por tamanho
+    size_t numNomes = 0;
+    size_t numReferencias = 0;
+    size_t bytesVivos = 0;        // Texto dos nomes distintos
+    size_t bytesReferenciados = 0; // Texto se cada referência tivesse a sua cópia
+
+    // Campo 0: referências; campo 1: tamanho do texto
+    uint32_t lerCampo(RefNome r, size_t campo) const {
+        uint32_t valor;
+        memcpy(&valor, dados.data() + r + campo * sizeof(uint32_t), sizeof(valor));
+        return valor;
+    }
+    void escreverCampo(RefNome r, size_t campo, uint32_t valor) {
+        memcpy(&dados[r + campo * sizeof(uint32_t)], &valor, sizeof(valor));
+    }
+    size_t procurarPosicao(string_view nome, uint32_t hash) const;
+    void redimensionar(size_t capacidade);
+
+public:
+    // Registro do nome (criado se preciso) com uma referência a mais.
+    // O texto pode vir da própria arena: um nome vivo nunca é copiado.
+    RefNome internar(string_view nome);
+    // Registro do nome, se algum FCB o usa (NOME_NULO se não); não conta referência
+    RefNome buscar(string_view nome) const;
+    void reter(RefNome r);
+    void soltar(RefNome r);
+    void limpar();
+
+    string_view texto(RefNome r) const {
+        return string_view(dados.data() + r + 2 * sizeof(uint32_t), lerCampo(r, 1));
+    }
+
+    // Contabilidade de memória
+    size_t nomesDistintos() const { return numNomes; }
+    size_t referencias() const { return numReferencias; }
+    size_t bytesTexto() const { return bytesVivos; }
+    size_t bytesTextoSemInternar() const { return bytesReferenciados; }
+    size_t bytesLivres() const;
+    size_t bytes() const; // Memória total (arena, tabela de internação, listas livres)
+};
+
+#endif // ARENA_NOMES_H
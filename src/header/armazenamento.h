@@ -0,0 +1,191 @@
+// Requisito 3.4: backends de armazenamento do disco virtual (memória ou imagem no host)
+#ifndef ARMAZENAMENTO_H
+#define ARMAZENAMENTO_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <climits>
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+// Valida tamanho de bloco e número de blocos antes de reservar qualquer espaço
+inline void validarGeometria(size_t tamBloco, size_t qtdBlocos) {
+    // O disco inteiro (tamBloco * qtdBlocos bytes) precisa ser endereçável:
+    // sem estourar o size_t e dentro do máximo de um vector (PTRDIFF_MAX)
+    if (tamBloco == 0 || qtdBlocos == 0 || tamBloco > (size_t)PTRDIFF_MAX / qtdBlocos) {
+        throw invalid_argument("Erro: Geometria de disco invalida.");
+    }
+    // Índices de bloco são int no FCB
+    if (qtdBlocos > (size_t)INT_MAX) {
+        throw invalid_argument("Erro: Numero de blocos excede o limite do disco virtual.");
+    }
+}
+
+// Trecho somente leitura de um arquivo mapeado com mmap (desfeito no destrutor)
+class RegiaoMapeada {
+private:
+    void* base = nullptr;
+    size_t tamanhoMapa = 0;
+    string_view conteudo;
+
+public:
+    RegiaoMapeada(int fd, size_t offset, size_t n);
+    ~RegiaoMapeada();
+    RegiaoMapeada(const RegiaoMapeada&) = delete;
+    RegiaoMapeada& operator=(const RegiaoMapeada&) = delete;
+
+    string_view dados() const { return conteudo; }
+};
+
+// ==========================================
+// ARMAZENAMENTO (BACKEND DO VIRTUALDISK)
+// ==========================================
+// Área onde vivem os blocos. Backends endereçáveis expõem dados() e o
+// VirtualDisk acessa os bytes direto; os demais (dados() == nullptr) só
+// oferecem lerBlocos/escreverBlocos e são acessados através do cache de blocos.
+// Backends persistentes também guardam o mapa de bits e a árvore de FCBs.
+class Armazenamento {
+public:
+    virtual ~Armazenamento() = default;
+
+    virtual char* dados() = 0;
+    virtual const char* dados() const = 0;
+    virtual size_t tamanhoBloco() const = 0;
+    virtual size_t numBlocos() const = 0;
+
+    // Cópia de blocos inteiros [inicio, inicio + qtd) de/para o backend
+    virtual void lerBlocos(size_t inicio, size_t qtd, char* destino) const {
+        memcpy(destino, dados() + inicio * tamanhoBloco(), qtd * tamanhoBloco());
+    }
+    virtual void escreverBlocos(size_t inicio, size_t qtd, const char* origem) {
+        memcpy(dados() + inicio * tamanhoBloco(), origem, qtd * tamanhoBloco());
+    }
+
+    // Aviso de que os blocos [inicio, inicio + qtd) serão lidos em breve (readahead)
+    virtual void aconselharLeitura(size_t, size_t) {}
+
+    // Área persistida do mapa de bits (nível 0, palavras de 64 bits); nullptr se volátil
+    // ou se o mapa não é endereçável
+    virtual uint64_t* areaMapa() { return nullptr; }
+    // Lê/grava o mapa de bits persistido; carregarMapa retorna false se não há mapa
+    virtual bool carregarMapa(uint64_t* destino, size_t palavras) {
+        if (!areaMapa()) return false;
+        memcpy(destino, areaMapa(), palavras * sizeof(uint64_t));
+        return true;
+    }
+    virtual void gravarMapa(const uint64_t* origem, size_t palavras) {
+        if (areaMapa()) memcpy(areaMapa(), origem, palavras * sizeof(uint64_t));
+    }
+    // true se o conteúdo sobrevive ao fim do processo
+    virtual bool persistente() const { return false; }
+    // true se o backend foi aberto a partir de uma imagem já existente
+    virtual bool reaberto() const { return false; }
+    // Ponto de sincronização explícito com o armazenamento do host
+    virtual void sincronizar() {}
+    // Árvore de FCBs (formato compacto) guardada junto dos blocos; nullptr se
+    // o backend não guarda metadados ou a imagem ainda não tem
+    virtual unique_ptr<RegiaoMapeada> mapearMetadados() const { return nullptr; }
+    virtual void gravarMetadados(const string&) {}
+};
+
+// Padrão: disco inteiro em um vector<char> no heap, perdido ao sair
+class ArmazenamentoMemoria : public Armazenamento {
+private:
+    size_t tb;
+    size_t n;
+    vector<char> bytes;
+
+public:
+    ArmazenamentoMemoria(size_t tamBloco, size_t qtdBlocos) : tb(tamBloco), n(qtdBlocos) {
+        validarGeometria(tb, n);
+        bytes.resize(tb * n, '\0');
+    }
+
+    char* dados() override { return bytes.data(); }
+    const char* dados() const override { return bytes.data(); }
+    size_t tamanhoBloco() const override { return tb; }
+    size_t numBlocos() const override { return n; }
+};
+
+// Base das imagens em arquivo do host. Layout:
+// [superbloco][mapa de bits][blocos de dados][metadados], seções alinhadas a 4 KiB.
+// Os metadados (árvore de FCBs no formato compacto) ficam depois dos blocos e
+// são trocados sem sobrescrever a versão anterior: o superbloco aponta para a
+// nova só depois que ela está gravada.
+class ArmazenamentoImagem : public Armazenamento {
+protected:
+    string caminho;
+    int fd = -1;
+    size_t tb = 0;
+    size_t n = 0;
+    size_t offsetMapaBits = 0;
+    size_t offsetDados = 0;
+    size_t offsetMetadados = 0;
+    size_t tamanhoMetadados = 0; // 0 = imagem sem metadados
+    bool existia = false;
+
+    ArmazenamentoImagem() = default;
+    // Abre a imagem em caminho; se não existir, cria com a geometria pedida.
+    // Uma imagem existente mantém a geometria gravada no superbloco.
+    void abrirArquivo(const string& caminhoImagem, size_t tamBloco, size_t qtdBlocos);
+
+public:
+    ~ArmazenamentoImagem() override;
+    ArmazenamentoImagem(const ArmazenamentoImagem&) = delete;
+    ArmazenamentoImagem& operator=(const ArmazenamentoImagem&) = delete;
+
+    size_t tamanhoBloco() const override { return tb; }
+    size_t numBlocos() const override { return n; }
+    bool persistente() const override { return true; }
+    bool reaberto() const override { return existia; }
+    unique_ptr<RegiaoMapeada> mapearMetadados() const override;
+    void gravarMetadados(const string& metadados) override;
+};
+
+// Imagem mapeada com mmap (MAP_SHARED): o cache de páginas do SO faz o cache
+// e o disco pode ser maior que a RAM.
+class ArmazenamentoMmap : public ArmazenamentoImagem {
+private:
+    char* mapa = nullptr;
+    size_t tamanhoMapa = 0;
+
+    ArmazenamentoMmap() = default;
+
+public:
+    ~ArmazenamentoMmap() override;
+
+    static unique_ptr<ArmazenamentoMmap> abrir(const string& caminho, size_t tamBloco, size_t qtdBlocos);
+
+    char* dados() override { return mapa + offsetDados; }
+    const char* dados() const override { return mapa + offsetDados; }
+    void aconselharLeitura(size_t inicio, size_t qtd) override;
+    uint64_t* areaMapa() override { return reinterpret_cast<uint64_t*>(mapa + offsetMapaBits); }
+    void sincronizar() override;
+};
+
+// Mesma imagem do ArmazenamentoMmap, mas acessada com pread/pwrite bloco a
+// bloco: cada acesso é uma chamada de sistema, como um disco de verdade.
+// Não é endereçável; o VirtualDisk a usa através do cache de blocos.
+class ArmazenamentoArquivo : public ArmazenamentoImagem {
+private:
+    ArmazenamentoArquivo() = default;
+
+public:
+    static unique_ptr<ArmazenamentoArquivo> abrir(const string& caminho, size_t tamBloco, size_t qtdBlocos);
+
+    char* dados() override { return nullptr; }
+    const char* dados() const override { return nullptr; }
+    void lerBlocos(size_t inicio, size_t qtd, char* destino) const override;
+    void escreverBlocos(size_t inicio, size_t qtd, const char* origem) override;
+    bool carregarMapa(uint64_t* destino, size_t palavras) override;
+    void gravarMapa(const uint64_t* origem, size_t palavras) override;
+    void sincronizar() override;
+};
+
+#endif // ARMAZENAMENTO_H
@@ -0,0 +1,138 @@
+// Requisitos 3.1/3.2: árvore de FCBs em formato compacto (imagem de disco e checkpoint)
+#ifndef ARVORE_COMPACTA_H
+#define ARVORE_COMPACTA_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "tabela_inodes.h"
+#include "armazenamento.h"
+
+using namespace std;
+
+// ==========================================
+// FORMATO COMPACTO DA ÁRVORE
+// ==========================================
+// [cabeçalho][inodes][entradas de diretório][extents][chunks][compartilhados][texto]
+// Inodes são registros de tamanho fixo (64 bytes) em ordem de largura a partir
+// da raiz (índice 0). As entradas de cada diretório (inode do filho + nome) são
+// uma faixa contígua, e todo filho vem depois do pai na tabela: a montagem cria
+// cada FCB já ligado ao pai numa única passada linear, e um diretório qualquer
+// pode ser lido sozinho (montagem sob demanda). Extents e chunks dos arquivos
+// também são faixas contíguas das suas tabelas; o conteúdo de um arquivo
+// embutido é uma faixa do texto, junto dos nomes. Junto da árvore vão o hash do
+// mapa de bits gravado no mesmo ponto e os blocos com mais de uma referência:
+// com eles a montagem sob demanda não precisa percorrer todos os extents.
+struct CabecalhoArvore {
+    char magico[8];
+    uint32_t versao;
+    uint32_t numInodes;         // Entradas de diretório = numInodes - 1 (todos menos a raiz)
+    uint64_t numExtents;
+    uint64_t numChunks;
+    uint64_t numCompartilhados;
+    uint64_t tamanhoNomes;      // Texto: nomes e conteúdo dos arquivos embutidos
+    uint64_t somaMapa;          // hashDados do mapa de bits gravado junto
+    int32_t proximoInodeId;
+    uint32_t reservado;
+    uint64_t soma;              // hashDados de tudo o que vem depois do cabeçalho
+};
+
+// InodeCompacto::flags
+const uint8_t INODE_COMPRIMIDO = 1;
+const uint8_t INODE_EMBUTIDO = 2;   // Conteúdo no texto: 'tamanho' bytes a partir de 'primeiro'
+
+struct InodeCompacto {
+    int64_t tamanho;
+    int64_t criadoEm;
+    int64_t modificadoEm;
+    int64_t acessadoEm;
+    int32_t inodeId;
+    int32_t idProprietario;
+    int32_t idGrupo;
+    uint32_t primeiro;          // Arquivo: primeiro extent (embutido: offset no texto); diretório: primeira entrada
+    uint32_t quantidade;        // Extents do arquivo (0 se embutido) ou entradas do diretório
+    uint32_t primeiroChunk;
+    uint32_t numChunks;
+    uint8_t tipo;
+    uint8_t flags;              // INODE_COMPRIMIDO, INODE_EMBUTIDO
+    uint16_t modo;              // Permissões: dono << 6 | grupo << 3 | outros
+};
+
+struct EntradaDiretorio {
+    uint32_t inode;             // Índice na tabela de inodes (sempre maior que o do pai)
+    uint32_t offsetNome;
+    uint32_t tamanhoNome;
+};
+
+// 'bruto' vai no bit mais alto do tamanho
+struct ChunkCompacto {
+    uint32_t offset;
+    uint32_t tamanho;
+};
+
+struct BlocoCompartilhado {
+    uint32_t bloco;
+    uint32_t referencias;
+};
+
+// Estado dos blocos no momento da gravação da árvore
+struct OcupacaoBlocos {
+    uint64_t somaMapa = 0;
+    vector<pair<uint32_t, uint32_t>> compartilhados; // (bloco, referências > 1)
+};
+
+// Árvore compacta já gravada (região mapeada da imagem ou checkpoint em
+// memória), lida por diretório. O construtor só confere o cabeçalho e os
+// tamanhos das tabelas; cada faixa é conferida quando é lida.
+class ImagemArvore {
+private:
+    unique_ptr<RegiaoMapeada> regiao; // Dono dos bytes, se vierem de um mmap
+    string_view dados;
+    CabecalhoArvore cab;
+    const char* tabelaInodes;
+    const char* tabelaEntradas;
+    const char* tabelaExtents;
+    const char* tabelaChunks;
+    const char* tabelaCompartilhados;
+    const char* nomes;          // Texto (nomes e conteúdo embutido)
+
+public:
+    explicit ImagemArvore(string_view dados);
+    explicit ImagemArvore(unique_ptr<RegiaoMapeada> regiao);
+
+    // Confere o checksum do corpo inteiro (lê a árvore toda)
+    bool verificarSoma() const;
+    size_t numInodes() const { return cab.numInodes; }
+    uint64_t somaMapa() const { return cab.somaMapa; }
+    vector<pair<uint32_t, uint32_t>> compartilhados() const;
+
+    InodeCompacto inode(uint32_t i) const;
+    EntradaDiretorio entrada(size_t k) const;
+    string_view nome(const EntradaDiretorio& e) const;
+    string_view conteudoEmbutido(const InodeCompacto& c) const;
+    Extent extent(size_t k) const;
+    ChunkComprimido chunk(size_t k) const;
+
+    // FCB da raiz (índice 0), com os filhos ainda por carregar; ajusta nextInodeId
+    RefInode montarRaiz(TabelaInodes& inodes) const;
+    // Cria os filhos do diretório (lido da imagem) e retorna quantos. Se a
+    // imagem estiver corrompida, nenhum filho fica criado.
+    size_t carregarFilhos(TabelaInodes& inodes, RefInode dir) const;
+    // Arquivos, bytes e blocos abaixo do inode i, sem criar FCBs (df)
+    void somarArquivos(uint32_t i, size_t& arquivos, size_t& bytes, size_t& blocos) const;
+};
+
+// Serializa a árvore abaixo de raiz. Diretórios cujos filhos ainda não foram
+// carregados são copiados de imagem. Se ordem não for nulo, recebe o FCB de
+// cada posição da tabela compacta (INODE_NULO para os copiados da imagem).
+string serializarArvore(const TabelaInodes& inodes, RefInode raiz, const OcupacaoBlocos& ocupacao,
+                        const ImagemArvore* imagem = nullptr, vector<RefInode>* ordem = nullptr);
+
+// Monta a árvore inteira em inodes (e ajusta nextInodeId); devolve a raiz.
+// Lança runtime_error se os dados estiverem corrompidos (sem deixar FCBs criados).
+RefInode montarArvore(TabelaInodes& inodes, string_view dados);
+
+#endif // ARVORE_COMPACTA_H
@@ -3,89 +3,118 @@
 #define BLOCO_CONTROLE_H
 
 #include <string>
-#include <map>
 #include <vector>
-#include <memory>
-#include <ctime>
-
-using namespace std;
-
-enum FileType { DIRECTORY, TYPE_TEXT, TYPE_NUMERIC, TYPE_BINARY, TYPE_PROGRAM };
-
-// FCB: armazena metadados e ponteiros para filhos (diretórios) e blocos (dados)
-struct FCB {
-    int inodeId;
-    string nome;
-    FileType tipo;
-    int tamanho;
-    int idProprietario;
-    int idGrupo;
-    int permProprietario;
-    int permGrupo;
-    int permOutros;
-    time_t criadoEm;
-    time_t modificadoEm;
-    time_t acessadoEm;
-    vector<int> indicesBlocos;
-    map<string, shared_ptr<FCB>> filhos;
-    weak_ptr<FCB> pai;
-
-    FCB(string n, FileType t, int uid, int gid, int oPerm, int gPerm, int pubPerm, shared_ptr<FCB> par);
-};
-
-extern int nextInodeId;
-
-#endif
-#ifndef BLOCO_CONTROLE_H
-#define BLOCO_CONTROLE_H
-
-#include <string>
-#include <map>
-#include <vector>
-#include <memory>
 #include <ctime>
+#include <cstdint>
+#include <atomic>
+#include "extent.h"
+#include "compressao.h"
+#include "indice_diretorio.h"
 
 using namespace std;
 
 // ==========================================
 // FILE TYPES (Req 3.2)
 // ==========================================
-enum FileType { DIRECTORY, TYPE_TEXT, TYPE_NUMERIC, TYPE_BINARY, TYPE_PROGRAM };
+enum FileType : uint8_t { DIRECTORY, TYPE_TEXT, TYPE_NUMERIC, TYPE_BINARY, TYPE_PROGRAM };
+
+// ==========================================
+// DATAS (Req 3.2)
+// ==========================================
+// Segundos desde EPOCA_FS em 32 bits sem sinal (até 2136); datas fora da
+// faixa são saturadas. Imagem e journal continuam gravando time_t (64 bits).
+const time_t EPOCA_FS = 946684800; // 2000-01-01 00:00:00 UTC
+
+inline uint32_t paraTempoFS(time_t t) {
+    if (t <= EPOCA_FS) return 0;
+    return (uint64_t)(t - EPOCA_FS) > UINT32_MAX ? UINT32_MAX : (uint32_t)(t - EPOCA_FS);
+}
+inline time_t deTempoFS(uint32_t t) { return EPOCA_FS + (time_t)t; }
+inline uint32_t agoraFS() { return paraTempoFS(time(nullptr)); }
 
 // ==========================================
 // 3.2: FILE CONTROL BLOCK (FCB / Inode)
 // ==========================================
+// Só o que todo inode tem (56 bytes). Tipo e permissões dividem uma palavra
+// de 16 bits, como o st_mode do Unix: tipo nos bits 12-14, dono/grupo/outros
+// nos 9 bits de baixo (o mesmo 'modo' da imagem compacta, arvore_compacta.h).
+// O que é só de arquivo (extents, chunks, readahead) ou só de diretório
+// (índice de filhos) fica nas tabelas laterais da tabela de inodes, na
+// posição 'dados' da tabela do tipo (TabelaInodes::dadosArquivo/filhos);
+// arquivos embutidos usam a tabela dos bytes (TabelaInodes::conteudoEmbutido).
 struct FCB {
     int inodeId;          // ID único (Req 3.2: simula inode)
-    string nome;
-    FileType tipo;
-    int tamanho;
+    RefNome nome;         // Na arena de nomes da tabela de inodes (TabelaInodes::nome)
+    RefInode pai = INODE_NULO; // Para 'cd ..'
+    uint32_t dados = UINT32_MAX; // Registro na tabela lateral do tipo
+    uint64_t tamanho = 0;
     int idProprietario;
     int idGrupo;          // Req 3.3: para permissões de grupo
-    
-    // Permissões no formato octal (Req 3.3: owner/group/others)
-    // Ex: 755 = rwxr-xr-x, 644 = rw-r--r--
-    int permProprietario;        // 0-7 (rwx)
-    int permGrupo;        // 0-7 (rwx)
-    int permOutros;        // 0-7 (rwx)
-    
-    time_t criadoEm;
-    time_t modificadoEm;
-    time_t acessadoEm;    // Req 3.2: data de acesso
-    
-    // Simulação de Inode: Lista de índices de blocos onde o conteúdo vive
-    vector<int> indicesBlocos; 
-
-    // Para diretórios: mantemos referências aos filhos em memória
-    // (Em um FS real, isso estaria dentro do bloco de dados, 
-    // mas para o trabalho M3, ponteiros facilitam a estrutura de árvore do Req 3.1)
-    map<string, shared_ptr<FCB>> filhos;
-    weak_ptr<FCB> pai; // Para 'cd ..'
-
-    FCB(string n, FileType t, int uid, int gid, int oPerm, int gPerm, int pubPerm, shared_ptr<FCB> par);
+
+    // Segundos desde EPOCA_FS (paraTempoFS/deTempoFS)
+    uint32_t criadoEm;
+    uint32_t modificadoEm;
+    uint32_t acessadoEm;  // Req 3.2: data de acesso
+
+    // Montagem sob demanda (--lazy): posição do inode na árvore compacta da imagem
+    uint32_t indiceImagem = UINT32_MAX;
+
+    // Tipo << 12 | dono << 6 | grupo << 3 | outros (Req 3.3: octal, ex. 755 = rwxr-xr-x)
+    uint16_t modo;
+
+    // Req 3.4: arquivo comprimido (modo --compress, tipos texto/numérico).
+    // Os extents guardam os chunks comprimidos em sequência; 'tamanho' continua
+    // sendo o tamanho lógico (descomprimido).
+    bool comprimido = false;
+    // --lazy: se os filhos do diretório já foram lidos da imagem. 'modificado'
+    // marca diretórios com mudanças que a imagem ainda não tem (não podem ser
+    // descarregados).
+    bool filhosCarregados = true;
+    bool modificado = false;
+    // Req 3.4: conteúdo pequeno (até o limite do FileSystem) guardado junto do
+    // inode, sem blocos no disco; passa para blocos quando cresce além dele
+    bool embutido = false;
+    // Tem bytes em FileSystem::escritasPendentes: leitores sem append adiado
+    // não consultam o mapa (muda só com a trava exclusiva do inode)
+    bool adiado = false;
+
+    // id > 0: inode que já existe (imagem, journal); senão um id novo
+    FCB(RefNome n, FileType t, int uid, int gid, int oPerm, int gPerm, int pubPerm, RefInode par, int id = 0);
+
+    FileType tipo() const { return (FileType)((modo >> 12) & 7); }
+    int permProprietario() const { return (modo >> 6) & 7; }
+    int permGrupo() const { return (modo >> 3) & 7; }
+    int permOutros() const { return modo & 7; }
+    void definirPermissoes(int dono, int grupo, int outros) {
+        modo = (uint16_t)((modo & 0xF000) | (dono & 7) << 6 | (grupo & 7) << 3 | (outros & 7));
+    }
+};
+
+// ==========================================
+// TABELAS LATERAIS (Req 3.1/3.4)
+// ==========================================
+// Só arquivos: simulação de Inode, faixas contíguas de blocos (início,
+// comprimento) onde o conteúdo vive, e a tabela de chunks se comprimido
+struct DadosArquivo {
+    vector<Extent> extents;
+    vector<ChunkComprimido> chunks;
+
+    // Req 3.4: readahead adaptativo (fim da última leitura e janela atual, em blocos)
+    uint64_t fimUltimaLeitura = 0;
+    uint32_t janelaLeitura = 0;
+};
+
+// Só diretórios: referências aos filhos em memória
+// (Em um FS real, isso estaria dentro do bloco de dados,
+// mas para o trabalho M3, a tabela de inodes facilita a estrutura de árvore do Req 3.1)
+// Indexados pelo nome (hash); o nome em si fica só no FCB do filho.
+// 'ultimoUso' ordena os diretórios descarregáveis (--lazy).
+struct DadosDiretorio {
+    IndiceDiretorio filhos;
+    uint64_t ultimoUso = 0;
 };
 
-// Global inode counter
-extern int nextInodeId;
+// Global inode counter (atômico: ids únicos com vários threads no modo concorrente)
+extern atomic<int> nextInodeId;
 
 #endif // BLOCO_CONTROLE_H
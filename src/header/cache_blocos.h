@@ -0,0 +1,169 @@
+// Requisito 3.4: cache de blocos (buffer cache) entre o VirtualDisk e um backend lento
+#ifndef CACHE_BLOCOS_H
+#define CACHE_BLOCOS_H
+
+#include <vector>
+#include <list>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstddef>
+#include "armazenamento.h"
+
+using namespace std;
+
+// ==========================================
+// POLÍTICAS DE SUBSTITUIÇÃO
+// ==========================================
+// A política só conhece números de bloco; o cache diz quais blocos residentes
+// podem sair (não fixados) através de 'podeSair'.
+class PoliticaSubstituicao {
+public:
+    static constexpr size_t npos = (size_t)-1;
+
+    virtual ~PoliticaSubstituicao() = default;
+    virtual string nome() const = 0;
+    // Acerto: bloco residente acessado de novo
+    virtual void acessar(size_t bloco) = 0;
+    // Cache cheio e falta de 'novo': escolhe e remove um residente (npos se todos fixados)
+    virtual size_t escolherVitima(size_t novo, const function<bool(size_t)>& podeSair) = 0;
+    // Falta atendida: 'novo' passa a ser residente
+    virtual void inserir(size_t novo) = 0;
+};
+
+// Least Recently Used: expulsa o bloco acessado há mais tempo
+class PoliticaLRU : public PoliticaSubstituicao {
+private:
+    list<size_t> ordem; // frente = mais recente
+    unordered_map<size_t, list<size_t>::iterator> posicao;
+
+public:
+    string nome() const override { return "lru"; }
+    void acessar(size_t bloco) override;
+    size_t escolherVitima(size_t novo, const function<bool(size_t)>& podeSair) override;
+    void inserir(size_t novo) override;
+};
+
+// Adaptive Replacement Cache (Megiddo & Modha): T1 = vistos uma vez,
+// T2 = vistos mais de uma vez, B1/B2 = "fantasmas" (só o número do bloco)
+// expulsos de T1/T2. Acertos em B1 aumentam o alvo p de T1, em B2 diminuem:
+// uma varredura sequencial não expulsa o conjunto quente de T2.
+class PoliticaARC : public PoliticaSubstituicao {
+private:
+    enum Lista { T1, T2, B1, B2 };
+    size_t capacidade;
+    size_t p = 0; // Tamanho alvo de T1
+    list<size_t> listas[4]; // frente = mais recente
+    unordered_map<size_t, pair<Lista, list<size_t>::iterator>> posicao;
+
+    void mover(size_t bloco, Lista destino);
+    void descartarMaisAntigo(Lista l);
+    size_t expulsarDe(Lista l, const function<bool(size_t)>& podeSair);
+
+public:
+    explicit PoliticaARC(size_t capacidadeBlocos) : capacidade(capacidadeBlocos) {}
+    string nome() const override { return "arc"; }
+    void acessar(size_t bloco) override;
+    size_t escolherVitima(size_t novo, const function<bool(size_t)>& podeSair) override;
+    void inserir(size_t novo) override;
+};
+
+// "lru" ou "arc"; lança invalid_argument para nomes desconhecidos
+unique_ptr<PoliticaSubstituicao> criarPolitica(const string& nome, size_t capacidadeBlocos);
+
+// ==========================================
+// CACHE DE BLOCOS COM WRITE-BACK
+// ==========================================
+struct EstatisticasCache {
+    size_t acertos = 0;
+    size_t faltas = 0;
+    size_t expulsoes = 0;
+    size_t gravacoes = 0;       // Blocos sujos gravados no backend (expulsão ou descarga)
+    size_t gravacoesFundo = 0;  // Dessas, quantas pelo descarregador em segundo plano
+    size_t antecipados = 0;     // Blocos trazidos por readahead
+    size_t acertosAntecipados = 0; // Desses, quantos foram usados antes de sair
+    size_t sujos = 0;
+};
+
+// Modo de acesso a um bloco: SOBRESCRITA não lê o backend (o bloco inteiro
+// será substituído)
+enum ModoAcesso { LEITURA, ESCRITA, SOBRESCRITA };
+
+// Quadros de tamanho de bloco num orçamento fixo de memória. Escritas só
+// marcam o quadro como sujo; ele é gravado no backend ao ser expulso, em
+// descarregar() ou pela thread descarregadora (periodicamente ou quando
+// metade dos quadros está suja). Um quadro fica fixado enquanto o chamador
+// usa o ponteiro e nunca é expulso nem gravado nesse intervalo.
+class CacheBlocos {
+private:
+    struct Quadro {
+        size_t bloco = PoliticaSubstituicao::npos;
+        bool sujo = false;
+        bool antecipado = false; // Trazido por readahead e ainda não acessado
+        int fixacoes = 0;
+    };
+
+    Armazenamento& backend;
+    size_t tamanhoBloco;
+    vector<char> memoria;
+    vector<Quadro> quadros;
+    vector<size_t> quadrosLivres;
+    unordered_map<size_t, size_t> quadroDoBloco;
+    unique_ptr<PoliticaSubstituicao> politica;
+    EstatisticasCache estatisticasAtuais;
+
+    mutable mutex trava;
+    condition_variable sinal;
+    condition_variable quadroSolto; // Um quadro deixou de estar fixado
+    bool parar = false;
+    chrono::milliseconds intervalo;
+    thread descarregador;
+
+    char* enderecoQuadro(size_t q) { return memoria.data() + q * tamanhoBloco; }
+    size_t obterQuadro(size_t novo);
+    size_t fixar(size_t bloco, ModoAcesso modo);
+    void soltar(size_t q);
+    void gravarQuadro(size_t q);
+    void gravarSujos(bool fundo);
+    void executarDescarregador();
+
+public:
+    // orcamentoBytes é arredondado para baixo em blocos (mínimo de 4 quadros)
+    CacheBlocos(Armazenamento& backend, size_t orcamentoBytes, const string& nomePolitica,
+                chrono::milliseconds intervaloDescarga = chrono::milliseconds(100));
+    ~CacheBlocos();
+    CacheBlocos(const CacheBlocos&) = delete;
+    CacheBlocos& operator=(const CacheBlocos&) = delete;
+
+    // Executa f(ponteiro) com o bloco residente e fixado
+    template <typename Func>
+    void comBloco(size_t bloco, ModoAcesso modo, Func&& f) {
+        size_t q = fixar(bloco, modo);
+        try {
+            f(enderecoQuadro(q));
+        } catch (...) {
+            soltar(q);
+            throw;
+        }
+        soltar(q);
+    }
+
+    // Readahead: traz os blocos não residentes de [inicio, inicio + qtd) com uma
+    // leitura contígua no backend por faixa. Limitado a 1/4 dos quadros para
+    // não expulsar o conjunto quente; para antes de esperar por quadros fixados.
+    void anteciparBlocos(size_t inicio, size_t qtd);
+
+    // Grava todos os quadros sujos no backend (ponto de sincronização)
+    void descarregar();
+
+    EstatisticasCache estatisticas() const;
+    size_t capacidadeBlocos() const { return quadros.size(); }
+    string nomePolitica() const { return politica->nome(); }
+};
+
+#endif // CACHE_BLOCOS_H
@@ -6,5 +6,6 @@
 using namespace std;
 
 void printHelp();
+void printUsage(const char* programa);
 
 #endif
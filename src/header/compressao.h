@@ -0,0 +1,34 @@
+// Requisito 3.4: compressão transparente (família LZ) do conteúdo de arquivos
+#ifndef COMPRESSAO_H
+#define COMPRESSAO_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Arquivos comprimidos são divididos em chunks lógicos deste tamanho,
+// comprimidos de forma independente: uma leitura em um offset só
+// descomprime os chunks que toca
+const size_t TAMANHO_CHUNK = 4096;
+
+// Posição de um chunk no espaço de bytes do arquivo (os chunks são gravados
+// em sequência nos extents). 'bruto' = guardado sem compressão porque o
+// codec não reduziu o tamanho. O offset é de 32 bits: um arquivo comprimido
+// guarda no máximo 4 GiB (a escrita que passaria disso é recusada).
+struct ChunkComprimido {
+    uint32_t offset;
+    uint32_t tamanho;
+    bool bruto;
+};
+
+// Codec LZ77 no formato de sequências do LZ4 (token literais/match, offset
+// de 16 bits). Retorna os bytes comprimidos de [origem, origem + n).
+string comprimirLZ(const char* origem, size_t n);
+
+// Descomprime exatamente tamanhoOriginal bytes em destino.
+// Lança runtime_error se os dados estiverem corrompidos.
+void descomprimirLZ(const char* origem, size_t n, char* destino, size_t tamanhoOriginal);
+
+#endif // COMPRESSAO_H
@@ -2,24 +2,44 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
-const int BLOCK_SIZE = 64;
-const int DISK_SIZE_BLOCKS = 100;
-
-const int PERM_READ  = 4;
-const int PERM_WRITE = 2;
-const int PERM_EXEC  = 1;
-
-#endif
-#ifndef CONSTANTS_H
-#define CONSTANTS_H
-
 // ==========================================
 // CONSTANTES E DEFINIÇÕES (Req 3.3 e 3.4)
 // ==========================================
 
-// Block size and disk configuration
+// Block size and disk configuration (padrão; ajustável via --block-size/--blocks)
 const int BLOCK_SIZE = 64;         // Tamanho pequeno para demonstrar alocação de múltiplos blocos
 const int DISK_SIZE_BLOCKS = 100;  // Disco simula 100 blocos
+const int CACHE_SIZE_BYTES = 1 << 20; // Orçamento do cache de blocos (ajustável via --cache-size)
+
+// Readahead adaptativo: janela inicial e máxima (em blocos) para leituras sequenciais
+const int READAHEAD_MIN_BLOCKS = 4;
+const int READAHEAD_MAX_BLOCKS = 256;
+// Alocação atrasada: bytes anexados acumulados antes de escolher os blocos
+const int DELAYED_WRITE_BYTES = 64 * 1024;
+
+// Arquivos embutidos: conteúdo de até tantos bytes fica no inode, sem blocos
+// (ajustável via --inline; 0 desliga)
+const int INLINE_DATA_BYTES = 60;
+
+// Journal de metadados: janela do group commit, transações que fecham um grupo
+// antes do prazo e tamanho do log que dispara um checkpoint
+const int JOURNAL_GROUP_MS = 5;
+const int JOURNAL_GROUP_OPS = 256;
+const int JOURNAL_CHECKPOINT_BYTES = 4 << 20;
+
+// Montagem sob demanda: inodes lidos da imagem acima dos quais diretórios
+// frios (sem mudanças) são descarregados
+const int LAZY_LOADED_INODES = 1 << 16;
+
+// Cache de caminhos: entradas (positivas e negativas) antes de recomeçar vazio
+const int DENTRY_CACHE_ENTRIES = 1 << 16;
+
+// Tabela de inodes: FCBs por slab (alocados de uma vez, nunca movidos)
+const int INODES_PER_SLAB = 1024;
+
+// Modo concorrente: fatias das travas de leitores distribuídas (árvore e
+// cache de caminhos); threads além disso dividem fatias
+const int READER_LOCK_SLICES = 16;
 
 // Permission masks (RWX) - Req 3.3
 const int PERM_READ  = 4;  // 100 (binary)
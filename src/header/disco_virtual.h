@@ -1,171 +1,769 @@
-// Requisito 3.4: disco virtual com alocação indexada e bitmap
+// Requisito 3.4: disco virtual com alocação por extents e bitmap
 #ifndef DISCO_VIRTUAL_H
 #define DISCO_VIRTUAL_H
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <cstring>
 #include <algorithm>
-#include <cmath>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <climits>
 #include <stdexcept>
 #include "constantes.h"
+#include "mapa_bits.h"
+#include "extent.h"
+#include "armazenamento.h"
+#include "hash.h"
+#include "cache_blocos.h"
 
 using namespace std;
 
+// ==========================================
+// 3.4: SIMULAÇÃO DE ALOCAÇÃO DE BLOCOS
+// ==========================================
 class VirtualDisk {
 private:
-    vector<char> dados;
-    vector<bool> mapaBits;
+    size_t tamanhoBloco;
+    size_t numBlocos;
+    // log2(tamanhoBloco) se o tamanho é potência de 2 (512 B, 4 KiB, 64 KiB,
+    // ...), -1 nos demais: divisão, resto e produto por tamanhoBloco viram
+    // shift e máscara no caso comum
+    int deslocamentoBloco = -1;
+    // O "Disco" é um array linear de bytes fornecido pelo backend
+    // (vector<char> em memória por padrão, ou imagem mmap)
+    unique_ptr<Armazenamento> armazenamento;
+    char* dados = nullptr;
+    // Cache de blocos: obrigatório para backends não endereçáveis (pread/pwrite),
+    // opcional para os demais. Declarado depois do backend: é destruído
+    // (e descarregado) antes dele.
+    unique_ptr<CacheBlocos> cache;
+    // Mapa de bits hierárquico para saber quais blocos estão livres (1 = ocupado)
+    MapaBits mapaBits;
+    // Contagem de referências por bloco (0 = livre). Blocos com mais de uma
+    // referência são compartilhados entre arquivos (cp) e copiados na escrita.
+    vector<uint32_t> referencias;
+    // Índice de extents livres (derivado do mapa de bits): por início, para
+    // fundir vizinhos na liberação, e por (comprimento, início), para best-fit
+    map<int, int> livresPorInicio;
+    set<pair<int, int>> livresPorTamanho;
+    // Deduplicação opcional: hash do conteúdo -> bloco canônico. O índice é
+    // validado na consulta (referência > 0 e memcmp), então entradas de blocos
+    // reescritos ou liberados não precisam ser removidas.
+    bool deduplicacao = false;
+    unordered_map<uint64_t, int> indiceHash;
+    size_t blocosDeduplicados = 0;
+    // Blocos prometidos a escritas adiadas (alocação atrasada): não podem ser
+    // usados por outras alocações, mas ainda não têm posição escolhida
+    size_t reservados = 0;
+    // Modo concorrente (FileSystem::ativarConcorrencia): alocação, reservas e
+    // contagens de referência passam por uma trava, recursiva porque as
+    // operações públicas chamam umas às outras. Os bytes dos blocos não: cada
+    // arquivo só é escrito por quem tem a trava do seu inode.
+    bool concorrente = false;
+    mutable recursive_mutex travaAlocacao;
+    unique_lock<recursive_mutex> travar() const {
+        return concorrente ? unique_lock<recursive_mutex>(travaAlocacao) : unique_lock<recursive_mutex>();
+    }
 
-public:
-    VirtualDisk() {
-        dados.resize(DISK_SIZE_BLOCKS * BLOCK_SIZE, '\0');
-        mapaBits.resize(DISK_SIZE_BLOCKS, false);
+    // Bloco que contém o byte 'endereco' e a posição do byte dentro dele
+    size_t blocoDoByte(size_t endereco) const {
+        return deslocamentoBloco >= 0 ? endereco >> deslocamentoBloco : endereco / tamanhoBloco;
+    }
+    size_t posicaoNoBloco(size_t endereco) const {
+        return deslocamentoBloco >= 0 ? endereco & (tamanhoBloco - 1) : endereco % tamanhoBloco;
+    }
+    // Bytes de 'blocos' blocos (endereço do bloco, se for um índice)
+    size_t bytesDosBlocos(size_t blocos) const {
+        return deslocamentoBloco >= 0 ? blocos << deslocamentoBloco : blocos * tamanhoBloco;
     }
 
-    vector<int> alocarBlocos(int bytesRequeridos) {
-        int blocosNecessarios = (int)ceil((double)bytesRequeridos / BLOCK_SIZE);
-        if (blocosNecessarios == 0) blocosNecessarios = 1;
+    void removerLivre(map<int, int>::iterator it) {
+        livresPorTamanho.erase({it->second, it->first});
+        livresPorInicio.erase(it);
+    }
 
-        vector<int> indices;
-        int encontrados = 0;
+    // Ocupa os primeiros 'usados' blocos do extent livre apontado por it
+    void consumirLivre(map<int, int>::iterator it, int usados) {
+        int inicio = it->first;
+        int comprimento = it->second;
+        removerLivre(it);
+        if (usados < comprimento) {
+            livresPorInicio[inicio + usados] = comprimento - usados;
+            livresPorTamanho.insert({comprimento - usados, inicio + usados});
+        }
+        for (int b = inicio; b < inicio + usados; b++) {
+            mapaBits.marcar(b); // Marca como ocupado
+            referencias[b] = 1;
+        }
+    }
 
-        for (int i = 0; i < DISK_SIZE_BLOCKS && encontrados < blocosNecessarios; i++) {
-            if (!mapaBits[i]) {
-                indices.push_back(i);
-                mapaBits[i] = true;
-                encontrados++;
+    // Devolve [inicio, inicio + comprimento) ao índice, fundindo com os vizinhos livres
+    void inserirLivre(int inicio, int comprimento) {
+        auto proximo = livresPorInicio.lower_bound(inicio);
+        if (proximo != livresPorInicio.end() && proximo->first == inicio + comprimento) {
+            comprimento += proximo->second;
+            auto apos = next(proximo);
+            removerLivre(proximo);
+            proximo = apos;
+        }
+        if (proximo != livresPorInicio.begin()) {
+            auto anterior = prev(proximo);
+            if (anterior->first + anterior->second == inicio) {
+                inicio = anterior->first;
+                comprimento += anterior->second;
+                removerLivre(anterior);
             }
         }
+        livresPorInicio[inicio] = comprimento;
+        livresPorTamanho.insert({comprimento, inicio});
+    }
 
-        if (encontrados < blocosNecessarios) {
-            for (int idx : indices) mapaBits[idx] = false;
-            throw runtime_error("Erro: Espaco insuficiente no disco virtual.");
+    // Reconstrói o índice de extents livres varrendo o mapa de bits
+    void reconstruirIndiceLivres() {
+        livresPorInicio.clear();
+        livresPorTamanho.clear();
+        size_t pos = mapaBits.proximoLivre(0);
+        while (pos != MapaBits::npos) {
+            size_t fim = pos;
+            while (fim < numBlocos && !mapaBits.testar(fim)) fim++;
+            livresPorInicio[(int)pos] = (int)(fim - pos);
+            livresPorTamanho.insert({(int)(fim - pos), (int)pos});
+            pos = fim < numBlocos ? mapaBits.proximoLivre(fim) : MapaBits::npos;
         }
-        return indices;
     }
 
-    void liberarBlocos(const vector<int>& indices) {
-        for (int idx : indices) {
-            if (idx >= 0 && idx < DISK_SIZE_BLOCKS) {
-                mapaBits[idx] = false;
-                fill(dados.begin() + (idx * BLOCK_SIZE), 
-                     dados.begin() + ((idx + 1) * BLOCK_SIZE), '\0');
+    void inicializar(unique_ptr<Armazenamento> arm) {
+        armazenamento = move(arm);
+        tamanhoBloco = armazenamento->tamanhoBloco();
+        deslocamentoBloco = (tamanhoBloco & (tamanhoBloco - 1)) == 0 ? __builtin_ctzll(tamanhoBloco) : -1;
+        numBlocos = armazenamento->numBlocos();
+        dados = armazenamento->dados();
+        if (!dados) cache = make_unique<CacheBlocos>(*armazenamento, CACHE_SIZE_BYTES, "lru");
+        mapaBits.redimensionar(numBlocos);
+        // Imagem reaberta: o mapa de bits gravado no último ponto de sincronização vale
+        if (armazenamento->reaberto()) {
+            vector<uint64_t> palavras(mapaBits.numPalavras());
+            if (armazenamento->carregarMapa(palavras.data(), palavras.size())) {
+                mapaBits.carregarPalavras(palavras.data());
             }
         }
+        referencias.assign(numBlocos, 0);
+        for (size_t b = 0; b < numBlocos; b++) {
+            if (mapaBits.testar(b)) referencias[b] = 1;
+        }
+        reconstruirIndiceLivres();
     }
 
-    void escreverDados(const vector<int>& indices, const string& conteudo) {
-        size_t posConteudo = 0;
-        for (int idx : indices) {
-            int enderecoInicio = idx * BLOCK_SIZE;
-            for (int i = 0; i < BLOCK_SIZE && posConteudo < conteudo.size(); i++) {
-                dados[enderecoInicio + i] = conteudo[posConteudo++];
+    // Bloco com o mesmo conteúdo de b já presente no disco (ou o próprio b, que
+    // passa a ser o canônico do seu hash). Os bytes após 'validos' são zerados
+    // antes do hash: além do fim do arquivo eles não fazem parte do conteúdo.
+    int blocoCanonico(int b, size_t validos) {
+        // Com cache, o candidato é comparado com uma cópia de b depois de
+        // soltá-lo: um bloco fixado de cada vez (CacheBlocos::fixar)
+        int canonico = b;
+        int candidato = -1;
+        uint64_t hash = 0;
+        vector<char> conteudo;
+        acessar((size_t)b * tamanhoBloco, tamanhoBloco, ESCRITA, [&](char* p, size_t) {
+            if (validos < tamanhoBloco) memset(p + validos, 0, tamanhoBloco - validos);
+            hash = hashDados(p, tamanhoBloco);
+            auto [it, novo] = indiceHash.try_emplace(hash, b);
+            if (novo || it->second == b) return;
+            int c = it->second;
+            if (referencias[c] == 0) {
+                it->second = b; // Entrada obsoleta: b assume o hash
+            } else if (cache) {
+                candidato = c;
+                conteudo.assign(p, p + tamanhoBloco);
+            } else if (memcmp(dados + (size_t)c * tamanhoBloco, p, tamanhoBloco) == 0) {
+                canonico = c;
+            } else {
+                it->second = b; // Colisão
             }
+        });
+        if (candidato < 0) return canonico;
+        bool igual = false;
+        acessar((size_t)candidato * tamanhoBloco, tamanhoBloco, LEITURA, [&](char* q, size_t) {
+            igual = memcmp(q, conteudo.data(), tamanhoBloco) == 0;
+        });
+        if (igual) return candidato;
+        indiceHash[hash] = b; // Colisão
+        return b;
+    }
+
+    // Acesso aos bytes [endereco, endereco + n) do disco: f(ponteiro, bytes) em
+    // pedaços contíguos. Direto no buffer do backend quando não há cache; com
+    // cache, bloco a bloco (cada bloco fica fixado durante f). SOBRESCRITA
+    // promete que f escreve todos os bytes: blocos inteiros não são lidos.
+    template <typename Func>
+    void acessar(size_t endereco, size_t n, ModoAcesso modo, Func&& f) const {
+        if (!cache) {
+            f(dados + endereco, n);
+            return;
+        }
+        while (n > 0) {
+            size_t bloco = blocoDoByte(endereco);
+            size_t desloc = posicaoNoBloco(endereco);
+            size_t bytes = min(tamanhoBloco - desloc, n);
+            ModoAcesso m = (modo == SOBRESCRITA && bytes < tamanhoBloco) ? ESCRITA : modo;
+            cache->comBloco(bloco, m, [&](char* p) { f(p + desloc, bytes); });
+            endereco += bytes;
+            n -= bytes;
+        }
+    }
+
+    void zerarBlocos(int inicio, int qtd) {
+        acessar((size_t)inicio * tamanhoBloco, (size_t)qtd * tamanhoBloco, SOBRESCRITA,
+                [](char* p, size_t bytes) { memset(p, 0, bytes); });
+    }
+
+    // Com cache, bloco a bloco por um buffer: origem e destino nunca ficam
+    // fixados juntos (CacheBlocos::fixar)
+    void copiarBlocos(int destino, int origem, int qtd) {
+        if (!cache) {
+            memcpy(dados + (size_t)destino * tamanhoBloco, dados + (size_t)origem * tamanhoBloco,
+                   (size_t)qtd * tamanhoBloco);
+            return;
+        }
+        vector<char> buffer(tamanhoBloco);
+        for (int k = 0; k < qtd; k++) {
+            acessar((size_t)(origem + k) * tamanhoBloco, tamanhoBloco, LEITURA,
+                    [&](char* de, size_t bytes) { memcpy(buffer.data(), de, bytes); });
+            acessar((size_t)(destino + k) * tamanhoBloco, tamanhoBloco, SOBRESCRITA,
+                    [&](char* p, size_t bytes) { memcpy(p, buffer.data(), bytes); });
+        }
+    }
+
+public:
+    VirtualDisk(size_t tamBloco = BLOCK_SIZE, size_t qtdBlocos = DISK_SIZE_BLOCKS) {
+        inicializar(make_unique<ArmazenamentoMemoria>(tamBloco, qtdBlocos));
+    }
+
+    // Disco sobre um backend qualquer (ex: ArmazenamentoMmap); a geometria vem dele
+    explicit VirtualDisk(unique_ptr<Armazenamento> arm) {
+        inicializar(move(arm));
+    }
+
+    ~VirtualDisk() {
+        // Mantém a imagem coerente mesmo sem 'sync' explícito
+        try {
+            if (cache) cache->descarregar();
+            armazenamento->gravarMapa(mapaBits.palavras(), mapaBits.numPalavras());
+        } catch (exception&) {
+            // Destrutor não propaga erros de I/O
         }
     }
 
-    string lerDados(const vector<int>& indices, int tamanhoBytes) {
-        string conteudo;
-        int bytesLidos = 0;
-        for (int idx : indices) {
-            int enderecoInicio = idx * BLOCK_SIZE;
-            for (int i = 0; i < BLOCK_SIZE && bytesLidos < tamanhoBytes; i++) {
-                conteudo += dados[enderecoInicio + i];
-                bytesLidos++;
+    VirtualDisk(const VirtualDisk&) = delete;
+    VirtualDisk& operator=(const VirtualDisk&) = delete;
+
+    // Ponto de sincronização: descarrega o cache, grava o mapa de bits na
+    // imagem e faz msync/fsync. No backend em memória só o cache é descarregado.
+    void sincronizar() {
+        if (cache) cache->descarregar();
+        armazenamento->gravarMapa(mapaBits.palavras(), mapaBits.numPalavras());
+        armazenamento->sincronizar();
+    }
+
+    bool persistente() const { return armazenamento->persistente(); }
+    bool reaberto() const { return armazenamento->reaberto(); }
+
+    // Grava os blocos sujos do cache no backend, sem sincronizar a imagem.
+    // Seguro em outra thread: o journal chama antes de gravar os metadados.
+    void descarregarCache() {
+        if (cache) cache->descarregar();
+    }
+
+    // Recuperação (journal): refaz as contagens de referência e o mapa de bits
+    // a partir dos extents de todos os arquivos. Blocos marcados no mapa que
+    // nenhum arquivo usa (alocados antes de uma queda) voltam a ser livres.
+    // Retorna quantos blocos foram recuperados assim.
+    size_t recalcularOcupacao(const vector<const vector<Extent>*>& arquivos) {
+        referencias.assign(numBlocos, 0);
+        for (const vector<Extent>* extents : arquivos) {
+            for (const Extent& e : *extents) {
+                if (e.inicio < 0 || e.comprimento <= 0 || (size_t)e.fim() > numBlocos) continue;
+                for (int b = e.inicio; b < e.fim(); b++) referencias[b]++;
             }
         }
-        return conteudo;
+        size_t recuperados = 0;
+        for (size_t b = 0; b < numBlocos; b++) {
+            if (mapaBits.testar(b) && referencias[b] == 0) recuperados++;
+        }
+        mapaBits.redimensionar(numBlocos);
+        for (size_t b = 0; b < numBlocos; b++) {
+            if (referencias[b] > 0) mapaBits.marcar(b);
+        }
+        reconstruirIndiceLivres();
+        indiceHash.clear();
+        return recuperados;
     }
-};
 
-#endif
-#ifndef DISCO_VIRTUAL_H
-#define DISCO_VIRTUAL_H
+    // Montagem sob demanda: a árvore gravada guarda o hash do mapa de bits e os
+    // blocos com mais de uma referência. Se o mapa reaberto tem o mesmo hash,
+    // as referências vêm dessa lista em vez de todos os extents.
+    uint64_t somaMapa() const {
+        return hashDados(reinterpret_cast<const char*>(mapaBits.palavras()), mapaBits.numPalavras() * sizeof(uint64_t));
+    }
+    vector<pair<uint32_t, uint32_t>> blocosCompartilhados() const {
+        vector<pair<uint32_t, uint32_t>> compartilhados;
+        for (size_t b = 0; b < numBlocos; b++) {
+            if (referencias[b] > 1) compartilhados.push_back({(uint32_t)b, referencias[b]});
+        }
+        return compartilhados;
+    }
+    void carregarCompartilhados(const vector<pair<uint32_t, uint32_t>>& compartilhados) {
+        for (auto& [bloco, refs] : compartilhados) {
+            if (bloco < numBlocos && mapaBits.testar(bloco)) referencias[bloco] = refs;
+        }
+    }
 
-#include <vector>
-#include <string>
-#include <algorithm>
-#include <cmath>
-#include <stdexcept>
-#include "constantes.h"
+    // Árvore de FCBs guardada na imagem (formato compacto); nullptr se não há
+    void gravarMetadados(const string& metadados) { armazenamento->gravarMetadados(metadados); }
+    unique_ptr<RegiaoMapeada> mapearMetadados() const { return armazenamento->mapearMetadados(); }
 
-using namespace std;
+    // Copia os blocos ocupados e o mapa de bits para outro backend com a mesma
+    // geometria (save para um arquivo novo). Faixas ocupadas vão em lotes de
+    // até 256 blocos; os livres não são tocados (a imagem nova é esparsa).
+    void exportar(Armazenamento& destino) const {
+        const size_t LOTE = 256;
+        vector<char> buffer(LOTE * tamanhoBloco);
+        auto copiarFaixa = [&](size_t inicio, size_t fim) {
+            for (size_t b = inicio; b < fim; b += LOTE) {
+                size_t qtd = min(LOTE, fim - b);
+                char* p = buffer.data();
+                acessar(b * tamanhoBloco, qtd * tamanhoBloco, LEITURA, [&](char* origem, size_t bytes) {
+                    memcpy(p, origem, bytes);
+                    p += bytes;
+                });
+                destino.escreverBlocos(b, qtd, buffer.data());
+            }
+        };
+        // As faixas ocupadas são os intervalos entre os extents livres
+        size_t ocupadoDesde = 0;
+        for (auto& [inicio, comprimento] : livresPorInicio) {
+            copiarFaixa(ocupadoDesde, inicio);
+            ocupadoDesde = inicio + comprimento;
+        }
+        copiarFaixa(ocupadoDesde, numBlocos);
+        destino.gravarMapa(mapaBits.palavras(), mapaBits.numPalavras());
+    }
 
-// ==========================================
-// 3.4: SIMULAÇÃO DE ALOCAÇÃO DE BLOCOS
-// ==========================================
-class VirtualDisk {
-private:
-    // O "Disco" é um array linear de bytes na memória
-    vector<char> dados;
-    // Mapa de bits para saber quais blocos estão livres (true = ocupado)
-    vector<bool> mapaBits;
+    // Passa a usar outro backend (load): o atual é sincronizado e fechado, e o
+    // cache (se havia) é recriado com o mesmo orçamento e política
+    void trocarArmazenamento(unique_ptr<Armazenamento> arm) {
+        sincronizar();
+        size_t orcamento = cache ? cache->capacidadeBlocos() * tamanhoBloco : 0;
+        string politica = cache ? cache->nomePolitica() : "";
+        cache.reset();
+        indiceHash.clear();
+        reservados = 0;
+        inicializar(move(arm));
+        if (orcamento > 0) configurarCache(orcamento, politica);
+    }
 
-public:
-    VirtualDisk() {
-        dados.resize(DISK_SIZE_BLOCKS * BLOCK_SIZE, '\0');
-        mapaBits.resize(DISK_SIZE_BLOCKS, false);
+    // Troca (ou cria) o cache de blocos: orçamento em bytes e política ("lru"/"arc").
+    // O cache anterior é descarregado antes.
+    void configurarCache(size_t orcamentoBytes, const string& politica) {
+        if (cache) cache->descarregar();
+        cache.reset();
+        cache = make_unique<CacheBlocos>(*armazenamento, orcamentoBytes, politica);
+    }
+    const CacheBlocos* obterCache() const { return cache.get(); }
+    void ativarConcorrencia() { concorrente = true; }
+    // true se os bytes do disco são endereçáveis diretamente (sem cache): lerSegmentos
+    bool acessoDireto() const { return !cache; }
+
+    size_t obterTamanhoBloco() const { return tamanhoBloco; }
+    size_t obterNumBlocos() const { return numBlocos; }
+    // Livres e não reservados
+    size_t blocosLivres() const {
+        auto trava = travar();
+        return mapaBits.contarLivres() - reservados;
+    }
+    size_t blocosReservados() const { return reservados; }
+
+    // Alocação atrasada: garante n blocos para uma escrita futura sem escolhê-los
+    void reservarBlocos(size_t n) {
+        auto trava = travar();
+        if (n > blocosLivres()) throw runtime_error("Erro: Espaco insuficiente no disco virtual.");
+        reservados += n;
+    }
+    void cancelarReserva(size_t n) {
+        auto trava = travar();
+        reservados -= min(n, reservados);
+    }
+    // Reserva até n blocos, os que estiverem livres; retorna quantos reservou
+    size_t reservarDisponiveis(size_t n) {
+        auto trava = travar();
+        size_t k = min(n, blocosLivres());
+        reservados += k;
+        return k;
+    }
+
+    size_t blocosPara(size_t bytes) const {
+        return blocoDoByte(bytes + tamanhoBloco - 1);
     }
 
-    // Retorna índice de blocos livres
-    vector<int> alocarBlocos(int bytesRequeridos) {
-        int blocosNecessarios = (int)ceil((double)bytesRequeridos / BLOCK_SIZE);
+    // Aloca blocos em faixas contíguas (extents)
+    vector<Extent> alocarBlocos(size_t bytesRequeridos) {
+        size_t blocosNecessarios = blocosPara(bytesRequeridos);
         if (blocosNecessarios == 0) blocosNecessarios = 1; // Mínimo 1 bloco
+        return alocarExtents(blocosNecessarios);
+    }
 
-        vector<int> indices;
-        int encontrados = 0;
+    // Aloca exatamente 'blocos' blocos, em tantos extents quantos forem necessários
+    vector<Extent> alocarExtents(size_t blocos) {
+        auto trava = travar();
+        // Contagem de livres é O(1): falha antes de tocar no mapa
+        if (blocos > blocosLivres()) {
+            throw runtime_error("Erro: Espaco insuficiente no disco virtual.");
+        }
 
-        // Estratégia: Alocação indexada (procura quaisquer blocos livres)
-        for (int i = 0; i < DISK_SIZE_BLOCKS && encontrados < blocosNecessarios; i++) {
-            if (!mapaBits[i]) {
-                indices.push_back(i);
-                mapaBits[i] = true; // Marca como ocupado
-                encontrados++;
-            }
+        // Estratégia: best-fit (menor extent livre que comporta o restante);
+        // se nenhum comporta, consome o maior e repete, minimizando o número de extents
+        vector<Extent> extents;
+        int falta = (int)blocos;
+        while (falta > 0) {
+            auto it = livresPorTamanho.lower_bound({falta, INT_MIN});
+            if (it == livresPorTamanho.end()) it = prev(livresPorTamanho.end());
+            int inicio = it->second;
+            int usados = min(falta, it->first);
+            consumirLivre(livresPorInicio.find(inicio), usados);
+            extents.push_back({inicio, usados});
+            falta -= usados;
         }
+        return extents;
+    }
 
-        if (encontrados < blocosNecessarios) {
-            // Rollback se não houver espaço suficiente
-            for (int idx : indices) mapaBits[idx] = false;
+    // Acrescenta 'blocos' blocos ao fim da lista de extents de um arquivo.
+    // Se os blocos logo após o último extent estiverem livres, o extent cresce
+    // no lugar; o restante vem do best-fit.
+    void estenderExtents(vector<Extent>& extents, size_t blocos) {
+        if (blocos == 0) return;
+        auto trava = travar();
+        if (blocos > blocosLivres()) {
             throw runtime_error("Erro: Espaco insuficiente no disco virtual.");
         }
-        return indices;
+        if (!extents.empty()) {
+            auto vizinho = livresPorInicio.find(extents.back().fim());
+            if (vizinho != livresPorInicio.end()) {
+                int usados = (int)min<size_t>(blocos, vizinho->second);
+                consumirLivre(vizinho, usados);
+                extents.back().comprimento += usados;
+                blocos -= usados;
+            }
+        }
+        if (blocos == 0) return;
+        for (const Extent& e : alocarExtents(blocos)) anexarExtent(extents, e);
     }
 
-    void liberarBlocos(const vector<int>& indices) {
-        for (int idx : indices) {
-            if (idx >= 0 && idx < DISK_SIZE_BLOCKS) {
-                mapaBits[idx] = false;
-                fill(dados.begin() + (idx * BLOCK_SIZE), 
-                     dados.begin() + ((idx + 1) * BLOCK_SIZE), '\0');
+    // Mantém só os primeiros 'manter' blocos da lista; devolve os extents
+    // cortados do fim (para o chamador liberar)
+    vector<Extent> cortarExtents(vector<Extent>& extents, size_t manter) {
+        vector<Extent> cauda;
+        size_t acumulado = 0;
+        size_t i = 0;
+        while (i < extents.size() && acumulado + extents[i].comprimento <= manter) {
+            acumulado += extents[i].comprimento;
+            i++;
+        }
+        if (i < extents.size() && acumulado < manter) {
+            // Extent dividido: o começo fica, o resto vai para a cauda
+            int ficam = (int)(manter - acumulado);
+            cauda.push_back({extents[i].inicio + ficam, extents[i].comprimento - ficam});
+            extents[i].comprimento = ficam;
+            i++;
+        }
+        cauda.insert(cauda.end(), extents.begin() + i, extents.end());
+        extents.resize(i);
+        return cauda;
+    }
+
+    // Solta uma referência de cada bloco; os que chegam a zero voltam a ser
+    // livres (zerados e devolvidos ao índice em faixas contíguas)
+    void liberarBlocos(const vector<Extent>& extents) {
+        auto trava = travar();
+        for (const Extent& e : extents) {
+            if (e.inicio < 0 || e.comprimento <= 0 || (size_t)e.fim() > numBlocos) continue;
+            int b = e.inicio;
+            while (b < e.fim()) {
+                if (referencias[b] > 1) {
+                    referencias[b]--; // Ainda usado por outro arquivo
+                    b++;
+                    continue;
+                }
+                int inicioFaixa = b;
+                while (b < e.fim() && referencias[b] <= 1) {
+                    referencias[b] = 0;
+                    mapaBits.desmarcar(b);
+                    b++;
+                }
+                zerarBlocos(inicioFaixa, b - inicioFaixa);
+                inserirLivre(inicioFaixa, b - inicioFaixa);
             }
         }
     }
 
-    // Escreve dados nos blocos alocados
-    void escreverDados(const vector<int>& indices, const string& conteudo) {
-        size_t posConteudo = 0;
-        for (int idx : indices) {
-            int enderecoInicio = idx * BLOCK_SIZE;
-            for (int i = 0; i < BLOCK_SIZE && posConteudo < conteudo.size(); i++) {
-                dados[enderecoInicio + i] = conteudo[posConteudo++];
+    // Cópia de metadados (cp): os blocos passam a ter mais uma referência
+    void compartilharBlocos(const vector<Extent>& extents) {
+        auto trava = travar();
+        for (const Extent& e : extents) {
+            for (int b = e.inicio; b < e.fim(); b++) referencias[b]++;
+        }
+    }
+
+    uint32_t contarReferencias(int bloco) const { return referencias[bloco]; }
+    bool blocoOcupado(size_t bloco) const { return mapaBits.testar(bloco); }
+
+    // Quantos blocos compartilhados cobrem os bytes [offset, offset + n) do arquivo
+    size_t contarCompartilhados(const vector<Extent>& extents, size_t offset, size_t n) const {
+        if (n == 0) return 0;
+        auto trava = travar();
+        size_t primeiro = blocoDoByte(offset);
+        size_t ultimo = blocoDoByte(offset + n - 1);
+        size_t total = 0;
+        size_t logico = 0;
+        for (const Extent& e : extents) {
+            size_t fimLogico = logico + e.comprimento;
+            if (logico > ultimo) break;
+            // Extents fora da faixa são pulados inteiros
+            if (fimLogico > primeiro) {
+                size_t de = max(logico, primeiro);
+                size_t ate = min(fimLogico - 1, ultimo);
+                for (size_t lb = de; lb <= ate; lb++) {
+                    if (referencias[e.inicio + (lb - logico)] > 1) total++;
+                }
             }
+            logico = fimLogico;
         }
+        return total;
     }
 
-    // Lê dados dos blocos
-    string lerDados(const vector<int>& indices, int tamanhoBytes) {
-        string conteudo;
-        int bytesLidos = 0;
-        for (int idx : indices) {
-            int enderecoInicio = idx * BLOCK_SIZE;
-            for (int i = 0; i < BLOCK_SIZE && bytesLidos < tamanhoBytes; i++) {
-                conteudo += dados[enderecoInicio + i];
-                bytesLidos++;
+    // Copy-on-write: antes de escrever nos bytes [offset, offset + n), troca
+    // os blocos compartilhados da faixa por cópias exclusivas do arquivo
+    void separarCompartilhados(vector<Extent>& extents, size_t offset, size_t n) {
+        auto trava = travar();
+        size_t necessarios = contarCompartilhados(extents, offset, n);
+        if (necessarios == 0) return;
+        if (necessarios > blocosLivres()) {
+            throw runtime_error("Erro: Espaco insuficiente no disco virtual.");
+        }
+        size_t primeiro = blocoDoByte(offset);
+        size_t ultimo = blocoDoByte(offset + n - 1);
+
+        vector<Extent> resultado;
+        size_t logico = 0;
+        for (const Extent& e : extents) {
+            if (logico + e.comprimento <= primeiro || logico > ultimo) {
+                anexarExtent(resultado, e);
+                logico += e.comprimento;
+                continue;
+            }
+            auto copiar = [&](int b) {
+                size_t lb = logico + (b - e.inicio);
+                return lb >= primeiro && lb <= ultimo && referencias[b] > 1;
+            };
+            int b = e.inicio;
+            while (b < e.fim()) {
+                // Faixa de blocos com a mesma situação (copiar ou manter)
+                bool copia = copiar(b);
+                int inicioFaixa = b;
+                while (b < e.fim() && copiar(b) == copia) b++;
+                int comprimento = b - inicioFaixa;
+                if (!copia) {
+                    anexarExtent(resultado, {inicioFaixa, comprimento});
+                    continue;
+                }
+                int origem = inicioFaixa;
+                for (const Extent& novo : alocarExtents(comprimento)) {
+                    copiarBlocos(novo.inicio, origem, novo.comprimento);
+                    origem += novo.comprimento;
+                    anexarExtent(resultado, novo);
+                }
+                for (int k = inicioFaixa; k < b; k++) referencias[k]--;
             }
+            logico += e.comprimento;
         }
+        extents = move(resultado);
+    }
+
+    void ativarDeduplicacao(bool ativa) {
+        deduplicacao = ativa;
+        if (!ativa) indiceHash.clear();
+    }
+    bool deduplicacaoAtiva() const { return deduplicacao; }
+    // Blocos economizados pela deduplicação desde o início (inclui os já liberados)
+    size_t contarDeduplicados() const { return blocosDeduplicados; }
+
+    // Memória das estruturas do disco (mapa de bits, referências, índice de
+    // livres e de deduplicação), sem os blocos e o cache. Nós de map/set
+    // contados como 32 bytes de ligações + valor, nós do hash como próximo + valor.
+    size_t bytesMetadados() const {
+        const size_t noArvore = 32;
+        return mapaBits.bytes() + referencias.capacity() * sizeof(uint32_t) +
+               livresPorInicio.size() * (noArvore + sizeof(pair<const int, int>)) +
+               livresPorTamanho.size() * (noArvore + sizeof(pair<int, int>)) +
+               indiceHash.size() * (sizeof(void*) + sizeof(pair<const uint64_t, int>)) +
+               indiceHash.bucket_count() * sizeof(void*);
+    }
+
+    // Blocos físicos ocupados e soma das referências (blocos lógicos dos arquivos)
+    size_t blocosUsados() const { return mapaBits.contarOcupados(); }
+    size_t somarReferencias() const {
+        size_t total = 0;
+        for (uint32_t r : referencias) total += r;
+        return total;
+    }
+
+    // Deduplicação após uma escrita nos bytes [offset, offset + n) de um arquivo
+    // com tamanhoArquivo bytes: cada bloco exclusivo da faixa cujo conteúdo já
+    // existe no disco passa a referenciar o bloco existente e o seu é liberado.
+    // Sem efeito se a deduplicação estiver desligada.
+    void deduplicar(vector<Extent>& extents, size_t offset, size_t n, size_t tamanhoArquivo) {
+        if (!deduplicacao || n == 0 || offset >= tamanhoArquivo) return;
+        auto trava = travar();
+        size_t primeiro = blocoDoByte(offset);
+        size_t ultimo = blocoDoByte(min(offset + n, tamanhoArquivo) - 1);
+
+        vector<Extent> resultado;
+        vector<Extent> duplicados;
+        size_t logico = 0;
+        for (const Extent& e : extents) {
+            size_t fimLogico = logico + e.comprimento;
+            if (fimLogico <= primeiro || logico > ultimo) {
+                anexarExtent(resultado, e);
+                logico = fimLogico;
+                continue;
+            }
+            size_t de = max(logico, primeiro);
+            size_t ate = min(fimLogico - 1, ultimo);
+            if (de > logico) anexarExtent(resultado, {e.inicio, (int)(de - logico)});
+            for (size_t lb = de; lb <= ate; lb++) {
+                int b = e.inicio + (int)(lb - logico);
+                int destino = b;
+                // Blocos já compartilhados (cp ou deduplicação anterior) ficam como estão
+                if (referencias[b] == 1) {
+                    destino = blocoCanonico(b, min(tamanhoBloco, tamanhoArquivo - bytesDosBlocos(lb)));
+                }
+                if (destino != b) {
+                    referencias[destino]++;
+                    anexarExtent(duplicados, {b, 1});
+                    blocosDeduplicados++;
+                }
+                anexarExtent(resultado, {destino, 1});
+            }
+            if (ate + 1 < fimLogico) {
+                int pulados = (int)(ate + 1 - logico);
+                anexarExtent(resultado, {e.inicio + pulados, e.comprimento - pulados});
+            }
+            logico = fimLogico;
+        }
+        extents = move(resultado);
+        liberarBlocos(duplicados);
+    }
+
+    // Percorre os bytes [offset, offset + tamanhoBytes) de um arquivo como spans
+    // contíguos do disco: f(endereco, bytes). Cada extent vira no máximo um span.
+    template <typename Func>
+    void percorrerSpans(const vector<Extent>& extents, size_t offset, size_t tamanhoBytes, Func&& f) const {
+        size_t restante = tamanhoBytes;
+        for (const Extent& e : extents) {
+            if (restante == 0) break;
+            size_t bytesExtent = bytesDosBlocos(e.comprimento);
+            // Extents inteiramente antes do offset são pulados sem tocar nos dados
+            if (offset >= bytesExtent) {
+                offset -= bytesExtent;
+                continue;
+            }
+            size_t n = min(bytesExtent - offset, restante);
+            f(bytesDosBlocos(e.inicio) + offset, n);
+            offset = 0;
+            restante -= n;
+        }
+    }
+
+    template <typename Func>
+    void percorrerSpans(const vector<Extent>& extents, size_t tamanhoBytes, Func&& f) const {
+        percorrerSpans(extents, 0, tamanhoBytes, f);
+    }
+
+    // Readahead dos bytes [offset, offset + n) do arquivo: com cache, os blocos
+    // vêm em leituras contíguas grandes; sem cache, vira um aviso ao backend
+    // (madvise no mmap)
+    void anteciparLeitura(const vector<Extent>& extents, size_t offset, size_t n) const {
+        if (n == 0) return;
+        percorrerSpans(extents, offset, n, [&](size_t endereco, size_t bytes) {
+            size_t primeiro = blocoDoByte(endereco);
+            size_t qtd = blocoDoByte(endereco + bytes - 1) - primeiro + 1;
+            if (cache) cache->anteciparBlocos(primeiro, qtd);
+            else armazenamento->aconselharLeitura(primeiro, qtd);
+        });
+    }
+
+    // I/O posicional: copia n bytes de origem para a posição offset do arquivo
+    void escreverEm(const vector<Extent>& extents, size_t offset, const char* origem, size_t n) {
+        percorrerSpans(extents, offset, n, [&](size_t endereco, size_t bytes) {
+            acessar(endereco, bytes, SOBRESCRITA, [&](char* p, size_t k) {
+                memcpy(p, origem, k);
+                origem += k;
+            });
+        });
+    }
+
+    // I/O posicional: copia até n bytes a partir de offset; retorna bytes copiados
+    size_t lerEm(const vector<Extent>& extents, size_t offset, char* destino, size_t n) const {
+        size_t copiados = 0;
+        percorrerSpans(extents, offset, n, [&](size_t endereco, size_t bytes) {
+            acessar(endereco, bytes, LEITURA, [&](char* p, size_t k) {
+                memcpy(destino + copiados, p, k);
+                copiados += k;
+            });
+        });
+        return copiados;
+    }
+
+    // I/O em bloco: copia n bytes de origem para os extents (um memcpy por extent)
+    void escreverDe(const vector<Extent>& extents, const char* origem, size_t n) {
+        escreverEm(extents, 0, origem, n);
+    }
+
+    // I/O em bloco: copia até n bytes dos extents para destino; retorna bytes copiados
+    size_t lerPara(const vector<Extent>& extents, char* destino, size_t n) const {
+        return lerEm(extents, 0, destino, n);
+    }
+
+    // Escreve dados nos extents alocados
+    void escreverDados(const vector<Extent>& extents, const string& conteudo) {
+        escreverDe(extents, conteudo.data(), conteudo.size());
+    }
+
+    // Lê dados dos extents para um buffer já dimensionado (sem realocações)
+    string lerDados(const vector<Extent>& extents, size_t tamanhoBytes) const {
+        size_t capacidade = totalBlocos(extents) * tamanhoBloco;
+        string conteudo(min(tamanhoBytes, capacidade), '\0');
+        lerPara(extents, &conteudo[0], conteudo.size());
         return conteudo;
     }
+
+    // Leitura sem cópia: segmentos apontando direto para o buffer do disco.
+    // Válidos até a próxima escrita/liberação desses blocos. Só sem cache
+    // (acessoDireto()): quadros do cache podem ser reaproveitados a qualquer momento.
+    vector<string_view> lerSegmentos(const vector<Extent>& extents, size_t tamanhoBytes) const {
+        if (cache) throw logic_error("lerSegmentos exige acesso direto ao disco");
+        vector<string_view> segmentos;
+        segmentos.reserve(extents.size());
+        percorrerSpans(extents, tamanhoBytes, [&](size_t endereco, size_t bytes) {
+            segmentos.emplace_back(dados + endereco, bytes);
+        });
+        return segmentos;
+    }
 };
 
 #endif // DISCO_VIRTUAL_H
@@ -0,0 +1,38 @@
+// Requisito 3.4: extents (faixas contíguas de blocos) usados pela alocação
+#ifndef EXTENT_H
+#define EXTENT_H
+
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+// Faixa contígua de blocos no disco: [inicio, inicio + comprimento)
+struct Extent {
+    int inicio;
+    int comprimento;
+
+    int fim() const { return inicio + comprimento; }
+};
+
+// Acrescenta um extent ao fim da lista, fundindo com o último se forem contíguos
+inline void anexarExtent(vector<Extent>& extents, Extent e) {
+    if (!extents.empty() && extents.back().fim() == e.inicio) extents.back().comprimento += e.comprimento;
+    else extents.push_back(e);
+}
+
+// Total de blocos cobertos por uma lista de extents
+inline size_t totalBlocos(const vector<Extent>& extents) {
+    size_t total = 0;
+    for (const Extent& e : extents) total += e.comprimento;
+    return total;
+}
+
+// 0.0 = arquivo totalmente contíguo; 1.0 = cada bloco em um extent separado
+inline double fragmentacao(const vector<Extent>& extents) {
+    size_t blocos = totalBlocos(extents);
+    if (blocos <= 1) return 0.0;
+    return (double)(extents.size() - 1) / (double)(blocos - 1);
+}
+
+#endif // EXTENT_H
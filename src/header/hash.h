@@ -0,0 +1,42 @@
+// Requisito 3.4: hash rápido (não criptográfico) do conteúdo de blocos
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+using namespace std;
+
+// Mistura final de 64 bits (finalizador do splitmix64): espalha bits
+// próximos para que chaves parecidas caiam longe na tabela
+inline uint64_t misturar64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Hash de n bytes processando 8 bytes por vez (memcpy evita leituras
+// desalinhadas). Colisões são possíveis: quem deduplica confirma com memcmp.
+inline uint64_t hashDados(const char* p, size_t n, uint64_t semente = 0) {
+    const uint64_t PRIMO = 0x9e3779b97f4a7c15ULL;
+    uint64_t h = semente ^ (n * PRIMO);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t palavra;
+        memcpy(&palavra, p + i, 8);
+        h = (h ^ misturar64(palavra)) * PRIMO;
+        h = (h << 31) | (h >> 33);
+    }
+    if (i < n) {
+        uint64_t resto = 0;
+        memcpy(&resto, p + i, n - i);
+        h = (h ^ misturar64(resto)) * PRIMO;
+    }
+    return misturar64(h);
+}
+
+#endif // HASH_H
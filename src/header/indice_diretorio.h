@@ -0,0 +1,90 @@
+// Requisito 3.1: índice das entradas de um diretório (hash com endereçamento aberto)
+#ifndef INDICE_DIRETORIO_H
+#define INDICE_DIRETORIO_H
+
+#include <vector>
+#include <memory>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include "arena_nomes.h"
+
+using namespace std;
+
+// Referência a um FCB: posição na tabela de inodes (tabela_inodes.h)
+using RefInode = uint32_t;
+const RefInode INODE_NULO = UINT32_MAX;
+
+class TabelaInodes;
+
+// ==========================================
+// ÍNDICE DE DIRETÓRIO
+// ==========================================
+// Tabela hash com sondagem linear: cada posição guarda o nome internado
+// (RefNome, arena_nomes.h) e o RefInode do filho (8 bytes, sem alocação por
+// entrada). Nomes internados iguais têm o mesmo RefNome, então a busca
+// compara inteiros e não lê FCB nenhum; o hash é o do próprio RefNome.
+// Remoção por deslocamento para trás (sem lápides).
+// Iterar percorre as posições, sem ordem definida; a visão em ordem de nome
+// (ls) é montada sob demanda e descartada na próxima mudança.
+class IndiceDiretorio {
+private:
+    struct Posicao {
+        RefNome nome;
+        RefInode ref; // INODE_NULO: posição livre
+    };
+    vector<Posicao> posicoes; // Potência de 2, ou vazio (arquivos, diretórios vazios)
+    uint32_t numEntradas = 0;
+    unique_ptr<vector<RefInode>> ordem; // Visão ordenada por nome, se montada
+
+    void redimensionar(size_t capacidade);
+
+public:
+    IndiceDiretorio() = default;
+    IndiceDiretorio(IndiceDiretorio&&) = default;
+    IndiceDiretorio& operator=(IndiceDiretorio&&) = default;
+
+    // Filho com esse nome (INODE_NULO se não existe)
+    RefInode buscar(const TabelaInodes& inodes, string_view nome) const;
+    RefInode buscar(RefNome nome) const;
+    bool contem(const TabelaInodes& inodes, string_view nome) const { return buscar(inodes, nome) != INODE_NULO; }
+    // Indexa ref pelo nome do seu FCB; false (e nada muda) se o nome já existe
+    bool inserir(const TabelaInodes& inodes, RefInode ref);
+    // Tira ref do índice (pelo nome atual do FCB); false se ref não estava nele.
+    // Renomear é remover, trocar o nome na tabela de inodes e inserir de novo
+    bool remover(const TabelaInodes& inodes, RefInode ref);
+    void limpar();
+    // Evita redimensionar enquanto n entradas são inseridas (montagem)
+    void reservar(size_t n);
+
+    // Filhos em ordem de nome; a visão vale até a próxima inserção ou remoção
+    const vector<RefInode>& emOrdem(const TabelaInodes& inodes);
+
+    size_t quantidade() const { return numEntradas; }
+    bool vazio() const { return numEntradas == 0; }
+    size_t bytes() const;
+
+    // Iteração pelos filhos (ordem das posições)
+    class Iterador {
+    private:
+        const Posicao* atual;
+        const Posicao* fim;
+        void pular() {
+            while (atual != fim && atual->ref == INODE_NULO) atual++;
+        }
+
+    public:
+        Iterador(const Posicao* a, const Posicao* f) : atual(a), fim(f) { pular(); }
+        RefInode operator*() const { return atual->ref; }
+        Iterador& operator++() {
+            atual++;
+            pular();
+            return *this;
+        }
+        bool operator!=(const Iterador& outro) const { return atual != outro.atual; }
+    };
+    Iterador begin() const { return Iterador(posicoes.data(), posicoes.data() + posicoes.size()); }
+    Iterador end() const { return Iterador(posicoes.data() + posicoes.size(), posicoes.data() + posicoes.size()); }
+};
+
+#endif // INDICE_DIRETORIO_H
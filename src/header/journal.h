@@ -0,0 +1,146 @@
+// Requisitos 3.1/3.4: journal de metadados (write-ahead log) da imagem de disco
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include "bloco_controle.h"
+
+using namespace std;
+
+// ==========================================
+// POLÍTICAS DE SINCRONIZAÇÃO
+// ==========================================
+// JOURNAL_SYNC:  cada operação é gravada e sincronizada (fdatasync) antes de retornar.
+// JOURNAL_GROUP: group commit. As operações entram no grupo aberto; o grupo é
+//                gravado com uma escrita e um fdatasync a cada JOURNAL_GROUP_MS ou
+//                ao chegar a JOURNAL_GROUP_OPS operações. Perde no máximo um grupo.
+// JOURNAL_ASYNC: como GROUP, mas sem fdatasync: sobrevive ao fim do processo,
+//                não a uma queda do host.
+enum PoliticaJournal { JOURNAL_SYNC, JOURNAL_GROUP, JOURNAL_ASYNC };
+
+// "sync", "group" ou "async"; lança invalid_argument para nomes desconhecidos
+PoliticaJournal lerPoliticaJournal(const string& nome);
+string nomePoliticaJournal(PoliticaJournal politica);
+
+// ==========================================
+// REGISTROS (REDO)
+// ==========================================
+// Cada registro descreve o estado final, não a operação: reaplicar é
+// idempotente. Uma transação (um comando) é uma sequência de registros.
+// REGISTRO_INODE:   atributos e blocos (ou conteúdo embutido) de um FCB e o
+//                   inode do pai (0 = raiz)
+// REGISTRO_REMOCAO: o inode (e a subárvore abaixo dele) deixa de existir
+enum TipoRegistro : uint8_t { REGISTRO_INODE = 1, REGISTRO_REMOCAO = 2 };
+
+// 'arquivo': extents e chunks do FCB (nullptr para diretórios e embutidos);
+// 'embutido': o conteúdo de um arquivo embutido
+void codificarInode(string& destino, const FCB& f, const DadosArquivo* arquivo, string_view embutido,
+                    string_view nome, int paiId);
+void codificarRemocao(string& destino, int inodeId);
+
+// Lê os registros de uma transação; lança runtime_error se estiver truncada
+class LeitorRegistros {
+private:
+    const string& dados;
+    size_t pos = 0;
+
+    void ler(void* destino, size_t n);
+    template <typename T> T ler() {
+        T valor;
+        ler(&valor, sizeof(T));
+        return valor;
+    }
+
+public:
+    explicit LeitorRegistros(const string& transacao) : dados(transacao) {}
+
+    bool fim() const { return pos >= dados.size(); }
+    TipoRegistro lerTipo();
+    // FCB sem pai, filhos nem nome (só atributos); paiId recebe o inode do
+    // pai, nome o nome, que entra na tabela de inodes junto com o FCB, e
+    // arquivo os extents e chunks (vazios para diretórios e embutidos) e
+    // embutido o conteúdo de um arquivo embutido
+    FCB lerInode(int& paiId, string& nome, DadosArquivo& arquivo, string& embutido);
+    int lerRemocao();
+};
+
+// ==========================================
+// JOURNAL
+// ==========================================
+struct EstatisticasJournal {
+    size_t transacoes = 0;  // Operações registradas
+    size_t grupos = 0;      // Escritas no log (uma por grupo)
+    size_t sincronizacoes = 0; // fdatasync do log
+    size_t checkpoints = 0;
+    size_t bytesLog = 0;    // Tamanho atual do log
+};
+
+// Dois arquivos ao lado da imagem:
+//   <imagem>.ckpt  checkpoint: a árvore inteira no formato compacto (arvore_compacta.h)
+//   <imagem>.wal   transações desde o checkpoint, cada uma num quadro
+//                  [tamanho][checksum][registros]
+// Ambos levam a geração do checkpoint; um log de outra geração é ignorado.
+// Um quadro truncado ou com checksum errado (queda no meio da escrita) marca
+// o fim do log: ele e o que vem depois são descartados.
+class Journal {
+private:
+    string caminhoLog;
+    string caminhoCheckpoint;
+    int fd = -1;
+    PoliticaJournal politica;
+    uint64_t geracao = 0;
+    // Executado antes de cada gravação do log (sem a trava): o disco descarrega
+    // o cache de blocos, então os dados chegam ao host antes dos metadados
+    function<void()> antesDeGravar;
+
+    mutable mutex trava;
+    condition_variable sinal;    // Acorda o thread de commit
+    condition_variable gravado;  // Acorda quem espera o fim de uma gravação
+    string grupo;                // Quadros ainda não gravados
+    size_t transacoesNoGrupo = 0;
+    bool gravando = false;
+    bool parar = false;
+    string erro;                 // Falha de I/O do thread de commit, relançada depois
+    EstatisticasJournal estatisticasAtuais;
+    thread comprometedor;
+
+    void gravarGrupo(unique_lock<mutex>& guarda);
+    void executarComprometedor();
+    void gravarCabecalhoLog();
+
+public:
+    // Abre (ou cria) o log de caminhoImagem; lê a geração do checkpoint
+    Journal(const string& caminhoImagem, PoliticaJournal politica, function<void()> antesDeGravar);
+    // Grava o grupo aberto antes de fechar
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Árvore do último checkpoint; false se não há checkpoint
+    bool carregarCheckpoint(string& arvore);
+    // Reaplica as transações do log em ordem; retorna quantas
+    size_t reproduzir(const function<void(const string&)>& aplicar);
+    // Esquece checkpoint e log (imagem nova)
+    void descartar();
+
+    // Acrescenta uma transação ao log conforme a política
+    void registrar(const string& transacao);
+    // Grava e sincroniza tudo o que foi registrado
+    void comprometer();
+    // Novo checkpoint com a árvore inteira (serializada); o log recomeça vazio.
+    // O chamador garante que o disco já foi sincronizado.
+    void checkpoint(const string& arvore);
+
+    EstatisticasJournal estatisticas() const;
+    PoliticaJournal obterPolitica() const { return politica; }
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,161 @@
+// Requisito 3.4: mapa de bits hierárquico para controle de blocos livres/ocupados
+#ifndef MAPA_BITS_H
+#define MAPA_BITS_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// ==========================================
+// MAPA DE BITS EM PALAVRAS DE 64 BITS
+// ==========================================
+// Nível 0: um bit por bloco (1 = ocupado).
+// Nível k+1: um bit por palavra do nível k (1 = palavra totalmente ocupada).
+// O último nível tem uma única palavra, então achar o primeiro bloco livre
+// desce log64(n) níveis usando count-trailing-zeros em cada um.
+class MapaBits {
+private:
+    vector<vector<uint64_t>> niveis;
+    vector<size_t> bitsPorNivel;
+    size_t numBits = 0;
+    size_t ocupados = 0;
+
+    static constexpr uint64_t CHEIA = ~0ULL;
+
+    static int ctz(uint64_t x) { return __builtin_ctzll(x); }
+    static int popcount(uint64_t x) { return __builtin_popcountll(x); }
+
+    // Primeiro bit livre >= pos no nível l (ou npos)
+    size_t buscarLivre(size_t l, size_t pos) const {
+        if (pos >= bitsPorNivel[l]) return npos;
+        const vector<uint64_t>& nivel = niveis[l];
+        size_t w = pos >> 6;
+        // Bits abaixo de pos na palavra contam como ocupados
+        uint64_t bits = nivel[w] | ((1ULL << (pos & 63)) - 1);
+        if (bits != CHEIA) return (w << 6) + ctz(~bits);
+        if (l + 1 == niveis.size()) return npos;
+
+        // Palavra esgotada: pergunta ao nível de cima qual a próxima palavra não cheia
+        size_t proxima = buscarLivre(l + 1, w + 1);
+        if (proxima == npos) return npos;
+        return (proxima << 6) + ctz(~nivel[proxima]);
+    }
+
+    // Propaga para cima o estado "palavra cheia" da palavra w do nível l
+    void atualizarResumo(size_t l, size_t w) {
+        while (l + 1 < niveis.size()) {
+            bool cheia = niveis[l][w] == CHEIA;
+            uint64_t& pai = niveis[l + 1][w >> 6];
+            uint64_t mascara = 1ULL << (w & 63);
+            bool marcadaNoPai = (pai & mascara) != 0;
+            if (cheia == marcadaNoPai) return;
+            if (cheia) pai |= mascara;
+            else pai &= ~mascara;
+            l++;
+            w >>= 6;
+        }
+    }
+
+public:
+    static constexpr size_t npos = (size_t)-1;
+
+    MapaBits() = default;
+
+    explicit MapaBits(size_t n) { redimensionar(n); }
+
+    // Recria o mapa com n bits, todos livres
+    void redimensionar(size_t n) {
+        numBits = n;
+        ocupados = 0;
+        niveis.clear();
+        bitsPorNivel.clear();
+        size_t bits = n;
+        do {
+            size_t palavras = (bits + 63) / 64;
+            vector<uint64_t> nivel(palavras, 0);
+            // Bits de preenchimento após o fim nunca podem ser escolhidos
+            if (bits % 64) nivel.back() = CHEIA << (bits % 64);
+            niveis.push_back(move(nivel));
+            bitsPorNivel.push_back(bits);
+            bits = palavras;
+        } while (bits > 1);
+    }
+
+    // Restaura o nível 0 a partir de palavras persistidas e recalcula
+    // contagem (popcount) e níveis de resumo em uma passada
+    void carregarPalavras(const uint64_t* origem) {
+        redimensionar(numBits);
+        vector<uint64_t>& base = niveis[0];
+        uint64_t preenchimento = base.empty() ? 0 : base.back();
+        for (size_t w = 0; w < base.size(); w++) base[w] = origem[w];
+        if (!base.empty()) base.back() |= preenchimento;
+        ocupados = 0;
+        for (size_t w = 0; w < base.size(); w++) ocupados += popcount(base[w]);
+        ocupados -= popcount(preenchimento);
+        for (size_t w = 0; w < base.size(); w++) {
+            if (base[w] == CHEIA) atualizarResumo(0, w);
+        }
+    }
+
+    // Palavras do nível 0 (inclui bits de preenchimento no fim)
+    const uint64_t* palavras() const { return niveis[0].data(); }
+    size_t numPalavras() const { return niveis[0].size(); }
+    // Memória de todos os níveis
+    size_t bytes() const {
+        size_t total = bitsPorNivel.capacity() * sizeof(size_t);
+        for (const vector<uint64_t>& nivel : niveis) total += nivel.capacity() * sizeof(uint64_t);
+        return total;
+    }
+
+    size_t tamanho() const { return numBits; }
+    size_t contarOcupados() const { return ocupados; }
+    size_t contarLivres() const { return numBits - ocupados; }
+
+    bool testar(size_t i) const {
+        return (niveis[0][i >> 6] >> (i & 63)) & 1;
+    }
+
+    void marcar(size_t i) {
+        uint64_t& palavra = niveis[0][i >> 6];
+        uint64_t mascara = 1ULL << (i & 63);
+        if (palavra & mascara) return;
+        palavra |= mascara;
+        ocupados++;
+        if (palavra == CHEIA) atualizarResumo(0, i >> 6);
+    }
+
+    void desmarcar(size_t i) {
+        uint64_t& palavra = niveis[0][i >> 6];
+        uint64_t mascara = 1ULL << (i & 63);
+        if (!(palavra & mascara)) return;
+        bool estavaCheia = palavra == CHEIA;
+        palavra &= ~mascara;
+        ocupados--;
+        if (estavaCheia) atualizarResumo(0, i >> 6);
+    }
+
+    // Primeiro bloco livre a partir de pos, O(log64 n)
+    size_t proximoLivre(size_t pos = 0) const {
+        return buscarLivre(0, pos);
+    }
+
+    // Conta blocos ocupados em [inicio, fim) palavra a palavra
+    size_t contarOcupados(size_t inicio, size_t fim) const {
+        size_t total = 0;
+        for (size_t i = inicio; i < fim;) {
+            size_t w = i >> 6;
+            size_t desloc = i & 63;
+            size_t n = min<size_t>(64 - desloc, fim - i);
+            uint64_t bits = niveis[0][w] >> desloc;
+            if (n < 64) bits &= (1ULL << n) - 1;
+            total += popcount(bits);
+            i += n;
+        }
+        return total;
+    }
+};
+
+#endif // MAPA_BITS_H
@@ -0,0 +1,86 @@
+// Requisitos 3.1/3.3: sessão de um cliente sobre um FileSystem compartilhado
+#ifndef SESSAO_H
+#define SESSAO_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "bloco_controle.h"
+
+using namespace std;
+
+class FileSystem;
+
+// Req 3.3: diretório conferido por podeAtravessar na geração dada. O
+// inodeId distingue o diretório de outro que reaproveite a posição.
+struct TravessiaConferida {
+    uint32_t geracao = 0;
+    int inodeId = 0;
+};
+
+// ==========================================
+// SESSÃO
+// ==========================================
+// O que é de cada cliente: usuário e grupo, diretório atual (e o caminho
+// dele como pilha de componentes) e o memo de travessia da sua identidade,
+// que sessões com o mesmo uid/gid compartilham. A árvore, os caches de
+// caminhos e de blocos, o disco e o journal são do FileSystem: criar uma
+// sessão não copia nada nem aloca memória, dá para criar uma por pedido.
+// Os comandos são os do FileSystem, com o usuário e o diretório desta
+// sessão; su e cd só mudam a sessão. Outra sessão pode mover ou remover o
+// diretório atual: o próximo comando refaz o caminho ou, se ele não existe
+// mais, volta para a raiz.
+// Uma sessão é usada por um thread de cada vez; sessões em threads
+// diferentes precisam do modo concorrente (FileSystem::ativarConcorrencia).
+class Sessao {
+private:
+    friend class FileSystem;
+    FileSystem& fs;
+    int usuario;
+    int grupo;
+    RefInode diretorio;
+    int idDiretorio; // inodeId de 'diretorio' (a posição pode ser reaproveitada)
+    // Caminho absoluto de 'diretorio' ("/a/b"; vazio na raiz, o formato das
+    // chaves do cache) como pilha: 'inicioComponentes' guarda onde cada
+    // componente começa
+    string caminho;
+    vector<uint32_t> inicioComponentes;
+    // Gerações do FileSystem já vistas: diretórios movidos ou removidos e
+    // árvore trocada (load, montagem)
+    uint64_t geracaoDiretorios;
+    uint64_t geracaoMontagem;
+    vector<TravessiaConferida>* travessias = nullptr; // Memo de (usuario, grupo); root não usa
+
+public:
+    // Na raiz, como uid/gid
+    explicit Sessao(FileSystem& fs, int uid = 0, int gid = 0);
+
+    // --- Comandos (os mesmos do FileSystem) ---
+    void mkdir(const string& nome);
+    void cd(const string& nome);
+    void touch(const string& nome, FileType tipo = TYPE_TEXT);
+    void echo(const string& nome, const string& conteudo, bool anexar = false);
+    void cat(const string& nome);
+    void escreverEm(const string& nome, size_t offset, const string& conteudo); // pwrite
+    void lerEm(const string& nome, size_t offset, size_t tamanho);              // pread
+    void ls(const string& nome = "");
+    void chmod(const string& nome, int permOctal);
+    void rm(const string& nome, bool recursivo = false);
+    void mv(const string& nomeAntigo, const string& nomeNovo);
+    void cp(const string& nomeOrigem, const string& nomeDestino);
+    void stat(const string& nome);
+    void executar(const string& nome);
+    void trocarUsuario(int uid, int gid = -1);
+    void quemSou();
+    bool lerConteudo(const string& nome, string& destino);
+    RefInode procurar(const string& nome);
+
+    int uid() const { return usuario; }
+    int gid() const { return grupo; }
+    // Caminho do diretório atual no último comando (prompt)
+    string_view obterCaminho() const { return caminho.empty() ? string_view("/") : string_view(caminho); }
+};
+
+#endif // SESSAO_H
@@ -4,72 +4,147 @@
 
 #include <memory>
 #include <string>
+#include <set>
+#include <map>
+#include <mutex>
+#include <atomic>
 #include "disco_virtual.h"
 #include "bloco_controle.h"
+#include "tabela_inodes.h"
 #include "constantes.h"
+#include "journal.h"
+#include "arvore_compacta.h"
+#include "travas.h"
+#include "sessao.h"
 
 using namespace std;
 
-class FileSystem {
-private:
-    VirtualDisk disco;
-    shared_ptr<FCB> raiz;
-    shared_ptr<FCB> diretorioAtual;
-    int usuarioAtual;
-    int grupoAtual;
-
-    bool verificarPermissao(shared_ptr<FCB> arquivo, int permRequerida);
-    string tipoArquivoString(FileType t);
-    string permParaStr(int p);
-    string tempoParaString(time_t t);
-    void removerRecursivo(shared_ptr<FCB> alvo);
-
-public:
-    FileSystem();
-
-    void mkdir(string nome);
-    void cd(string nome);
-    void touch(string nome, FileType tipo = TYPE_TEXT);
-    void echo(string nome, string conteudo);
-    void cat(string nome);
-    void ls();
-    void chmod(string nome, int permOctal);
-    void rm(string nome, bool recursivo = false);
-    void mv(string nomeAntigo, string nomeNovo);
-    void cp(string nomeOrigem, string nomeDestino);
-    void stat(string nome);
-    void executar(string nome);
-    void trocarUsuario(int uid, int gid = -1);
-    void quemSou();
-    string obterCaminho();
+// Req 3.4: alocação atrasada. Bytes anexados (echo >>) que ainda não têm
+// blocos (não entram no tamanho do FCB até serem descarregados) e os blocos
+// já reservados para eles.
+struct EscritaAdiada {
+    string dados;
+    size_t blocosReservados = 0;
 };
 
-#endif
-#ifndef SISTEMA_ARQUIVOS_H
-#define SISTEMA_ARQUIVOS_H
+// Req 3.1: entrada do cache de caminhos. 'alvo' INODE_NULO é uma entrada
+// negativa: o nome não existe em 'pai'.
+struct EntradaCaminho {
+    RefInode pai;
+    RefInode alvo;
+};
 
-#include <memory>
-#include <string>
-#include "disco_virtual.h"
-#include "bloco_controle.h"
-#include "constantes.h"
+// Req 3.4: trava do conteúdo de um arquivo no modo concorrente. Leitura
+// compartilhada, ou exclusiva quando há appends adiados a descarregar antes.
+struct TravaConteudo {
+    shared_lock<TravaInode> leitura;
+    unique_lock<TravaInode> escrita;
+};
 
-using namespace std;
+// Caminho resolvido: o diretório onde o último componente fica, o próprio
+// componente e o inode com esse nome (INODE_NULO se não existe). 'pai'
+// INODE_NULO: o caminho até o último componente falhou (erro já impresso).
+struct Resolucao {
+    RefInode pai = INODE_NULO;
+    RefInode alvo = INODE_NULO;
+    string nome;
+};
 
 // ==========================================
 // SISTEMA DE ARQUIVOS (Lógica Principal)
 // ==========================================
 class FileSystem {
 private:
+    friend class Sessao;
     VirtualDisk disco;
-    shared_ptr<FCB> raiz;
-    shared_ptr<FCB> diretorioAtual;
-    int usuarioAtual;  // ID do usuário atual logado
-    int grupoAtual; // ID do grupo atual
+    // Todos os FCBs em memória; a árvore e o estado abaixo só guardam RefInode
+    TabelaInodes inodes;
+    RefInode raiz;
+    // Sessão dos comandos chamados direto no FileSystem (a CLI). Outros
+    // clientes criam as suas (sessao.h).
+    unique_ptr<Sessao> principal;
+    // Mudam quando diretórios saem da árvore ou mudam de lugar (rm, mv,
+    // journal, descarga do --lazy) e quando a árvore inteira é trocada: cada
+    // sessão confere o seu diretório atual no comando seguinte
+    uint64_t geracaoDiretorios = 0;
+    uint64_t geracaoMontagem = 0;
+    bool compressao = false; // Novos arquivos texto/numéricos são comprimidos
+    size_t limiteEmbutido = INLINE_DATA_BYTES; // Conteúdo até esse tamanho fica no inode (0: nunca)
+    map<RefInode, EscritaAdiada> escritasPendentes; // Arquivos com appends ainda sem blocos
+    string caminhoImagem; // Vazio: disco em memória
+    bool imagemMapeada = true; // Backend da imagem: mmap ou pread/pwrite (load mantém o mesmo)
+    // Montagem sob demanda (--lazy): a árvore da imagem fica mapeada e cada
+    // diretório só vira FCBs quando é visitado. Diretórios frios e sem
+    // mudanças voltam para a imagem quando há inodes demais em memória.
+    bool sobDemanda = false;
+    unique_ptr<ImagemArvore> imagemArvore;
+    uint64_t relogioUso = 0;
+    // Cache de caminhos (dentry cache): caminho absoluto normalizado -> inode,
+    // inclusive nomes que não existem. Ordenado para que um caminho e tudo
+    // abaixo dele saiam numa faixa só quando a árvore muda ali.
+    bool cacheCaminhosAtivo = true;
+    map<string, EntradaCaminho> cacheCaminhos;
+    // Acertos e faltas por fatia da trava de leitores: threads diferentes
+    // não disputam a mesma linha de cache a cada resolução
+    struct alignas(64) ContagemCaminhos {
+        atomic<size_t> acertos{0};
+        atomic<size_t> faltas{0};
+    };
+    ContagemCaminhos contagensCaminhos[READER_LOCK_SLICES];
+    // Memo de travessia de cada identidade (uid, gid), por RefInode: o
+    // diretório e todos acima dele (menos a raiz) dão execução a ela. Vale
+    // enquanto a geração não muda (chmod de diretório, mv de diretório,
+    // journal e montagem, que trocam donos e permissões). As sessões guardam
+    // o vetor da sua identidade (map: ele não muda de lugar).
+    map<pair<int, int>, vector<TravessiaConferida>> travessias;
+    uint32_t geracaoTravessia = 1;
+    // Modo concorrente (ativarConcorrencia): comandos que só leem a árvore,
+    // ou reescrevem no lugar um arquivo em blocos, a compartilham; os que
+    // mudam a árvore, ou o usuário e o diretório da sessão principal, a têm
+    // sozinhos (os de outras sessões são só delas). Abaixo dela, na ordem
+    // em que são adquiridas: a trava de cada inode (o diretório antes dos
+    // filhos) e as folhas, que não esperam por mais nada: cache de caminhos
+    // e memo de travessia, escritas adiadas, alocação do disco, cache de
+    // blocos e journal. Com a árvore exclusiva nenhuma trava abaixo dela é
+    // necessária.
+    bool concorrente = false;
+    bool arvoreExclusiva = false; // Há um comando com a árvore sozinha
+    TravaLeitores travaArvore;
+    mutable TravaLeitores travaCaminhos;
+    mutable mutex travaPendentes;
+    class ArvoreCompartilhada;
+    class ArvoreExclusiva;
+    // Journal de metadados (opcional, só com imagem). Declarado depois do disco:
+    // é fechado antes dele.
+    unique_ptr<Journal> journal;
 
     // Helper: Verifica permissão (Req 3.3 - owner/group/others)
-    bool verificarPermissao(shared_ptr<FCB> arquivo, int permRequerida);
+    bool verificarPermissao(const Sessao& s, const FCB& arquivo, int permRequerida);
     
+    bool podeAtravessar(const Sessao& s, RefInode dir);
+    bool travessiaConferida(const Sessao& s, RefInode dir) const;
+    void conferirTravessia(const Sessao& s, RefInode dir);
+    void invalidarTravessias();
+    void identificar(Sessao& s);
+
+    // Diretório atual de cada sessão (Req 3.1)
+    void abrirSessao(Sessao& s);
+    void acertarSessao(Sessao& s);
+    void mudaramDiretorios();
+    RefInode localizar(const string& caminho);
+
+    // Travas do modo concorrente: vazias fora dele ou com a árvore exclusiva
+    bool compartilhando() const { return concorrente && !arvoreExclusiva; }
+    shared_lock<TravaLeitores> lerCaminhos() const;
+    unique_lock<TravaLeitores> escreverCaminhos();
+    unique_lock<mutex> travarPendentes() const;
+    shared_lock<TravaInode> lerInode(RefInode ref);
+    unique_lock<TravaInode> escreverInode(RefInode ref);
+    TravaConteudo travarConteudo(RefInode ref);
+    bool escritaNoLugar(RefInode ref, size_t bytes, bool substitui) const;
+    // Req 3.2: data de acesso (com a trava do inode, de leitura basta)
+    void registrarAcesso(FCB& arquivo);
+
     // Helper: Converte FileType para string
     string tipoArquivoString(FileType t);
     
@@ -79,28 +154,171 @@ private:
     // Utilitário para formatar tempo
     string tempoParaString(time_t t);
     
+    // Resolução de caminhos (Req 3.1): todos os comandos aceitam caminhos
+    // absolutos ou relativos ao diretório atual da sessão
+    Resolucao resolver(Sessao& s, const string& caminho);
+    bool atravessar(const Sessao& s, RefInode& dir, string_view componente);
+    string caminhoDe(RefInode f) const;
+    bool buscarCaminho(const string& chave, EntradaCaminho& entrada);
+    void guardarCaminho(string chave, EntradaCaminho entrada);
+    ContagemCaminhos& contagemCaminhos() { return contagensCaminhos[TravaLeitores::fatiaAtual()]; }
+    void seguirCaminho(Sessao& s, const string& caminho);
+    void refazerCaminho(Sessao& s);
+    void esquecerAbaixo(const string& prefixo);
+    void esquecerCaminho(RefInode f);
+
     // Helper: Remove recursivamente um FCB e seus filhos
-    void removerRecursivo(shared_ptr<FCB> alvo);
+    void removerRecursivo(RefInode alvo);
+
+    // Comandos na sessão s (os públicos usam a principal; Sessao chama estes)
+    void mkdir(Sessao& s, const string& nome);
+    void cd(Sessao& s, const string& nome);
+    void touch(Sessao& s, const string& nome, FileType tipo);
+    void echo(Sessao& s, const string& nome, const string& conteudo, bool anexar);
+    void cat(Sessao& s, const string& nome);
+    void escreverEm(Sessao& s, const string& nome, size_t offset, const string& conteudo);
+    void lerEm(Sessao& s, const string& nome, size_t offset, size_t tamanho);
+    void ls(Sessao& s, const string& nome);
+    void chmod(Sessao& s, const string& nome, int permOctal);
+    void rm(Sessao& s, const string& nome, bool recursivo);
+    void mv(Sessao& s, const string& nomeAntigo, const string& nomeNovo);
+    void cp(Sessao& s, const string& nomeOrigem, const string& nomeDestino);
+    void stat(Sessao& s, const string& nome);
+    void executar(Sessao& s, const string& nome);
+    void trocarUsuario(Sessao& s, int uid, int gid);
+    void quemSou(Sessao& s);
+    bool lerConteudo(Sessao& s, const string& nome, string& destino);
+    RefInode procurar(Sessao& s, const string& nome);
+
+    // Corpo dos comandos que outros comandos também usam (sem tomar a árvore de novo)
+    void mudarDiretorio(Sessao& s, const string& nome);
+    void mudarUsuario(Sessao& s, int uid, int gid);
+    void criarArquivo(Sessao& s, const string& nome, FileType tipo);
+    void escreverConteudo(Sessao& s, RefInode ref, const string& conteudo, bool anexar);
+    void escreverPosicao(Sessao& s, RefInode ref, size_t offset, const string& conteudo);
+    void ligarJournal(const string& politica);
+
+    // Helpers de I/O posicional no conteúdo do arquivo (Req 3.4)
+    void verificarEspaco(FCB& arquivo, size_t offset, size_t n, size_t blocosFinais);
+    void escreverNoArquivo(FCB& arquivo, size_t offset, const char* origem, size_t n);
+    void gravarArquivo(FCB& arquivo, size_t offset, const string& conteudo);
+    void redimensionarBlocos(FCB& arquivo, size_t bytes);
+    void redimensionarArquivo(FCB& arquivo, size_t novoTamanho);
+    string lerArquivo(RefInode ref, size_t offset, size_t tamanho);
+    void gravarComprimido(FCB& arquivo, size_t offset, const string& conteudo, bool truncar);
+    void gravarEmbutido(FCB& arquivo, size_t offset, const string& conteudo, bool truncar);
+    string lerComprimido(FCB& arquivo, size_t offset, size_t tamanho);
+
+    // Readahead e alocação atrasada (Req 3.4)
+    void anteciparLeitura(FCB& arquivo, size_t offset, size_t tamanho);
+    size_t blocosParaAnexar(FCB& arquivo, size_t bytes);
+    size_t bytesPendentes(RefInode ref) const;
+    void adiarEscrita(RefInode ref, const string& conteudo);
+    void descarregarEscrita(RefInode ref);
+    void descartarEscrita(RefInode ref);
+    void descarregarEscritas();
+
+    // Journal de metadados (Req 3.4): cada comando que altera a árvore registra
+    // o estado final dos FCBs tocados depois de aplicar a mudança em memória.
+    // O registro também marca os diretórios acima como modificados (--lazy).
+    int idPai(RefInode f);
+    void codificarRegistro(RefInode f, string& destino);
+    void codificarArvore(RefInode f, string& destino);
+    void registrarTransacao(const string& transacao);
+    void registrarInode(RefInode f);
+    void registrarArvore(RefInode f);
+    void registrarRemocao(RefInode f);
+    void aplicarTransacao(const string& transacao);
+    void checkpoint();
+
+    // Imagem em formato compacto (Req 3.1/3.2): a árvore é gravada depois dos
+    // blocos e montada de volta numa passada só
+    void montarArvoreDe(string_view metadados);
+    void trocarRaiz(RefInode novaRaiz);
+    size_t recalcularOcupacao();
+    string serializarArvoreAtual(vector<RefInode>* ordem = nullptr);
+    void gravarMetadados();
+
+    // Montagem sob demanda (Req 3.1)
+    void montarSobDemanda(unique_ptr<ImagemArvore> imagem);
+    void carregarFilhos(RefInode dir);
+    void carregarTudo(RefInode dir);
+    void descarregarFrios(const Sessao& s);
+    void marcarModificado(RefInode f);
 
 public:
-    FileSystem();
-
-    // --- Comandos (Req 3.1 e 3.2) ---
-    void mkdir(string nome);
-    void cd(string nome);
-    void touch(string nome, FileType tipo = TYPE_TEXT);
-    void echo(string nome, string conteudo);
-    void cat(string nome);
-    void ls();
-    void chmod(string nome, int permOctal);
-    void rm(string nome, bool recursivo = false);
-    void mv(string nomeAntigo, string nomeNovo);
-    void cp(string nomeOrigem, string nomeDestino);
-    void stat(string nome);
-    void executar(string nome);  // Novo comando para executar arquivos
+    // Geometria do disco virtual configurável em tempo de execução
+    FileSystem(size_t tamanhoBloco = BLOCK_SIZE, size_t numBlocos = DISK_SIZE_BLOCKS);
+    // Disco persistente em uma imagem no host (criada com a geometria dada se não existir),
+    // mapeada com mmap ou, com mapear = false, acessada por pread/pwrite através do cache.
+    // A árvore gravada na imagem (sync, save ou saída) é montada de volta: inteira
+    // ou, com sobDemanda, só a raiz (os diretórios são lidos ao serem visitados).
+    FileSystem(const string& caminhoImagem, size_t tamanhoBloco, size_t numBlocos, bool mapear = true,
+               bool sobDemanda = false);
+    // Descarrega as escritas adiadas e grava a árvore (e o checkpoint do journal) antes de fechar o disco
+    ~FileSystem();
+
+    // --- Comandos (Req 3.1 e 3.2), na sessão principal ---
+    // Nomes são caminhos: "a.txt", "docs/a.txt", "../b", "/x/y"
+    void mkdir(const string& nome) { mkdir(*principal, nome); }
+    void cd(const string& nome);
+    void touch(const string& nome, FileType tipo = TYPE_TEXT) { touch(*principal, nome, tipo); }
+    void echo(const string& nome, const string& conteudo, bool anexar = false) { echo(*principal, nome, conteudo, anexar); }
+    void cat(const string& nome) { cat(*principal, nome); }
+    void escreverEm(const string& nome, size_t offset, const string& conteudo) { escreverEm(*principal, nome, offset, conteudo); } // pwrite
+    void lerEm(const string& nome, size_t offset, size_t tamanho) { lerEm(*principal, nome, offset, tamanho); } // pread
+    void ls(const string& nome = "") { ls(*principal, nome); }
+    void chmod(const string& nome, int permOctal) { chmod(*principal, nome, permOctal); }
+    void rm(const string& nome, bool recursivo = false) { rm(*principal, nome, recursivo); }
+    void mv(const string& nomeAntigo, const string& nomeNovo) { mv(*principal, nomeAntigo, nomeNovo); } // Também entre diretórios
+    void cp(const string& nomeOrigem, const string& nomeDestino) { cp(*principal, nomeOrigem, nomeDestino); }
+    void stat(const string& nome) { stat(*principal, nome); }
+    void executar(const string& nome) { executar(*principal, nome); } // Novo comando para executar arquivos
     void trocarUsuario(int uid, int gid = -1);
-    void quemSou();
-    string obterCaminho();
+    void quemSou() { quemSou(*principal); }
+    // Caminho do diretório atual (prompt), sem montar nada: válido até o próximo comando
+    string_view obterCaminho() const { return principal->obterCaminho(); }
+    void sincronizar();
+    // save: grava a árvore na imagem atual (caminho vazio) ou copia disco e árvore para uma imagem nova
+    void salvar(const string& caminho);
+    // load: desmonta a imagem atual e monta a de caminho (mesmo backend e journal)
+    void carregar(const string& caminho);
+    void df();
+    // Memória em uso: inodes, tabelas laterais, índices de diretório, nomes e disco
+    void meminfo();
+    // fsck: confere a árvore, os índices e a contagem de blocos (e reservas)
+    // contra os extents; devolve quantos problemas achou
+    size_t fsck();
+    void ativarDeduplicacao(bool ativa);
+    void ativarCompressao(bool ativa);
+    // Arquivos de até 'limite' bytes guardam o conteúdo no inode (0 desliga;
+    // os que já são embutidos passam para blocos na próxima escrita)
+    void configurarEmbutidos(size_t limite);
+    void configurarCache(size_t orcamentoBytes, const string& politica);
+    // Cache de caminhos ligado (padrão) ou toda resolução percorrendo a árvore
+    void ativarCacheCaminhos(bool ativo);
+    // Modo concorrente: comandos de vários threads ao mesmo tempo sobre esta
+    // árvore, cada um com a sua Sessao ou todos na principal (cd e su nela
+    // travam a árvore inteira). Chamado antes
+    // de os threads começarem, não volta atrás; a montagem sob demanda vira
+    // completa (nenhum diretório é lido ou descarregado no meio de um cat).
+    void ativarConcorrencia();
+    void estatisticasCache();
+    // Liga o journal de metadados da imagem ("sync", "group" ou "async"): reaplica
+    // o checkpoint e o log deixados pela sessão anterior e faz um checkpoint novo
+    void ativarJournal(const string& politica);
+    void estatisticasJournal();
+    const Journal* obterJournal() const { return journal.get(); }
+    size_t tamanhoBloco() const { return disco.obterTamanhoBloco(); }
+    size_t numBlocos() const { return disco.obterNumBlocos(); }
+    size_t blocosLivres() const { return disco.blocosLivres(); }
+    // Conteúdo inteiro do arquivo em destino, sem imprimir (benchmarks, com
+    // as mesmas travas do cat); false se não existe ou não pode ser lido
+    bool lerConteudo(const string& nome, string& destino) { return lerConteudo(*principal, nome, destino); }
+    // Consulta sem efeitos (benchmarks): FCB de nome no diretório atual, ou INODE_NULO
+    RefInode procurar(const string& nome) const;
+    const FCB& inode(RefInode ref) const { return inodes[ref]; }
+    const TabelaInodes& tabelaInodes() const { return inodes; }
 };
 
 #endif // SISTEMA_ARQUIVOS_H
@@ -0,0 +1,303 @@
+// Requisito 3.2: tabela de inodes (FCBs em slabs, referenciados por índice de 32 bits)
+#ifndef TABELA_INODES_H
+#define TABELA_INODES_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include "bloco_controle.h"
+#include "arena_nomes.h"
+#include "constantes.h"
+#include "travas.h"
+
+using namespace std;
+
+// ==========================================
+// TABELA DE INODES
+// ==========================================
+// Os FCBs vivem em slabs de INODES_PER_SLAB registros e são referenciados por RefInode (posição na tabela). A árvore liga
+// pai e filhos por RefInode, sem contagem de referências: um FCB existe até
+// ser liberado explicitamente (rm, descarte de diretório frio, desmontagem).
+// Slabs nunca mudam de lugar, então um FCB& continua válido enquanto o FCB
+// não for liberado. Posições liberadas são reaproveitadas (última primeiro).
+// Um segundo índice leva do inodeId à posição (journal, stat). Os nomes
+// ficam na arena da tabela (arena_nomes.h): o FCB guarda só o RefNome, e a
+// tabela conta as referências ao criar, renomear e liberar.
+// O que é só de arquivo ou só de diretório fica em tabelas laterais
+// (deque: registros também não mudam de lugar), com um registro por inode
+// do tipo, alocado ao criar e devolvido ao liberar. Arquivos com o conteúdo
+// embutido (FCB::embutido) têm só os bytes, numa terceira tabela.
+// Cada posição tem também uma trava de leitores e escritor (modo
+// concorrente), ao lado do slab e não no FCB: ela continua no lugar quando
+// o FCB é destruído ou substituído. Posições vizinhas (arquivos criados em
+// sequência) ficam com travas em linhas de cache diferentes: cats paralelos
+// de arquivos diferentes não disputam a mesma linha.
+class TabelaInodes {
+private:
+    struct Slab {
+        alignas(FCB) unsigned char bytes[INODES_PER_SLAB * sizeof(FCB)];
+        TravaInode travas[INODES_PER_SLAB]; // Zeradas (livres); os bytes não
+    };
+    static_assert(INODES_PER_SLAB % (64 / sizeof(TravaInode)) == 0, "Travas do slab devem ocupar linhas de cache inteiras");
+    vector<unique_ptr<Slab>> slabs;
+    vector<uint8_t> ocupado;    // Por posição
+    vector<RefInode> livres;    // Posições liberadas, reaproveitadas primeiro
+    vector<RefInode> porId;     // inodeId -> posição (INODE_NULO se não existe)
+    size_t numVivos = 0;
+    ArenaNomes nomes;
+    deque<DadosArquivo> arquivos;
+    deque<DadosDiretorio> diretorios;
+    deque<string> embutidos;
+    vector<uint32_t> arquivosLivres;   // Registros devolvidos, reaproveitados primeiro
+    vector<uint32_t> diretoriosLivres;
+    vector<uint32_t> embutidosLivres;
+
+    FCB* endereco(RefInode r) const {
+        return reinterpret_cast<FCB*>(slabs[r / INODES_PER_SLAB]->bytes) + r % INODES_PER_SLAB;
+    }
+
+    void indexar(RefInode r) {
+        size_t id = (size_t)endereco(r)->inodeId;
+        if (id >= porId.size()) porId.resize(max(id + 1, porId.size() * 2), INODE_NULO);
+        porId[id] = r;
+    }
+
+    void desindexar(RefInode r) {
+        size_t id = (size_t)endereco(r)->inodeId;
+        if (id < porId.size() && porId[id] == r) porId[id] = INODE_NULO;
+    }
+
+    RefInode reservarPosicao() {
+        RefInode r;
+        if (!livres.empty()) {
+            r = livres.back();
+            livres.pop_back();
+        } else {
+            r = (RefInode)ocupado.size();
+            if (r % INODES_PER_SLAB == 0) slabs.push_back(unique_ptr<Slab>(new Slab)); // Só as travas começam zeradas
+            ocupado.push_back(0);
+        }
+        return r;
+    }
+
+    template <typename T>
+    static uint32_t alocarRegistro(deque<T>& tabela, vector<uint32_t>& livresTabela) {
+        if (livresTabela.empty()) {
+            tabela.emplace_back();
+            return (uint32_t)(tabela.size() - 1);
+        }
+        uint32_t i = livresTabela.back();
+        livresTabela.pop_back();
+        return i;
+    }
+    // O registro volta vazio (sem a memória dos vetores) para a lista livre
+    template <typename T>
+    static void devolverRegistro(deque<T>& tabela, vector<uint32_t>& livresTabela, uint32_t i) {
+        tabela[i] = T();
+        livresTabela.push_back(i);
+    }
+
+    // Tabela lateral do FCB: 0 diretório, 1 arquivo em blocos, 2 embutido
+    static int tabelaDe(const FCB& f) { return f.tipo() == DIRECTORY ? 0 : f.embutido ? 2 : 1; }
+
+    void anexarDados(FCB& f) {
+        switch (tabelaDe(f)) {
+        case 0: f.dados = alocarRegistro(diretorios, diretoriosLivres); break;
+        case 1: f.dados = alocarRegistro(arquivos, arquivosLivres); break;
+        default: f.dados = alocarRegistro(embutidos, embutidosLivres); break;
+        }
+    }
+    void soltarDados(const FCB& f) {
+        switch (tabelaDe(f)) {
+        case 0: devolverRegistro(diretorios, diretoriosLivres, f.dados); break;
+        case 1: devolverRegistro(arquivos, arquivosLivres, f.dados); break;
+        default: devolverRegistro(embutidos, embutidosLivres, f.dados); break;
+        }
+    }
+
+    void ocupar(RefInode r) {
+        anexarDados(*endereco(r));
+        ocupado[r] = 1;
+        numVivos++;
+        indexar(r);
+    }
+
+public:
+    TabelaInodes() = default;
+    TabelaInodes(const TabelaInodes&) = delete;
+    TabelaInodes& operator=(const TabelaInodes&) = delete;
+    ~TabelaInodes() { limpar(); }
+
+    // Constrói um FCB (nome e demais argumentos do construtor) numa posição livre
+    template <typename... Args>
+    RefInode criar(string_view nome, Args&&... args) {
+        RefNome n = nomes.internar(nome);
+        RefInode r = reservarPosicao();
+        new (endereco(r)) FCB(n, std::forward<Args>(args)...);
+        ocupar(r);
+        return r;
+    }
+    // FCB montado fora da tabela (journal, imagem, arquivo embutido), com o
+    // nome à parte; o registro lateral começa vazio
+    RefInode criar(FCB&& f, string_view nome) {
+        f.nome = nomes.internar(nome);
+        RefInode r = reservarPosicao();
+        new (endereco(r)) FCB(move(f));
+        ocupar(r);
+        return r;
+    }
+
+    // Só o FCB de r; os filhos são responsabilidade de quem chama
+    void liberar(RefInode r) {
+        desindexar(r);
+        nomes.soltar(endereco(r)->nome);
+        soltarDados(*endereco(r));
+        endereco(r)->~FCB();
+        ocupado[r] = 0;
+        livres.push_back(r);
+        numVivos--;
+    }
+
+
+    // r e todos os descendentes
+    void liberarSubarvore(RefInode r) {
+        vector<RefInode> pendentes = {r};
+        while (!pendentes.empty()) {
+            RefInode atual = pendentes.back();
+            pendentes.pop_back();
+            if (endereco(atual)->tipo() == DIRECTORY) {
+                for (RefInode filho : filhos(atual)) pendentes.push_back(filho);
+            }
+            liberar(atual);
+        }
+    }
+
+    void limpar() {
+        for (RefInode r = 0; r < ocupado.size(); r++) {
+            if (ocupado[r]) endereco(r)->~FCB();
+        }
+        slabs.clear();
+        nomes.limpar();
+        arquivos.clear();
+        diretorios.clear();
+        embutidos.clear();
+        arquivosLivres.clear();
+        diretoriosLivres.clear();
+        embutidosLivres.clear();
+        ocupado.clear();
+        livres.clear();
+        porId.clear();
+        numVivos = 0;
+    }
+
+    FCB& operator[](RefInode r) { return *endereco(r); }
+    const FCB& operator[](RefInode r) const { return *endereco(r); }
+    bool valido(RefInode r) const { return r < ocupado.size() && ocupado[r]; }
+    TravaInode& trava(RefInode r) const {
+        const size_t porLinha = 64 / sizeof(TravaInode);
+        size_t i = r % INODES_PER_SLAB;
+        return slabs[r / INODES_PER_SLAB]->travas[i % (INODES_PER_SLAB / porLinha) * porLinha + i / (INODES_PER_SLAB / porLinha)];
+    }
+
+    // Posição do inode com esse id (INODE_NULO se não está em memória)
+    RefInode buscarId(int inodeId) const {
+        if (inodeId < 0 || (size_t)inodeId >= porId.size()) return INODE_NULO;
+        return porId[inodeId];
+    }
+    // Troca os atributos de r (journal); o índice acompanha se o inodeId mudar.
+    // O registro lateral fica (um diretório mantém os filhos), a não ser que
+    // mude de tabela (arquivo e diretório, embutido e em blocos)
+    void substituir(RefInode r, FCB&& novo, string_view nome) {
+        FCB& atual = *endereco(r);
+        desindexar(r);
+        novo.nome = nomes.internar(nome);
+        nomes.soltar(atual.nome);
+        if (tabelaDe(novo) == tabelaDe(atual)) {
+            novo.dados = atual.dados;
+        } else {
+            soltarDados(atual);
+            anexarDados(novo);
+        }
+        atual = move(novo);
+        indexar(r);
+    }
+    // mv: troca só a referência ao nome (quem chama tira r do índice do pai antes)
+    void renomear(RefInode r, string_view nome) {
+        RefNome novo = nomes.internar(nome);
+        nomes.soltar(endereco(r)->nome);
+        endereco(r)->nome = novo;
+    }
+    string_view nome(RefInode r) const { return nomes.texto(endereco(r)->nome); }
+    // Arquivo passa a ter o conteúdo embutido ou em blocos: o registro antigo
+    // é devolvido e o novo começa vazio (quem chama move o conteúdo)
+    void definirEmbutido(FCB& f, bool embutido) {
+        if (f.embutido == embutido) return;
+        soltarDados(f);
+        f.embutido = embutido;
+        anexarDados(f);
+    }
+
+    // Registros laterais: só de arquivo (em blocos ou embutido) ou só de
+    // diretório, conforme o tipo
+    DadosArquivo& dadosArquivo(const FCB& f) { return arquivos[f.dados]; }
+    const DadosArquivo& dadosArquivo(const FCB& f) const { return arquivos[f.dados]; }
+    DadosArquivo& dadosArquivo(RefInode r) { return arquivos[endereco(r)->dados]; }
+    string& conteudoEmbutido(const FCB& f) { return embutidos[f.dados]; }
+    const string& conteudoEmbutido(const FCB& f) const { return embutidos[f.dados]; }
+    string& conteudoEmbutido(RefInode r) { return embutidos[endereco(r)->dados]; }
+    DadosDiretorio& dadosDiretorio(RefInode r) { return diretorios[endereco(r)->dados]; }
+    IndiceDiretorio& filhos(RefInode r) { return diretorios[endereco(r)->dados].filhos; }
+    const IndiceDiretorio& filhos(RefInode r) const { return diretorios[endereco(r)->dados].filhos; }
+    const ArenaNomes& arenaNomes() const { return nomes; }
+
+    // Chama f(r, fcb) para cada FCB vivo, em ordem de posição
+    template <typename F>
+    void paraCada(F f) {
+        for (RefInode r = 0; r < ocupado.size(); r++) {
+            if (ocupado[r]) f(r, *endereco(r));
+        }
+    }
+
+    size_t vivos() const { return numVivos; }
+    // Memória da própria tabela (slabs e índices), sem nomes nem tabelas laterais
+    size_t bytesTabela() const {
+        return slabs.size() * sizeof(Slab) + ocupado.capacity() + livres.capacity() * sizeof(RefInode) +
+               porId.capacity() * sizeof(RefInode);
+    }
+    // Tabela lateral dos arquivos, com os extents e chunks
+    size_t bytesArquivos() const {
+        size_t total = arquivos.size() * sizeof(DadosArquivo) + arquivosLivres.capacity() * sizeof(uint32_t);
+        for (const DadosArquivo& a : arquivos) {
+            total += a.extents.capacity() * sizeof(Extent) + a.chunks.capacity() * sizeof(ChunkComprimido);
+        }
+        return total;
+    }
+    // Tabela lateral dos diretórios, sem os índices de filhos (bytesIndices)
+    size_t bytesDiretorios() const {
+        return diretorios.size() * sizeof(DadosDiretorio) + diretoriosLivres.capacity() * sizeof(uint32_t);
+    }
+    // Tabela lateral dos arquivos embutidos, com os bytes que não cabem no std::string
+    size_t bytesEmbutidos() const {
+        size_t total = embutidos.size() * sizeof(string) + embutidosLivres.capacity() * sizeof(uint32_t);
+        for (const string& e : embutidos) {
+            if (e.capacity() > 15) total += e.capacity() + 1; // libstdc++: até 15 no próprio objeto
+        }
+        return total;
+    }
+    size_t bytesIndices() const {
+        size_t total = 0;
+        for (const DadosDiretorio& d : diretorios) total += d.filhos.bytes();
+        return total;
+    }
+    size_t numArquivos() const { return arquivos.size() - arquivosLivres.size() + numEmbutidos(); }
+    size_t numEmbutidos() const { return embutidos.size() - embutidosLivres.size(); }
+    size_t numDiretorios() const { return diretorios.size() - diretoriosLivres.size(); }
+};
+
+#endif // TABELA_INODES_H
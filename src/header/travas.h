@@ -0,0 +1,104 @@
+// Requisito 3.4: travas do modo concorrente (FileSystem::ativarConcorrencia)
+#ifndef TRAVAS_H
+#define TRAVAS_H
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include "constantes.h"
+
+using namespace std;
+
+// ==========================================
+// TRAVA DE INODE
+// ==========================================
+// Leitores e escritor em 4 bytes, uma por inode (tabela_inodes.h): contagem
+// de leitores nos bits de baixo, escritor e escritor esperando nos dois de
+// cima. As seções são curtas (um comando num arquivo), então quem espera só
+// cede o processador. Um escritor esperando barra leitores novos: ele não
+// passa fome atrás de cats seguidos.
+// Nomes de BasicLockable/SharedLockable: usada com unique_lock/shared_lock.
+class TravaInode {
+private:
+    static const uint32_t ESCRITOR = 1u << 31;
+    static const uint32_t ESPERANDO = 1u << 30;
+    atomic<uint32_t> estado{0};
+
+public:
+    void lock_shared() {
+        uint32_t v = estado.load(memory_order_relaxed);
+        for (;;) {
+            if (v & (ESCRITOR | ESPERANDO)) {
+                this_thread::yield();
+                v = estado.load(memory_order_relaxed);
+            } else if (estado.compare_exchange_weak(v, v + 1, memory_order_acquire, memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+    void unlock_shared() { estado.fetch_sub(1, memory_order_release); }
+
+    void lock() {
+        uint32_t v = estado.load(memory_order_relaxed);
+        for (;;) {
+            // Sem leitores nem escritor (a marca de espera pode ser de outro escritor)
+            if ((v & ~ESPERANDO) == 0) {
+                if (estado.compare_exchange_weak(v, ESCRITOR, memory_order_acquire, memory_order_relaxed)) return;
+                continue;
+            }
+            if (!(v & ESPERANDO)) estado.fetch_or(ESPERANDO, memory_order_relaxed);
+            this_thread::yield();
+            v = estado.load(memory_order_relaxed);
+        }
+    }
+    void unlock() { estado.store(0, memory_order_release); }
+};
+
+// ==========================================
+// TRAVA DE LEITORES DISTRIBUÍDA
+// ==========================================
+// Para o que quase todo comando lê e pouco muda (a árvore, o cache de
+// caminhos): um shared_mutex por fatia, cada um na sua linha de cache. Cada
+// thread lê pela sua fatia (threads novas recebem fatias em rodízio), então
+// leitores em núcleos diferentes não disputam a mesma linha. O escritor
+// trava todas as fatias em ordem; enquanto ele espera, leitores novos
+// aguardam antes de entrar (o shared_mutex da glibc prefere leitores).
+class TravaLeitores {
+private:
+    struct alignas(64) Fatia {
+        shared_mutex trava;
+    };
+    Fatia fatias[READER_LOCK_SLICES];
+    mutex escritores;
+    atomic<bool> escritorEsperando{false};
+
+public:
+    // Fatia do thread atual (também usada para espalhar contadores)
+    static size_t fatiaAtual() {
+        static atomic<size_t> proxima{0};
+        thread_local size_t fatia = proxima.fetch_add(1, memory_order_relaxed) % READER_LOCK_SLICES;
+        return fatia;
+    }
+
+    void lock_shared() {
+        while (escritorEsperando.load(memory_order_acquire)) this_thread::yield();
+        fatias[fatiaAtual()].trava.lock_shared();
+    }
+    void unlock_shared() { fatias[fatiaAtual()].trava.unlock_shared(); }
+
+    void lock() {
+        escritores.lock();
+        escritorEsperando.store(true, memory_order_release);
+        for (Fatia& f : fatias) f.trava.lock();
+    }
+    void unlock() {
+        for (Fatia& f : fatias) f.trava.unlock();
+        escritorEsperando.store(false, memory_order_release);
+        escritores.unlock();
+    }
+};
+
+#endif // TRAVAS_H
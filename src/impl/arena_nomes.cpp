@@ -0,0 +1,139 @@
+// Requisito 3.1: arena de nomes internados
+#include "../header/arena_nomes.h"
+#include "../header/hash.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+const size_t CABECALHO = 2 * sizeof(uint32_t);
+const size_t CAPACIDADE_MINIMA = 64;
+
+uint32_t hashTexto(string_view nome) {
+    return (uint32_t)hashDados(nome.data(), nome.size());
+}
+
+} // namespace
+
+// Posição do nome na tabela de internação, ou a posição livre onde ele entraria
+size_t ArenaNomes::procurarPosicao(string_view nome, uint32_t hash) const {
+    size_t mascara = posicoes.size() - 1;
+    for (size_t i = hash & mascara;; i = (i + 1) & mascara) {
+        const Posicao& p = posicoes[i];
+        if (p.nome == NOME_NULO || (p.hash == hash && texto(p.nome) == nome)) return i;
+    }
+}
+
+RefNome ArenaNomes::buscar(string_view nome) const {
+    if (numNomes == 0) return NOME_NULO;
+    return posicoes[procurarPosicao(nome, hashTexto(nome))].nome;
+}
+
+RefNome ArenaNomes::internar(string_view nome) {
+    uint32_t h = hashTexto(nome);
+    if (numNomes > 0) {
+        RefNome existente = posicoes[procurarPosicao(nome, h)].nome;
+        if (existente != NOME_NULO) {
+            reter(existente);
+            return existente;
+        }
+    }
+
+    // Nome novo: daqui em diante 'nome' não aponta para a arena (só nomes
+    // vivos são achados nela), então crescer 'dados' não o invalida
+    RefNome r;
+    auto livre = livres.find((uint32_t)nome.size());
+    if (livre != livres.end()) {
+        r = livre->second.back();
+        livre->second.pop_back();
+        if (livre->second.empty()) livres.erase(livre);
+        memcpy(&dados[r + CABECALHO], nome.data(), nome.size());
+    } else {
+        if (dados.size() + CABECALHO + nome.size() >= NOME_NULO) throw runtime_error("Erro: Arena de nomes cheia.");
+        r = (RefNome)dados.size();
+        dados.append(CABECALHO, '\0');
+        dados.append(nome);
+        escreverCampo(r, 1, (uint32_t)nome.size());
+    }
+    escreverCampo(r, 0, 1);
+
+    // Carga máxima de 3/4, como no índice de diretório
+    if ((numNomes + 1) * 4 > posicoes.size() * 3) redimensionar(max(CAPACIDADE_MINIMA, posicoes.size() * 2));
+    posicoes[procurarPosicao(nome, h)] = {h, r};
+    numNomes++;
+    numReferencias++;
+    bytesVivos += nome.size();
+    bytesReferenciados += nome.size();
+    return r;
+}
+
+void ArenaNomes::reter(RefNome r) {
+    escreverCampo(r, 0, lerCampo(r, 0) + 1);
+    numReferencias++;
+    bytesReferenciados += lerCampo(r, 1);
+}
+
+void ArenaNomes::soltar(RefNome r) {
+    uint32_t referencias = lerCampo(r, 0) - 1;
+    uint32_t tamanho = lerCampo(r, 1);
+    escreverCampo(r, 0, referencias);
+    numReferencias--;
+    bytesReferenciados -= tamanho;
+    if (referencias > 0) return;
+
+    // Último uso: o nome sai da tabela de internação (deslocamento para trás,
+    // como no índice de diretório) e o registro vira espaço livre
+    size_t mascara = posicoes.size() - 1;
+    size_t i = hashTexto(texto(r)) & mascara;
+    while (posicoes[i].nome != r) i = (i + 1) & mascara;
+    for (size_t j = (i + 1) & mascara; posicoes[j].nome != NOME_NULO; j = (j + 1) & mascara) {
+        size_t ideal = posicoes[j].hash & mascara;
+        bool podeMover = i <= j ? (ideal <= i || ideal > j) : (ideal <= i && ideal > j);
+        if (podeMover) {
+            posicoes[i] = posicoes[j];
+            i = j;
+        }
+    }
+    posicoes[i].nome = NOME_NULO;
+    numNomes--;
+    bytesVivos -= tamanho;
+    if (numNomes == 0) {
+        limpar();
+        return;
+    }
+    livres[tamanho].push_back(r);
+}
+
+void ArenaNomes::limpar() {
+    string().swap(dados);
+    vector<Posicao>().swap(posicoes);
+    livres.clear();
+    numNomes = 0;
+    numReferencias = 0;
+    bytesVivos = 0;
+    bytesReferenciados = 0;
+}
+
+void ArenaNomes::redimensionar(size_t capacidade) {
+    vector<Posicao> antigas(capacidade, Posicao{0, NOME_NULO});
+    antigas.swap(posicoes);
+    size_t mascara = capacidade - 1;
+    for (const Posicao& p : antigas) {
+        if (p.nome == NOME_NULO) continue;
+        size_t i = p.hash & mascara;
+        while (posicoes[i].nome != NOME_NULO) i = (i + 1) & mascara;
+        posicoes[i] = p;
+    }
+}
+
+size_t ArenaNomes::bytesLivres() const {
+    size_t total = 0;
+    for (auto& [tamanho, registros] : livres) total += registros.size() * (CABECALHO + tamanho);
+    return total;
+}
+
+size_t ArenaNomes::bytes() const {
+    size_t total = dados.capacity() + posicoes.capacity() * sizeof(Posicao);
+    for (auto& [tamanho, registros] : livres) total += registros.capacity() * sizeof(RefNome);
+    return total;
+}
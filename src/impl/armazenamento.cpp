@@ -0,0 +1,228 @@
+// Requisito 3.4: imagem de disco persistente (mapeada com mmap ou via pread/pwrite)
+#include "../header/armazenamento.h"
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+
+const char MAGICO[8] = {'M', '3', 'F', 'S', 'I', 'M', 'G', '1'};
+// Versão 2 acrescenta os metadados; imagens da versão 1 abrem sem eles
+const uint32_t VERSAO_IMAGEM = 2;
+const size_t ALINHAMENTO = 4096;
+
+// Superbloco gravado no início da imagem
+struct Superbloco {
+    char magico[8];
+    uint32_t versao;
+    uint32_t reservado;
+    uint64_t tamanhoBloco;
+    uint64_t numBlocos;
+    uint64_t offsetMapaBits;
+    uint64_t offsetDados;
+    // Árvore de FCBs depois dos blocos (tamanho 0 = sem metadados)
+    uint64_t offsetMetadados;
+    uint64_t tamanhoMetadados;
+};
+
+size_t alinhar(size_t v) {
+    return (v + ALINHAMENTO - 1) / ALINHAMENTO * ALINHAMENTO;
+}
+
+runtime_error erroSistema(const string& operacao, const string& caminho) {
+    return runtime_error("Erro: " + operacao + " '" + caminho + "': " + strerror(errno));
+}
+
+// Abre (ou cria, esparsa, com a geometria pedida) a imagem em caminho e
+// preenche o superbloco. Imagem existente mantém a geometria gravada.
+int abrirImagem(const string& caminho, size_t tamBloco, size_t qtdBlocos, Superbloco& sb, bool& existia) {
+    validarGeometria(tamBloco, qtdBlocos);
+    int fd = ::open(caminho.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) throw erroSistema("Nao foi possivel abrir a imagem", caminho);
+    try {
+        struct stat info;
+        if (fstat(fd, &info) < 0) throw erroSistema("fstat na imagem", caminho);
+        existia = info.st_size > 0;
+
+        if (existia) {
+            // Reabertura: a geometria vem do superbloco
+            if (pread(fd, &sb, sizeof(sb), 0) != (ssize_t)sizeof(sb) ||
+                memcmp(sb.magico, MAGICO, sizeof(MAGICO)) != 0 || sb.versao == 0 || sb.versao > VERSAO_IMAGEM) {
+                throw runtime_error("Erro: '" + caminho + "' nao e uma imagem de disco valida.");
+            }
+            if (sb.versao < 2) sb.tamanhoMetadados = 0;
+            validarGeometria(sb.tamanhoBloco, sb.numBlocos);
+            if ((uint64_t)info.st_size < sb.offsetDados + sb.tamanhoBloco * sb.numBlocos ||
+                (uint64_t)info.st_size < sb.offsetMetadados + sb.tamanhoMetadados) {
+                throw runtime_error("Erro: Imagem '" + caminho + "' truncada.");
+            }
+        } else {
+            memset(&sb, 0, sizeof(sb));
+            memcpy(sb.magico, MAGICO, sizeof(MAGICO));
+            sb.versao = VERSAO_IMAGEM;
+            sb.tamanhoBloco = tamBloco;
+            sb.numBlocos = qtdBlocos;
+            sb.offsetMapaBits = ALINHAMENTO;
+            sb.offsetDados = alinhar(sb.offsetMapaBits + (qtdBlocos + 63) / 64 * sizeof(uint64_t));
+            // Arquivo esparso: páginas só ocupam espaço no host quando escritas
+            if (ftruncate(fd, sb.offsetDados + tamBloco * qtdBlocos) < 0) {
+                throw erroSistema("Nao foi possivel dimensionar a imagem", caminho);
+            }
+            if (pwrite(fd, &sb, sizeof(sb), 0) != (ssize_t)sizeof(sb)) {
+                throw erroSistema("Nao foi possivel gravar o superbloco", caminho);
+            }
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    return fd;
+}
+
+// pread/pwrite completos (repetem em leituras/escritas parciais)
+void lerTudo(int fd, char* destino, size_t n, size_t offset, const string& caminho) {
+    while (n > 0) {
+        ssize_t r = pread(fd, destino, n, offset);
+        if (r <= 0) throw erroSistema("Leitura da imagem", caminho);
+        destino += r;
+        n -= r;
+        offset += r;
+    }
+}
+
+void escreverTudo(int fd, const char* origem, size_t n, size_t offset, const string& caminho) {
+    while (n > 0) {
+        ssize_t r = pwrite(fd, origem, n, offset);
+        if (r <= 0) throw erroSistema("Escrita na imagem", caminho);
+        origem += r;
+        n -= r;
+        offset += r;
+    }
+}
+
+} // namespace
+
+RegiaoMapeada::RegiaoMapeada(int fd, size_t offset, size_t n) {
+    // mmap exige offset múltiplo da página: mapeia desde a página do início
+    static const size_t PAGINA = (size_t)sysconf(_SC_PAGESIZE);
+    size_t desloc = offset % PAGINA;
+    tamanhoMapa = desloc + n;
+    void* p = mmap(nullptr, tamanhoMapa, PROT_READ, MAP_PRIVATE, fd, offset - desloc);
+    if (p == MAP_FAILED) throw runtime_error(string("Erro: mmap dos metadados: ") + strerror(errno));
+    base = p;
+    conteudo = string_view(static_cast<const char*>(p) + desloc, n);
+}
+
+RegiaoMapeada::~RegiaoMapeada() {
+    if (base) munmap(base, tamanhoMapa);
+}
+
+void ArmazenamentoImagem::abrirArquivo(const string& caminhoImagem, size_t tamBloco, size_t qtdBlocos) {
+    Superbloco sb;
+    caminho = caminhoImagem;
+    fd = abrirImagem(caminho, tamBloco, qtdBlocos, sb, existia);
+    tb = sb.tamanhoBloco;
+    n = sb.numBlocos;
+    offsetMapaBits = sb.offsetMapaBits;
+    offsetDados = sb.offsetDados;
+    offsetMetadados = sb.offsetMetadados;
+    tamanhoMetadados = sb.tamanhoMetadados;
+}
+
+ArmazenamentoImagem::~ArmazenamentoImagem() {
+    if (fd >= 0) ::close(fd);
+}
+
+unique_ptr<RegiaoMapeada> ArmazenamentoImagem::mapearMetadados() const {
+    if (tamanhoMetadados == 0) return nullptr;
+    return make_unique<RegiaoMapeada>(fd, offsetMetadados, tamanhoMetadados);
+}
+
+// Os metadados novos vão para uma área que não se sobrepõe aos atuais (logo
+// após os blocos, se couberem antes deles, ou depois deles); só então o
+// superbloco passa a apontar para a área nova. Uma queda no meio deixa a
+// versão anterior inteira.
+void ArmazenamentoImagem::gravarMetadados(const string& metadados) {
+    size_t base = alinhar(offsetDados + tb * n);
+    size_t destino = base;
+    if (tamanhoMetadados > 0 && offsetMetadados < base + alinhar(metadados.size())) {
+        destino = alinhar(offsetMetadados + tamanhoMetadados);
+    }
+    escreverTudo(fd, metadados.data(), metadados.size(), destino, caminho);
+    if (fdatasync(fd) < 0) throw erroSistema("fdatasync da imagem", caminho);
+
+    Superbloco sb;
+    if (pread(fd, &sb, sizeof(sb), 0) != (ssize_t)sizeof(sb)) throw erroSistema("Leitura do superbloco", caminho);
+    sb.versao = VERSAO_IMAGEM;
+    sb.offsetMetadados = destino;
+    sb.tamanhoMetadados = metadados.size();
+    escreverTudo(fd, reinterpret_cast<const char*>(&sb), sizeof(sb), 0, caminho);
+    if (fdatasync(fd) < 0) throw erroSistema("fdatasync da imagem", caminho);
+    offsetMetadados = destino;
+    tamanhoMetadados = metadados.size();
+    // Área anterior (se ficou depois da nova) não é mais referenciada
+    if (ftruncate(fd, destino + metadados.size()) < 0) throw erroSistema("Nao foi possivel truncar a imagem", caminho);
+}
+
+unique_ptr<ArmazenamentoMmap> ArmazenamentoMmap::abrir(const string& caminho, size_t tamBloco, size_t qtdBlocos) {
+    unique_ptr<ArmazenamentoMmap> img(new ArmazenamentoMmap());
+    img->abrirArquivo(caminho, tamBloco, qtdBlocos);
+    img->tamanhoMapa = img->offsetDados + img->tb * img->n;
+    void* p = mmap(nullptr, img->tamanhoMapa, PROT_READ | PROT_WRITE, MAP_SHARED, img->fd, 0);
+    if (p == MAP_FAILED) throw erroSistema("mmap da imagem", caminho);
+    img->mapa = static_cast<char*>(p);
+    return img;
+}
+
+ArmazenamentoMmap::~ArmazenamentoMmap() {
+    if (mapa) {
+        msync(mapa, tamanhoMapa, MS_SYNC);
+        munmap(mapa, tamanhoMapa);
+    }
+}
+
+// madvise(WILLNEED): o SO começa a trazer as páginas do arquivo de imagem
+void ArmazenamentoMmap::aconselharLeitura(size_t inicio, size_t qtd) {
+    static const size_t PAGINA = (size_t)sysconf(_SC_PAGESIZE);
+    size_t de = (offsetDados + inicio * tb) / PAGINA * PAGINA;
+    size_t ate = min(tamanhoMapa, offsetDados + (inicio + qtd) * tb);
+    if (ate > de) madvise(mapa + de, ate - de, MADV_WILLNEED);
+}
+
+void ArmazenamentoMmap::sincronizar() {
+    if (msync(mapa, tamanhoMapa, MS_SYNC) < 0) throw erroSistema("msync da imagem", caminho);
+}
+
+unique_ptr<ArmazenamentoArquivo> ArmazenamentoArquivo::abrir(const string& caminho, size_t tamBloco, size_t qtdBlocos) {
+    unique_ptr<ArmazenamentoArquivo> img(new ArmazenamentoArquivo());
+    img->abrirArquivo(caminho, tamBloco, qtdBlocos);
+    return img;
+}
+
+void ArmazenamentoArquivo::lerBlocos(size_t inicio, size_t qtd, char* destino) const {
+    lerTudo(fd, destino, qtd * tb, offsetDados + inicio * tb, caminho);
+}
+
+void ArmazenamentoArquivo::escreverBlocos(size_t inicio, size_t qtd, const char* origem) {
+    escreverTudo(fd, origem, qtd * tb, offsetDados + inicio * tb, caminho);
+}
+
+bool ArmazenamentoArquivo::carregarMapa(uint64_t* destino, size_t palavras) {
+    lerTudo(fd, reinterpret_cast<char*>(destino), palavras * sizeof(uint64_t), offsetMapaBits, caminho);
+    return true;
+}
+
+void ArmazenamentoArquivo::gravarMapa(const uint64_t* origem, size_t palavras) {
+    escreverTudo(fd, reinterpret_cast<const char*>(origem), palavras * sizeof(uint64_t), offsetMapaBits, caminho);
+}
+
+void ArmazenamentoArquivo::sincronizar() {
+    if (fsync(fd) < 0) throw erroSistema("fsync da imagem", caminho);
+}
@@ -0,0 +1,378 @@
+// Requisitos 3.1/3.2: serialização e montagem da árvore de FCBs no formato compacto
+#include "../header/arvore_compacta.h"
+#include "../header/hash.h"
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+const char MAGICO[8] = {'M', '3', 'F', 'S', 'T', 'R', 'E', 'E'};
+// Versão 2 acrescenta o hash do mapa de bits, os blocos compartilhados e o próximo inode;
+// a 3, os arquivos embutidos (a 2 ainda é lida: é a mesma sem eles)
+const uint32_t VERSAO = 3;
+const uint32_t VERSAO_SEM_EMBUTIDOS = 2;
+const uint32_t CHUNK_BRUTO = 1u << 31;
+
+static_assert(sizeof(CabecalhoArvore) == 72, "CabecalhoArvore deve ter 72 bytes");
+static_assert(sizeof(InodeCompacto) == 64, "InodeCompacto deve ter 64 bytes");
+static_assert(sizeof(Extent) == 8, "Extent deve ter 8 bytes");
+
+runtime_error corrompido() {
+    return runtime_error("Erro: Metadados da imagem corrompidos.");
+}
+
+template <typename T>
+void anexarTabela(string& destino, const vector<T>& tabela) {
+    destino.append(reinterpret_cast<const char*>(tabela.data()), tabela.size() * sizeof(T));
+}
+
+// Elemento i de uma tabela dentro dos dados (memcpy: sem exigir alinhamento)
+template <typename T>
+T lerElemento(const char* tabela, size_t i) {
+    T valor;
+    memcpy(&valor, tabela + i * sizeof(T), sizeof(T));
+    return valor;
+}
+
+// [primeiro, primeiro + quantidade) dentro de uma tabela de 'total' elementos
+bool faixaValida(uint64_t primeiro, uint64_t quantidade, uint64_t total) {
+    return primeiro <= total && quantidade <= total - primeiro;
+}
+
+} // namespace
+
+ImagemArvore::ImagemArvore(string_view d) : dados(d) {
+    if (dados.size() < sizeof(cab)) throw corrompido();
+    memcpy(&cab, dados.data(), sizeof(cab));
+    if (memcmp(cab.magico, MAGICO, sizeof(MAGICO)) != 0 ||
+        (cab.versao != VERSAO && cab.versao != VERSAO_SEM_EMBUTIDOS) || cab.numInodes == 0) {
+        throw corrompido();
+    }
+    size_t numInodes = cab.numInodes;
+    // Cada tabela é limitada pelo tamanho real antes de qualquer multiplicação estourar
+    size_t corpo = dados.size() - sizeof(cab);
+    if (cab.numExtents > corpo / sizeof(Extent) || cab.numChunks > corpo / sizeof(ChunkCompacto) ||
+        cab.numCompartilhados > corpo / sizeof(BlocoCompartilhado) || cab.tamanhoNomes > corpo) {
+        throw corrompido();
+    }
+    size_t esperado = numInodes * sizeof(InodeCompacto) + (numInodes - 1) * sizeof(EntradaDiretorio) +
+                      cab.numExtents * sizeof(Extent) + cab.numChunks * sizeof(ChunkCompacto) +
+                      cab.numCompartilhados * sizeof(BlocoCompartilhado) + cab.tamanhoNomes;
+    if (esperado != corpo) throw corrompido();
+
+    tabelaInodes = dados.data() + sizeof(cab);
+    tabelaEntradas = tabelaInodes + numInodes * sizeof(InodeCompacto);
+    tabelaExtents = tabelaEntradas + (numInodes - 1) * sizeof(EntradaDiretorio);
+    tabelaChunks = tabelaExtents + cab.numExtents * sizeof(Extent);
+    tabelaCompartilhados = tabelaChunks + cab.numChunks * sizeof(ChunkCompacto);
+    nomes = tabelaCompartilhados + cab.numCompartilhados * sizeof(BlocoCompartilhado);
+}
+
+// A região é movida só depois de lida (a ordem de avaliação do delegado é essa)
+ImagemArvore::ImagemArvore(unique_ptr<RegiaoMapeada> r) : ImagemArvore(r->dados()) {
+    regiao = move(r);
+}
+
+bool ImagemArvore::verificarSoma() const {
+    return hashDados(dados.data() + sizeof(cab), dados.size() - sizeof(cab)) == cab.soma;
+}
+
+vector<pair<uint32_t, uint32_t>> ImagemArvore::compartilhados() const {
+    vector<pair<uint32_t, uint32_t>> resultado(cab.numCompartilhados);
+    for (size_t k = 0; k < resultado.size(); k++) {
+        BlocoCompartilhado b = lerElemento<BlocoCompartilhado>(tabelaCompartilhados, k);
+        resultado[k] = {b.bloco, b.referencias};
+    }
+    return resultado;
+}
+
+InodeCompacto ImagemArvore::inode(uint32_t i) const {
+    if (i >= cab.numInodes) throw corrompido();
+    InodeCompacto c = lerElemento<InodeCompacto>(tabelaInodes, i);
+    if (c.tipo > TYPE_PROGRAM) throw corrompido();
+    bool valido;
+    if (c.tipo == DIRECTORY) {
+        valido = faixaValida(c.primeiro, c.quantidade, cab.numInodes - 1);
+    } else if (c.flags & INODE_EMBUTIDO) {
+        valido = cab.versao != VERSAO_SEM_EMBUTIDOS && c.quantidade == 0 && c.numChunks == 0 &&
+                 faixaValida(c.primeiro, (uint64_t)c.tamanho, cab.tamanhoNomes);
+    } else {
+        valido = faixaValida(c.primeiro, c.quantidade, cab.numExtents) &&
+                 faixaValida(c.primeiroChunk, c.numChunks, cab.numChunks);
+    }
+    if (!valido) throw corrompido();
+    return c;
+}
+
+EntradaDiretorio ImagemArvore::entrada(size_t k) const {
+    if (k >= cab.numInodes - 1) throw corrompido();
+    EntradaDiretorio e = lerElemento<EntradaDiretorio>(tabelaEntradas, k);
+    if (e.inode >= cab.numInodes || !faixaValida(e.offsetNome, e.tamanhoNome, cab.tamanhoNomes)) throw corrompido();
+    return e;
+}
+
+string_view ImagemArvore::nome(const EntradaDiretorio& e) const {
+    return string_view(nomes + e.offsetNome, e.tamanhoNome);
+}
+
+// Só para inodes já conferidos por inode()
+string_view ImagemArvore::conteudoEmbutido(const InodeCompacto& c) const {
+    return string_view(nomes + c.primeiro, (size_t)c.tamanho);
+}
+
+Extent ImagemArvore::extent(size_t k) const {
+    if (k >= cab.numExtents) throw corrompido();
+    return lerElemento<Extent>(tabelaExtents, k);
+}
+
+ChunkComprimido ImagemArvore::chunk(size_t k) const {
+    if (k >= cab.numChunks) throw corrompido();
+    ChunkCompacto ch = lerElemento<ChunkCompacto>(tabelaChunks, k);
+    return {ch.offset, ch.tamanho & ~CHUNK_BRUTO, (ch.tamanho & CHUNK_BRUTO) != 0};
+}
+
+namespace {
+
+// FCB do inode i com nome e pai dados; diretórios ficam com os filhos por carregar
+RefInode criarFCB(TabelaInodes& inodes, const ImagemArvore& imagem, uint32_t i, string_view nome, RefInode pai) {
+    InodeCompacto c = imagem.inode(i);
+    if (c.inodeId <= 0) throw corrompido();
+    FCB novo(NOME_NULO, (FileType)c.tipo, c.idProprietario, c.idGrupo,
+             (c.modo >> 6) & 7, (c.modo >> 3) & 7, c.modo & 7, pai, c.inodeId);
+    novo.tamanho = (uint64_t)c.tamanho;
+    novo.criadoEm = paraTempoFS((time_t)c.criadoEm);
+    novo.modificadoEm = paraTempoFS((time_t)c.modificadoEm);
+    novo.acessadoEm = paraTempoFS((time_t)c.acessadoEm);
+    novo.comprimido = (c.flags & INODE_COMPRIMIDO) != 0;
+    novo.embutido = c.tipo != DIRECTORY && (c.flags & INODE_EMBUTIDO) != 0;
+    novo.indiceImagem = i;
+    novo.filhosCarregados = c.tipo != DIRECTORY;
+    RefInode r = inodes.criar(move(novo), nome);
+    FCB& f = inodes[r];
+    if (c.tipo == DIRECTORY) return r;
+    if (f.embutido) {
+        inodes.conteudoEmbutido(f) = string(imagem.conteudoEmbutido(c));
+        return r;
+    }
+    try {
+        DadosArquivo& dados = inodes.dadosArquivo(f);
+        dados.extents.reserve(c.quantidade);
+        for (size_t k = c.primeiro; k < (size_t)c.primeiro + c.quantidade; k++) dados.extents.push_back(imagem.extent(k));
+        dados.chunks.reserve(c.numChunks);
+        for (size_t k = c.primeiroChunk; k < (size_t)c.primeiroChunk + c.numChunks; k++) {
+            dados.chunks.push_back(imagem.chunk(k));
+        }
+    } catch (...) {
+        inodes.liberar(r);
+        throw;
+    }
+    return r;
+}
+
+} // namespace
+
+RefInode ImagemArvore::montarRaiz(TabelaInodes& inodes) const {
+    if (inode(0).tipo != DIRECTORY) throw corrompido();
+    RefInode raiz = criarFCB(inodes, *this, 0, "/", INODE_NULO);
+    inodes[raiz].pai = raiz; // Pai da raiz é ela mesma
+    nextInodeId = max(nextInodeId.load(), cab.proximoInodeId);
+    return raiz;
+}
+
+size_t ImagemArvore::carregarFilhos(TabelaInodes& inodes, RefInode dir) const {
+    uint32_t i = inodes[dir].indiceImagem;
+    InodeCompacto c = inode(i);
+    if (c.tipo != DIRECTORY) throw corrompido();
+    try {
+        // Índice já no tamanho final: nenhuma reinserção durante a carga
+        inodes.filhos(dir).reservar(c.quantidade);
+        for (size_t k = c.primeiro; k < (size_t)c.primeiro + c.quantidade; k++) {
+            EntradaDiretorio e = entrada(k);
+            // Filho sempre depois do pai: a árvore não tem ciclos
+            if (e.inode <= i) throw corrompido();
+            RefInode f = criarFCB(inodes, *this, e.inode, nome(e), dir);
+            // Nome repetido no mesmo diretório: imagem corrompida
+            if (!inodes.filhos(dir).inserir(inodes, f)) {
+                inodes.liberar(f);
+                throw corrompido();
+            }
+        }
+    } catch (...) {
+        for (RefInode filho : inodes.filhos(dir)) inodes.liberar(filho);
+        inodes.filhos(dir).limpar();
+        throw;
+    }
+    inodes[dir].filhosCarregados = true;
+    return c.quantidade;
+}
+
+void ImagemArvore::somarArquivos(uint32_t i, size_t& arquivos, size_t& bytes, size_t& blocos) const {
+    vector<uint32_t> pilha = {i};
+    while (!pilha.empty()) {
+        uint32_t atual = pilha.back();
+        pilha.pop_back();
+        InodeCompacto c = inode(atual);
+        if (c.tipo == DIRECTORY) {
+            for (size_t k = c.primeiro; k < (size_t)c.primeiro + c.quantidade; k++) {
+                EntradaDiretorio e = entrada(k);
+                if (e.inode <= atual) throw corrompido();
+                pilha.push_back(e.inode);
+            }
+            continue;
+        }
+        arquivos++;
+        bytes += c.tamanho;
+        for (size_t k = c.primeiro; k < (size_t)c.primeiro + c.quantidade; k++) blocos += extent(k).comprimento;
+    }
+}
+
+string serializarArvore(const TabelaInodes& inodes, RefInode raiz, const OcupacaoBlocos& ocupacao,
+                        const ImagemArvore* imagem, vector<RefInode>* ordem) {
+    vector<InodeCompacto> registros;
+    vector<EntradaDiretorio> entradas;
+    vector<Extent> extents;
+    vector<ChunkCompacto> chunks;
+    string nomes;
+
+    // Fila da busca em largura: a posição na fila é o índice na tabela. Cada
+    // posição é um FCB em memória ou um inode copiado da imagem.
+    struct No {
+        RefInode ref;
+        uint32_t indice;
+    };
+    vector<No> fila = {{raiz, 0}};
+    auto anexarChunk = [&](const ChunkComprimido& ch) {
+        chunks.push_back({ch.offset, ch.tamanho | (ch.bruto ? CHUNK_BRUTO : 0)});
+    };
+    // Entradas do diretório i da imagem (filhos ainda não carregados)
+    auto copiarEntradas = [&](uint32_t i, InodeCompacto& c) {
+        InodeCompacto origem = imagem->inode(i);
+        c.primeiro = (uint32_t)entradas.size();
+        c.quantidade = origem.quantidade;
+        for (size_t k = origem.primeiro; k < (size_t)origem.primeiro + origem.quantidade; k++) {
+            EntradaDiretorio e = imagem->entrada(k);
+            if (e.inode <= i) throw runtime_error("Erro: Metadados da imagem corrompidos.");
+            string_view nome = imagem->nome(e);
+            entradas.push_back({(uint32_t)fila.size(), (uint32_t)nomes.size(), (uint32_t)nome.size()});
+            nomes += nome;
+            fila.push_back({INODE_NULO, e.inode});
+        }
+    };
+
+    for (size_t i = 0; i < fila.size(); i++) {
+        No no = fila[i];
+        if (ordem) ordem->push_back(no.ref);
+        InodeCompacto c{};
+        if (no.ref == INODE_NULO) {
+            // Inode que não saiu da imagem: copiado com as faixas realocadas
+            c = imagem->inode(no.indice);
+            if (c.tipo == DIRECTORY) {
+                copiarEntradas(no.indice, c);
+            } else if (c.flags & INODE_EMBUTIDO) {
+                string_view conteudo = imagem->conteudoEmbutido(c);
+                c.primeiro = (uint32_t)nomes.size();
+                nomes += conteudo;
+            } else {
+                uint32_t primeiro = c.primeiro, primeiroChunk = c.primeiroChunk;
+                c.primeiro = (uint32_t)extents.size();
+                c.primeiroChunk = (uint32_t)chunks.size();
+                for (size_t k = primeiro; k < (size_t)primeiro + c.quantidade; k++) extents.push_back(imagem->extent(k));
+                for (size_t k = primeiroChunk; k < (size_t)primeiroChunk + c.numChunks; k++) anexarChunk(imagem->chunk(k));
+            }
+            registros.push_back(c);
+            continue;
+        }
+
+        const FCB& f = inodes[no.ref];
+        c.tamanho = f.tamanho;
+        c.criadoEm = deTempoFS(f.criadoEm);
+        c.modificadoEm = deTempoFS(f.modificadoEm);
+        c.acessadoEm = deTempoFS(f.acessadoEm);
+        c.inodeId = f.inodeId;
+        c.idProprietario = f.idProprietario;
+        c.idGrupo = f.idGrupo;
+        c.tipo = (uint8_t)f.tipo();
+        c.flags = (f.comprimido ? INODE_COMPRIMIDO : 0) | (f.embutido ? INODE_EMBUTIDO : 0);
+        c.modo = f.modo & 0777;
+        if (f.tipo() == DIRECTORY && !f.filhosCarregados && imagem) {
+            copiarEntradas(f.indiceImagem, c);
+        } else if (f.tipo() == DIRECTORY) {
+            // Filhos na ordem do índice (sem ordenar): a montagem reconstrói o hash
+            c.primeiro = (uint32_t)entradas.size();
+            c.quantidade = (uint32_t)inodes.filhos(no.ref).quantidade();
+            for (RefInode filho : inodes.filhos(no.ref)) {
+                string_view nome = inodes.nome(filho);
+                entradas.push_back({(uint32_t)fila.size(), (uint32_t)nomes.size(), (uint32_t)nome.size()});
+                nomes += nome;
+                fila.push_back({filho, 0});
+            }
+        } else if (f.embutido) {
+            c.primeiro = (uint32_t)nomes.size();
+            nomes += inodes.conteudoEmbutido(f);
+        } else {
+            const DadosArquivo& dados = inodes.dadosArquivo(f);
+            c.primeiro = (uint32_t)extents.size();
+            c.quantidade = (uint32_t)dados.extents.size();
+            extents.insert(extents.end(), dados.extents.begin(), dados.extents.end());
+            c.primeiroChunk = (uint32_t)chunks.size();
+            c.numChunks = (uint32_t)dados.chunks.size();
+            for (const ChunkComprimido& ch : dados.chunks) anexarChunk(ch);
+        }
+        registros.push_back(c);
+    }
+
+    vector<BlocoCompartilhado> compartilhados;
+    compartilhados.reserve(ocupacao.compartilhados.size());
+    for (auto& [bloco, referencias] : ocupacao.compartilhados) compartilhados.push_back({bloco, referencias});
+
+    string corpo;
+    corpo.reserve(registros.size() * sizeof(InodeCompacto) + entradas.size() * sizeof(EntradaDiretorio) +
+                  extents.size() * sizeof(Extent) + chunks.size() * sizeof(ChunkCompacto) +
+                  compartilhados.size() * sizeof(BlocoCompartilhado) + nomes.size());
+    anexarTabela(corpo, registros);
+    anexarTabela(corpo, entradas);
+    anexarTabela(corpo, extents);
+    anexarTabela(corpo, chunks);
+    anexarTabela(corpo, compartilhados);
+    corpo += nomes;
+
+    CabecalhoArvore cab{};
+    memcpy(cab.magico, MAGICO, sizeof(MAGICO));
+    cab.versao = VERSAO;
+    cab.numInodes = (uint32_t)registros.size();
+    cab.numExtents = extents.size();
+    cab.numChunks = chunks.size();
+    cab.numCompartilhados = compartilhados.size();
+    cab.tamanhoNomes = nomes.size();
+    cab.somaMapa = ocupacao.somaMapa;
+    cab.proximoInodeId = nextInodeId;
+    cab.soma = hashDados(corpo.data(), corpo.size());
+
+    string resultado(reinterpret_cast<const char*>(&cab), sizeof(cab));
+    resultado += corpo;
+    return resultado;
+}
+
+// Montagem completa: os diretórios são carregados em ordem de largura, que é
+// a ordem da tabela, então a árvore inteira sai numa passada linear
+RefInode montarArvore(TabelaInodes& inodes, string_view dados) {
+    ImagemArvore imagem(dados);
+    if (!imagem.verificarSoma()) throw corrompido();
+    RefInode raiz = imagem.montarRaiz(inodes);
+    vector<RefInode> diretorios = {raiz};
+    try {
+        for (size_t i = 0; i < diretorios.size(); i++) {
+            imagem.carregarFilhos(inodes, diretorios[i]);
+            for (RefInode filho : inodes.filhos(diretorios[i])) {
+                if (inodes[filho].tipo() == DIRECTORY) diretorios.push_back(filho);
+            }
+        }
+    } catch (...) {
+        inodes.liberarSubarvore(raiz);
+        throw;
+    }
+    return raiz;
+}
@@ -0,0 +1,307 @@
+// Requisito 3.4: cache de blocos com políticas LRU/ARC e write-back em segundo plano
+#include "../header/cache_blocos.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+// ==========================================
+// LRU
+// ==========================================
+void PoliticaLRU::acessar(size_t bloco) {
+    auto it = posicao.find(bloco);
+    if (it != posicao.end()) ordem.splice(ordem.begin(), ordem, it->second);
+}
+
+size_t PoliticaLRU::escolherVitima(size_t, const function<bool(size_t)>& podeSair) {
+    for (auto it = ordem.rbegin(); it != ordem.rend(); ++it) {
+        size_t bloco = *it;
+        if (!podeSair(bloco)) continue;
+        ordem.erase(next(it).base());
+        posicao.erase(bloco);
+        return bloco;
+    }
+    return npos;
+}
+
+void PoliticaLRU::inserir(size_t novo) {
+    ordem.push_front(novo);
+    posicao[novo] = ordem.begin();
+}
+
+// ==========================================
+// ARC
+// ==========================================
+void PoliticaARC::mover(size_t bloco, Lista destino) {
+    auto& [lista, it] = posicao.at(bloco);
+    listas[destino].splice(listas[destino].begin(), listas[lista], it);
+    lista = destino;
+}
+
+void PoliticaARC::descartarMaisAntigo(Lista l) {
+    posicao.erase(listas[l].back());
+    listas[l].pop_back();
+}
+
+// Expulsa o residente mais antigo não fixado de T1 ou T2 para o fantasma correspondente
+size_t PoliticaARC::expulsarDe(Lista l, const function<bool(size_t)>& podeSair) {
+    for (auto it = listas[l].rbegin(); it != listas[l].rend(); ++it) {
+        size_t bloco = *it;
+        if (!podeSair(bloco)) continue;
+        mover(bloco, l == T1 ? B1 : B2);
+        return bloco;
+    }
+    return npos;
+}
+
+void PoliticaARC::acessar(size_t bloco) {
+    auto it = posicao.find(bloco);
+    if (it != posicao.end() && (it->second.first == T1 || it->second.first == T2)) mover(bloco, T2);
+}
+
+size_t PoliticaARC::escolherVitima(size_t novo, const function<bool(size_t)>& podeSair) {
+    auto it = posicao.find(novo);
+    bool emB1 = it != posicao.end() && it->second.first == B1;
+    bool emB2 = it != posicao.end() && it->second.first == B2;
+    size_t t1 = listas[T1].size(), b1 = listas[B1].size(), b2 = listas[B2].size();
+
+    // Adaptação: o fantasma acertado indica qual lista deveria ser maior
+    if (emB1) p = min(capacidade, p + max<size_t>(1, b2 / b1));
+    else if (emB2) p -= min(p, max<size_t>(1, b1 / b2));
+
+    bool preferirT1 = t1 > 0 && (t1 > p || (emB2 && t1 == p));
+    size_t vitima = expulsarDe(preferirT1 ? T1 : T2, podeSair);
+    if (vitima == npos) vitima = expulsarDe(preferirT1 ? T2 : T1, podeSair);
+    return vitima;
+}
+
+void PoliticaARC::inserir(size_t novo) {
+    auto it = posicao.find(novo);
+    if (it != posicao.end()) {
+        mover(novo, T2); // Estava num fantasma: já foi visto antes
+    } else {
+        listas[T1].push_front(novo);
+        posicao[novo] = {T1, listas[T1].begin()};
+    }
+    // Fantasmas limitados: |T1| + |B1| <= c e o total <= 2c
+    while (listas[T1].size() + listas[B1].size() > capacidade && !listas[B1].empty()) {
+        descartarMaisAntigo(B1);
+    }
+    while (posicao.size() > 2 * capacidade && !listas[B2].empty()) {
+        descartarMaisAntigo(B2);
+    }
+}
+
+unique_ptr<PoliticaSubstituicao> criarPolitica(const string& nome, size_t capacidadeBlocos) {
+    if (nome == "lru") return make_unique<PoliticaLRU>();
+    if (nome == "arc") return make_unique<PoliticaARC>(capacidadeBlocos);
+    throw invalid_argument("Erro: Politica de cache desconhecida: " + nome);
+}
+
+// ==========================================
+// CACHE DE BLOCOS
+// ==========================================
+CacheBlocos::CacheBlocos(Armazenamento& b, size_t orcamentoBytes, const string& nomePolitica,
+                         chrono::milliseconds intervaloDescarga)
+    : backend(b), tamanhoBloco(b.tamanhoBloco()), intervalo(intervaloDescarga) {
+    size_t capacidade = max<size_t>(4, orcamentoBytes / tamanhoBloco);
+    capacidade = min(capacidade, backend.numBlocos());
+    politica = criarPolitica(nomePolitica, capacidade);
+    memoria.resize(capacidade * tamanhoBloco);
+    quadros.resize(capacidade);
+    for (size_t q = capacidade; q > 0; q--) quadrosLivres.push_back(q - 1);
+    descarregador = thread(&CacheBlocos::executarDescarregador, this);
+}
+
+CacheBlocos::~CacheBlocos() {
+    {
+        lock_guard<mutex> guarda(trava);
+        parar = true;
+    }
+    sinal.notify_one();
+    descarregador.join();
+    try {
+        descarregar();
+    } catch (exception&) {
+        // Destrutor não propaga: o erro de I/O já foi reportado em 'sync' se houve
+    }
+}
+
+// Chamado com a trava adquirida. Quadro livre para 'novo': da lista de livres
+// ou expulsando a vítima da política (gravada antes, se suja); npos se todos
+// os quadros estão fixados
+size_t CacheBlocos::obterQuadro(size_t novo) {
+    if (!quadrosLivres.empty()) {
+        size_t q = quadrosLivres.back();
+        quadrosLivres.pop_back();
+        return q;
+    }
+    size_t vitima = politica->escolherVitima(novo, [&](size_t b) {
+        return quadros[quadroDoBloco.at(b)].fixacoes == 0;
+    });
+    if (vitima == PoliticaSubstituicao::npos) return PoliticaSubstituicao::npos;
+    size_t q = quadroDoBloco.at(vitima);
+    if (quadros[q].sujo) gravarQuadro(q);
+    quadroDoBloco.erase(vitima);
+    quadros[q] = Quadro();
+    estatisticasAtuais.expulsoes++;
+    return q;
+}
+
+// Torna o bloco residente (lendo do backend numa falta, exceto em SOBRESCRITA)
+// e o fixa; ESCRITA/SOBRESCRITA marcam o quadro como sujo. Com todos os
+// quadros fixados (modo concorrente: outros threads no meio de um acesso),
+// espera um ser solto. Ninguém fixa um segundo bloco segurando o primeiro,
+// então quem fixou sempre solta sem esperar.
+size_t CacheBlocos::fixar(size_t bloco, ModoAcesso modo) {
+    unique_lock<mutex> guarda(trava);
+    size_t q;
+    bool falta = false;
+    for (;;) {
+        auto it = quadroDoBloco.find(bloco);
+        if (it != quadroDoBloco.end()) {
+            q = it->second;
+            estatisticasAtuais.acertos++;
+            if (quadros[q].antecipado) {
+                quadros[q].antecipado = false;
+                estatisticasAtuais.acertosAntecipados++;
+            }
+            politica->acessar(bloco);
+            break;
+        }
+        q = obterQuadro(bloco);
+        falta = q != PoliticaSubstituicao::npos;
+        if (falta) break;
+        // Ao acordar, o bloco pode ter sido trazido por quem esperava junto
+        quadroSolto.wait(guarda);
+    }
+    if (falta) {
+        estatisticasAtuais.faltas++;
+        try {
+            if (modo != SOBRESCRITA) backend.lerBlocos(bloco, 1, enderecoQuadro(q));
+        } catch (...) {
+            quadrosLivres.push_back(q);
+            quadroSolto.notify_all();
+            throw;
+        }
+        quadros[q].bloco = bloco;
+        quadroDoBloco[bloco] = q;
+        politica->inserir(bloco);
+    }
+
+    quadros[q].fixacoes++;
+    if (modo != LEITURA && !quadros[q].sujo) {
+        quadros[q].sujo = true;
+        estatisticasAtuais.sujos++;
+        // Metade dos quadros sujos: acorda o descarregador antes do prazo
+        if (estatisticasAtuais.sujos * 2 >= quadros.size()) sinal.notify_one();
+    }
+    return q;
+}
+
+void CacheBlocos::anteciparBlocos(size_t inicio, size_t qtd) {
+    lock_guard<mutex> guarda(trava);
+    qtd = min({qtd, quadros.size() / 4, backend.numBlocos() - min(inicio, backend.numBlocos())});
+    vector<char> lote;
+    size_t b = inicio;
+    while (b < inicio + qtd) {
+        if (quadroDoBloco.count(b)) {
+            b++;
+            continue;
+        }
+        // Faixa de blocos não residentes: uma leitura só no backend
+        size_t fimFaixa = b;
+        while (fimFaixa < inicio + qtd && !quadroDoBloco.count(fimFaixa)) fimFaixa++;
+        vector<size_t> destinos;
+        for (size_t k = b; k < fimFaixa; k++) {
+            size_t q = obterQuadro(k);
+            if (q == PoliticaSubstituicao::npos) break;
+            destinos.push_back(q);
+        }
+        if (destinos.empty()) return;
+        lote.resize(destinos.size() * tamanhoBloco);
+        try {
+            backend.lerBlocos(b, destinos.size(), lote.data());
+        } catch (...) {
+            for (size_t q : destinos) quadrosLivres.push_back(q);
+            throw;
+        }
+        for (size_t k = 0; k < destinos.size(); k++) {
+            size_t q = destinos[k];
+            memcpy(enderecoQuadro(q), lote.data() + k * tamanhoBloco, tamanhoBloco);
+            quadros[q].bloco = b + k;
+            quadros[q].antecipado = true;
+            quadroDoBloco[b + k] = q;
+            politica->inserir(b + k);
+        }
+        estatisticasAtuais.antecipados += destinos.size();
+        if (destinos.size() < fimFaixa - b) return; // Sem quadros livres
+        b = fimFaixa;
+    }
+}
+
+void CacheBlocos::soltar(size_t q) {
+    lock_guard<mutex> guarda(trava);
+    if (--quadros[q].fixacoes == 0) quadroSolto.notify_all();
+}
+
+// Chamado com a trava adquirida
+void CacheBlocos::gravarQuadro(size_t q) {
+    backend.escreverBlocos(quadros[q].bloco, 1, enderecoQuadro(q));
+    quadros[q].sujo = false;
+    estatisticasAtuais.sujos--;
+    estatisticasAtuais.gravacoes++;
+}
+
+// Chamado com a trava adquirida. Grava os quadros sujos não fixados em ordem
+// de bloco; blocos consecutivos vão juntos numa única escrita no backend.
+void CacheBlocos::gravarSujos(bool fundo) {
+    vector<pair<size_t, size_t>> sujos; // (bloco, quadro)
+    for (size_t q = 0; q < quadros.size(); q++) {
+        if (quadros[q].sujo && quadros[q].fixacoes == 0) sujos.push_back({quadros[q].bloco, q});
+    }
+    sort(sujos.begin(), sujos.end());
+
+    vector<char> lote;
+    size_t i = 0;
+    while (i < sujos.size()) {
+        size_t j = i + 1;
+        while (j < sujos.size() && sujos[j].first == sujos[j - 1].first + 1) j++;
+        lote.resize((j - i) * tamanhoBloco);
+        for (size_t k = i; k < j; k++) {
+            memcpy(lote.data() + (k - i) * tamanhoBloco, enderecoQuadro(sujos[k].second), tamanhoBloco);
+        }
+        backend.escreverBlocos(sujos[i].first, j - i, lote.data());
+        for (size_t k = i; k < j; k++) {
+            quadros[sujos[k].second].sujo = false;
+            estatisticasAtuais.sujos--;
+            estatisticasAtuais.gravacoes++;
+            if (fundo) estatisticasAtuais.gravacoesFundo++;
+        }
+        i = j;
+    }
+}
+
+void CacheBlocos::executarDescarregador() {
+    unique_lock<mutex> guarda(trava);
+    while (!parar) {
+        sinal.wait_for(guarda, intervalo);
+        if (parar) break;
+        if (estatisticasAtuais.sujos == 0) continue;
+        try {
+            gravarSujos(true);
+        } catch (exception&) {
+            // Os quadros continuam sujos; a próxima descarga (ou 'sync') tenta de novo
+        }
+    }
+}
+
+void CacheBlocos::descarregar() {
+    lock_guard<mutex> guarda(trava);
+    gravarSujos(false);
+}
+
+EstatisticasCache CacheBlocos::estatisticas() const {
+    lock_guard<mutex> guarda(trava);
+    return estatisticasAtuais;
+}
@@ -6,20 +6,48 @@ using namespace std;
 
 void printHelp() {
     cout << "\n=== COMANDOS DISPONIVEIS ===\n";
+    cout << "  (nomes aceitam caminhos: a.txt, docs/a.txt, ../b, /x/y)\n";
     cout << "  mkdir <nome>            - Cria diretorio\n";
     cout << "  cd <nome|..|/>          - Navega entre diretorios (req 3.1/3.3)\n";
-    cout << "  ls                      - Lista arquivos com metadados (req 3.1/3.3)\n";
+    cout << "  ls [dir]                - Lista arquivos com metadados (req 3.1/3.3)\n";
     cout << "  touch <nome> [tipo]     - Cria arquivo (tipo: text/num/bin/prog) (req 3.2)\n";
     cout << "  echo <arq> <conteudo>   - Escreve conteudo no arquivo (req 3.2/3.4/3.3)\n";
+    cout << "  echo >> <arq> <conteudo> - Anexa conteudo ao fim do arquivo (req 3.2/3.4/3.3)\n";
     cout << "  cat <arq>               - Le conteudo do arquivo (req 3.2/3.3/3.4)\n";
+    cout << "  pwrite <arq> <off> <c>  - Escreve conteudo a partir do offset (req 3.2/3.4/3.3)\n";
+    cout << "  pread <arq> <off> <n>   - Le n bytes a partir do offset (req 3.2/3.4/3.3)\n";
     cout << "  cp <origem> <destino>   - Copia arquivo ou diretorio (req 3.1/3.2/3.3/3.4)\n";
-    cout << "  mv <origem> <destino>   - Move/renomeia arquivo (req 3.3)\n";
+    cout << "  mv <origem> <destino>   - Move/renomeia arquivo ou diretorio (req 3.1/3.3)\n";
     cout << "  rm <nome>               - Remove arquivo ou diretorio (req 3.3)\n";
     cout << "  chmod <arq> <perm>      - Altera permissoes (ex: 755, 644) (req 3.3)\n";
-    cout << "  stat <arq>              - Mostra metadados detalhados (inode, blocos) (req 3.2/3.4)\n";
+    cout << "  stat <arq>              - Mostra metadados detalhados (inode, blocos, inline) (req 3.2/3.4)\n";
     cout << "  exec <arq>              - Executa arquivo (requer permissao x) (req 3.3)\n";
     cout << "  su <uid> [gid]          - Troca usuario/grupo atual (req 3.3)\n";
     cout << "  whoami                  - Mostra usuario/grupo atual (req 3.3)\n";
+    cout << "  sync                    - Sincroniza a imagem de disco (msync) (req 3.4)\n";
+    cout << "  save [arquivo]          - Grava arvore e blocos na imagem (atual ou nova) (req 3.1/3.2/3.4)\n";
+    cout << "  load <arquivo>          - Monta outra imagem de disco (req 3.1/3.2/3.4)\n";
+    cout << "  df                      - Espaco em disco: bytes logicos vs fisicos (req 3.4)\n";
+    cout << "  meminfo                 - Memoria em uso: inodes, indices, nomes e disco (req 3.1/3.2/3.4)\n";
+    cout << "  fsck                    - Confere arvore, tamanhos, referencias dos blocos e reservas (req 3.4)\n";
+    cout << "  cache                   - Contadores do cache de blocos (req 3.4)\n";
+    cout << "  journal                 - Contadores do journal de metadados (req 3.4)\n";
     cout << "  help                    - Mostra esta ajuda\n";
     cout << "  exit                    - Sai do simulador\n\n";
 }
+
+void printUsage(const char* programa) {
+    cout << "Uso: " << programa << " [opcoes]\n";
+    cout << "  --block-size <bytes>    - Tamanho do bloco (padrao 64; ex: 512, 4K, 64K)\n";
+    cout << "  --blocks <n>            - Numero de blocos do disco (padrao 100)\n";
+    cout << "  --disk-size <bytes>     - Tamanho total do disco (ex: 64M, 2G); define --blocks\n";
+    cout << "  --image <arquivo>       - Disco persistente em imagem mmap (criada se nao existir; arvore montada dela)\n";
+    cout << "  --lazy                  - Com --image, le os diretorios da imagem sob demanda\n";
+    cout << "  --dedup                 - Deduplica blocos de conteudo identico\n";
+    cout << "  --compress              - Comprime arquivos texto/numericos (chunks LZ)\n";
+    cout << "  --inline <bytes>        - Conteudo ate esse tamanho fica no inode, sem blocos (padrao 60; 0 desliga)\n";
+    cout << "  --no-dcache             - Desliga o cache de caminhos (toda resolucao percorre a arvore)\n";
+    cout << "  --cache <lru|arc>       - Cache de blocos com write-back (imagem via pread/pwrite)\n";
+    cout << "  --cache-size <bytes>    - Orcamento de memoria do cache (padrao 1M)\n";
+    cout << "  --journal <politica>    - Journal de metadados da imagem: sync, group ou async\n";
+}
@@ -0,0 +1,112 @@
+// Requisito 3.4: codec LZ autocontido usado pela compressão de arquivos
+#include "../header/compressao.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+const size_t MATCH_MINIMO = 4;
+const size_t DISTANCIA_MAXIMA = 65535;
+const int BITS_TABELA = 12;
+
+uint32_t ler32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// Posição na tabela de candidatos para os 4 bytes em p (hash multiplicativo)
+uint32_t posicaoTabela(const char* p) {
+    return (ler32(p) * 2654435761u) >> (32 - BITS_TABELA);
+}
+
+// Comprimentos >= 15 continuam em bytes de 255 até um byte < 255
+void gravarComprimento(string& saida, size_t resto) {
+    while (resto >= 255) {
+        saida.push_back((char)255);
+        resto -= 255;
+    }
+    saida.push_back((char)resto);
+}
+
+void gravarSequencia(string& saida, const char* literais, size_t numLiterais, size_t distancia, size_t match) {
+    size_t extraMatch = match ? match - MATCH_MINIMO : 0;
+    uint8_t token = (uint8_t)((min<size_t>(numLiterais, 15) << 4) | min<size_t>(extraMatch, 15));
+    saida.push_back((char)token);
+    if (numLiterais >= 15) gravarComprimento(saida, numLiterais - 15);
+    saida.append(literais, numLiterais);
+    if (match == 0) return; // Última sequência: só literais
+    saida.push_back((char)(distancia & 0xff));
+    saida.push_back((char)(distancia >> 8));
+    if (extraMatch >= 15) gravarComprimento(saida, extraMatch - 15);
+}
+
+} // namespace
+
+string comprimirLZ(const char* origem, size_t n) {
+    string saida;
+    saida.reserve(n / 2 + 16);
+    vector<int> tabela(1 << BITS_TABELA, -1);
+    size_t ancora = 0;
+    size_t i = 0;
+    while (i + MATCH_MINIMO <= n) {
+        uint32_t h = posicaoTabela(origem + i);
+        int candidato = tabela[h];
+        tabela[h] = (int)i;
+        if (candidato < 0 || i - candidato > DISTANCIA_MAXIMA || ler32(origem + candidato) != ler32(origem + i)) {
+            i++;
+            continue;
+        }
+        size_t match = MATCH_MINIMO;
+        while (i + match < n && origem[candidato + match] == origem[i + match]) match++;
+        gravarSequencia(saida, origem + ancora, i - ancora, i - candidato, match);
+        i += match;
+        ancora = i;
+    }
+    gravarSequencia(saida, origem + ancora, n - ancora, 0, 0);
+    return saida;
+}
+
+void descomprimirLZ(const char* origem, size_t n, char* destino, size_t tamanhoOriginal) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(origem);
+    const uint8_t* fim = p + n;
+    size_t escritos = 0;
+    auto corrompido = [] { return runtime_error("Erro: Dados comprimidos corrompidos."); };
+    auto lerComprimento = [&](size_t base) {
+        size_t total = base;
+        if (base < 15) return total;
+        uint8_t b;
+        do {
+            if (p >= fim) throw corrompido();
+            b = *p++;
+            total += b;
+        } while (b == 255);
+        return total;
+    };
+
+    while (p < fim) {
+        uint8_t token = *p++;
+        size_t numLiterais = lerComprimento(token >> 4);
+        if (numLiterais > (size_t)(fim - p) || numLiterais > tamanhoOriginal - escritos) throw corrompido();
+        memcpy(destino + escritos, p, numLiterais);
+        p += numLiterais;
+        escritos += numLiterais;
+        if (p == fim) break;
+
+        if (fim - p < 2) throw corrompido();
+        size_t distancia = p[0] | (p[1] << 8);
+        p += 2;
+        size_t match = lerComprimento(token & 0x0f) + MATCH_MINIMO;
+        if (distancia == 0 || distancia > escritos || match > tamanhoOriginal - escritos) throw corrompido();
+        // Cópia byte a byte: a origem pode sobrepor o destino (repetições curtas)
+        char* saida = destino + escritos;
+        const char* copia = saida - distancia;
+        for (size_t k = 0; k < match; k++) saida[k] = copia[k];
+        escritos += match;
+    }
+    if (escritos != tamanhoOriginal) throw corrompido();
+}
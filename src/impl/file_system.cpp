@@ -6,38 +6,226 @@
 #include "../header/sistema_arquivos.h"
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <ctime>
 #include <functional>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
-FileSystem::FileSystem() {
-    usuarioAtual = 0;
-    grupoAtual = 0;
-    raiz = make_shared<FCB>("/", DIRECTORY, 0, 0, 7, 5, 5, nullptr);
-    raiz->pai = raiz;
-    diretorioAtual = raiz;
+// Constructor
+FileSystem::FileSystem(size_t tamanhoBloco, size_t numBlocos) : disco(tamanhoBloco, numBlocos) {
+    // Cria diretório raiz com permissões 755 (rwxr-xr-x)
+    raiz = inodes.criar("/", DIRECTORY, 0, 0, 7, 5, 5, INODE_NULO);
+    inodes[raiz].pai = raiz; // Pai do root é ele mesmo
+    principal = make_unique<Sessao>(*this); // Usuário inicial é root (UID 0, GID 0), na raiz
+}
+
+FileSystem::FileSystem(const string& caminhoImagem, size_t tamanhoBloco, size_t numBlocos, bool mapear,
+                       bool sobDemanda)
+    : disco(mapear ? unique_ptr<Armazenamento>(ArmazenamentoMmap::abrir(caminhoImagem, tamanhoBloco, numBlocos))
+                   : unique_ptr<Armazenamento>(ArmazenamentoArquivo::abrir(caminhoImagem, tamanhoBloco, numBlocos))),
+      caminhoImagem(caminhoImagem), imagemMapeada(mapear), sobDemanda(sobDemanda) {
+    raiz = inodes.criar("/", DIRECTORY, 0, 0, 7, 5, 5, INODE_NULO);
+    inodes[raiz].pai = raiz;
+    principal = make_unique<Sessao>(*this);
+    // Imagem com árvore gravada: montagem direto da região mapeada
+    if (auto regiao = disco.mapearMetadados()) {
+        if (sobDemanda) {
+            montarSobDemanda(make_unique<ImagemArvore>(move(regiao)));
+        } else {
+            montarArvoreDe(regiao->dados());
+            recalcularOcupacao();
+        }
+    }
+}
+
+FileSystem::~FileSystem() {
+    try {
+        descarregarEscritas();
+        gravarMetadados();
+    } catch (exception& e) {
+        cout << e.what() << endl;
+    }
+}
+
+// ==========================================
+// MODO CONCORRENTE (Req 3.4)
+// ==========================================
+// Guardas da árvore para os comandos públicos. Sem o modo concorrente não
+// travam nada; o modo é lido na construção porque não volta atrás.
+class FileSystem::ArvoreCompartilhada {
+private:
+    FileSystem& fs;
+    bool ativa;
+
+public:
+    explicit ArvoreCompartilhada(FileSystem& fs) : fs(fs), ativa(fs.concorrente) {
+        if (ativa) fs.travaArvore.lock_shared();
+    }
+    ~ArvoreCompartilhada() {
+        if (ativa) fs.travaArvore.unlock_shared();
+    }
+};
+
+class FileSystem::ArvoreExclusiva {
+private:
+    FileSystem& fs;
+    bool ativa;
+
+public:
+    explicit ArvoreExclusiva(FileSystem& fs) : fs(fs), ativa(fs.concorrente) {
+        if (!ativa) return;
+        fs.travaArvore.lock();
+        fs.arvoreExclusiva = true;
+    }
+    ~ArvoreExclusiva() {
+        if (!ativa) return;
+        fs.arvoreExclusiva = false;
+        fs.travaArvore.unlock();
+    }
+};
+
+void FileSystem::ativarConcorrencia() {
+    if (imagemArvore) {
+        carregarTudo(raiz);
+        imagemArvore.reset();
+    }
+    sobDemanda = false;
+    disco.ativarConcorrencia();
+    concorrente = true;
+}
+
+shared_lock<TravaLeitores> FileSystem::lerCaminhos() const {
+    return compartilhando() ? shared_lock<TravaLeitores>(travaCaminhos) : shared_lock<TravaLeitores>();
+}
+
+unique_lock<TravaLeitores> FileSystem::escreverCaminhos() {
+    return compartilhando() ? unique_lock<TravaLeitores>(travaCaminhos) : unique_lock<TravaLeitores>();
 }
 
-bool FileSystem::verificarPermissao(shared_ptr<FCB> arquivo, int permRequerida) {
+unique_lock<mutex> FileSystem::travarPendentes() const {
+    return compartilhando() ? unique_lock<mutex>(travaPendentes) : unique_lock<mutex>();
+}
+
+shared_lock<TravaInode> FileSystem::lerInode(RefInode ref) {
+    return compartilhando() ? shared_lock<TravaInode>(inodes.trava(ref)) : shared_lock<TravaInode>();
+}
+
+unique_lock<TravaInode> FileSystem::escreverInode(RefInode ref) {
+    return compartilhando() ? unique_lock<TravaInode>(inodes.trava(ref)) : unique_lock<TravaInode>();
+}
+
+// Quem acrescenta bytes adiados tem a trava exclusiva do arquivo, então a
+// conferência com a compartilhada vale até soltá-la
+TravaConteudo FileSystem::travarConteudo(RefInode ref) {
+    TravaConteudo trava;
+    trava.leitura = lerInode(ref);
+    if (trava.leitura.owns_lock() && bytesPendentes(ref) > 0) {
+        trava.leitura.unlock();
+        trava.escrita = escreverInode(ref);
+    }
+    return trava;
+}
+
+// Escrita que não muda as tabelas da árvore, só o arquivo: em blocos e
+// continuando em blocos, sem deduplicação (que compara com blocos de outros
+// arquivos). Pode ser feita com a árvore compartilhada e a trava do inode.
+bool FileSystem::escritaNoLugar(RefInode ref, size_t bytes, bool substitui) const {
+    const FCB& f = inodes[ref];
+    if (f.tipo() == DIRECTORY || f.embutido || disco.deduplicacaoAtiva()) return false;
+    // echo > com conteúdo que cabe no inode volta a ser embutido
+    return !(substitui && limiteEmbutido > 0 && bytes <= limiteEmbutido);
+}
+
+// Leitores do mesmo arquivo em paralelo a escrevem juntos (store atômico).
+// A resolução é de segundos: gravar só quando muda evita sujar a linha de
+// cache do FCB nos outros núcleos a cada leitura.
+void FileSystem::registrarAcesso(FCB& arquivo) {
+    uint32_t agora = agoraFS();
+    if (__atomic_load_n(&arquivo.acessadoEm, __ATOMIC_RELAXED) != agora) {
+        __atomic_store_n(&arquivo.acessadoEm, agora, __ATOMIC_RELAXED);
+    }
+}
+
+// Helper: Verifica permissão (Req 3.3 - owner/group/others)
+bool FileSystem::verificarPermissao(const Sessao& s, const FCB& arquivo, int permRequerida) {
     int permEfetiva;
-    if (arquivo->idProprietario == usuarioAtual) {
-        permEfetiva = arquivo->permProprietario;
-    } else if (arquivo->idGrupo == grupoAtual) {
-        permEfetiva = arquivo->permGrupo;
+    
+    // Determina qual conjunto de permissões usar
+    if (arquivo.idProprietario == s.usuario) {
+        permEfetiva = arquivo.permProprietario();  // Owner
+    } else if (arquivo.idGrupo == s.grupo) {
+        permEfetiva = arquivo.permGrupo();  // Group
     } else {
-        permEfetiva = arquivo->permOutros;
+        permEfetiva = arquivo.permOutros();  // Others (public)
     }
+    
+    // Verifica se a permissão requerida está no bitmask
     return (permEfetiva & permRequerida) != 0;
 }
 
+// Req 3.3: dir e todos os diretórios acima dele (a raiz não é conferida,
+// como num caminho absoluto) dão execução ao usuário atual. Sobe até um
+// diretório já conferido nesta geração e marca os do caminho na volta.
+bool FileSystem::podeAtravessar(const Sessao& s, RefInode dir) {
+    vector<RefInode> conferidos;
+    for (RefInode d = dir; d != raiz && !travessiaConferida(s, d); d = inodes[d].pai) {
+        if (!verificarPermissao(s, inodes[d], PERM_EXEC)) return false;
+        conferidos.push_back(d);
+    }
+    for (RefInode d : conferidos) conferirTravessia(s, d);
+    return true;
+}
+
+// Memo da identidade da sessão: com o modo concorrente, sessões da mesma
+// identidade em outros threads consultam e aumentam o mesmo vetor
+bool FileSystem::travessiaConferida(const Sessao& s, RefInode dir) const {
+    auto trava = lerCaminhos();
+    const vector<TravessiaConferida>& memo = *s.travessias;
+    return dir < memo.size() && memo[dir].geracao == geracaoTravessia && memo[dir].inodeId == inodes[dir].inodeId;
+}
+
+void FileSystem::conferirTravessia(const Sessao& s, RefInode dir) {
+    auto trava = escreverCaminhos();
+    vector<TravessiaConferida>& memo = *s.travessias;
+    if (dir >= memo.size()) memo.resize(max<size_t>(dir + 1, memo.size() * 2));
+    memo[dir] = {geracaoTravessia, inodes[dir].inodeId};
+}
+
+// Donos ou permissões mudaram: o memo de travessia de todas as identidades deixa de valer
+void FileSystem::invalidarTravessias() {
+    if (++geracaoTravessia == 0) {
+        for (auto& [identidade, memo] : travessias) memo.clear();
+        geracaoTravessia = 1;
+    }
+}
+
+// Sessão com uid/gid novos passa a usar o memo dessa identidade (root não
+// confere execução: não tem memo)
+void FileSystem::identificar(Sessao& s) {
+    if (s.usuario == 0) {
+        s.travessias = nullptr;
+        return;
+    }
+    auto trava = escreverCaminhos();
+    s.travessias = &travessias[{s.usuario, s.grupo}];
+}
+
+// Utilitário para formatar tempo
 string FileSystem::tempoParaString(time_t t) {
-    struct tm *tm = localtime(&t);
+    struct tm tm;
+    localtime_r(&t, &tm); // Reentrante: ls e stat rodam em paralelo no modo concorrente
     char buf[20];
-    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M", tm);
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M", &tm);
     return string(buf);
 }
 
+// Helper: Converte FileType para string
 string FileSystem::tipoArquivoString(FileType t) {
     switch(t) {
         case DIRECTORY: return "DIR";
@@ -49,6 +237,7 @@ string FileSystem::tipoArquivoString(FileType t) {
     }
 }
 
+// Helper: Converte permissão numérica (0-7) para string rwx
 string FileSystem::permParaStr(int p) {
     string s = "";
     s += (p & PERM_READ)  ? "r" : "-";
@@ -57,931 +246,2098 @@ string FileSystem::permParaStr(int p) {
     return s;
 }
 
-// 3.1 cria diretório como nó da árvore; 3.3 exige w no diretório atual
-void FileSystem::mkdir(string nome) {
-    if (diretorioAtual->filhos.count(nome)) {
-        cout << "Erro: Diretorio ja existe.\n";
-        return;
-    }
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_WRITE)) {
-        cout << "Erro: Permissao negada (Write no diretorio).\n";
-        return;
-    }
-    auto novoDiretorio = make_shared<FCB>(nome, DIRECTORY, usuarioAtual, grupoAtual, 7, 5, 5, diretorioAtual);
-    diretorioAtual->filhos[nome] = novoDiretorio;
-    cout << "Diretorio criado: " << nome << endl;
-}
-
-vector<string> split(const string& s, char delimiter) {
-    vector<string> tokens;
-    string token;
-    for (char c : s) {
-        if (c == delimiter) {
-            if (!token.empty()) {
-                tokens.push_back(token);
-                token.clear();
-            }
-        } else {
-            token += c;
+// ==========================================
+// RESOLUÇÃO DE CAMINHOS (Req 3.1)
+// ==========================================
+// Entra em 'componente' a partir de dir (ou sobe, com ".."): cada diretório
+// atravessado exige execução (root ignora)
+bool FileSystem::atravessar(const Sessao& s, RefInode& dir, string_view componente) {
+    carregarFilhos(dir);
+    if (componente == "..") {
+        if (dir == raiz) return true;
+        RefInode pai = inodes[dir].pai;
+        // Verifica permissão de execução no diretório pai para "atravessar"
+        if (s.usuario != 0 && !verificarPermissao(s, inodes[pai], PERM_EXEC)) {
+            cout << "Erro: Permissao negada (Execute no diretorio pai).\n";
+            return false;
         }
+        dir = pai;
+        return true;
+    }
+    RefInode alvo = inodes.filhos(dir).buscar(inodes, componente);
+    if (alvo == INODE_NULO) {
+        cout << "Erro: Diretorio '" << componente << "' nao encontrado.\n";
+        return false;
+    }
+    if (inodes[alvo].tipo() != DIRECTORY) {
+        cout << "Erro: '" << componente << "' nao e um diretorio.\n";
+        return false;
+    }
+    // Verifica permissão de execução no diretório alvo para entrar (o memo
+    // cresce junto quando tudo acima já foi conferido)
+    if (s.usuario != 0 && !travessiaConferida(s, alvo)) {
+        if (!verificarPermissao(s, inodes[alvo], PERM_EXEC)) {
+            cout << "Erro: Permissao negada (Execute).\n";
+            return false;
+        }
+        if (dir == raiz || travessiaConferida(s, dir)) conferirTravessia(s, alvo);
     }
-    if (!token.empty()) {
-        tokens.push_back(token);
-    }
-    return tokens;
+    dir = alvo;
+    return true;
 }
 
-// 3.1 navegação na árvore; 3.3 exige x nos diretórios atravessados
-void FileSystem::cd(string nome) {
-    shared_ptr<FCB> dir;
-    if (!nome.empty() && nome[0] == '/') {
-        dir = raiz;
-    } else {
-        dir = diretorioAtual;
-    }
-    vector<string> components = split(nome, '/');
-    for (const string& comp : components) {
-        if (comp == "" || comp == ".") {
-            continue;
-        } else if (comp == "..") {
-            if (dir != raiz) {
-                auto pai = dir->pai.lock();
-                if (usuarioAtual != 0 && !verificarPermissao(pai, PERM_EXEC)) {
-                    cout << "Erro: Permissao negada (Execute no diretorio pai).\n";
-                    return;
-                }
-                dir = pai;
-            }
-        } else {
-            if (dir->filhos.count(comp)) {
-                auto alvo = dir->filhos[comp];
-                if (alvo->tipo == DIRECTORY) {
-                    if (usuarioAtual != 0 && !verificarPermissao(alvo, PERM_EXEC)) {
+// Resolve caminho até o último componente ("." e barras repetidas são
+// ignorados). Sem componentes ("/", "."), o próprio diretório de partida;
+// terminado em "..", o diretório alcançado.
+//
+// O cache guarda o resultado pelo caminho absoluto: um acerto pula a busca
+// em cada diretório do caminho, mas a permissão de execução continua sendo
+// conferida subindo do pai até o diretório de partida. Caminhos com ".."
+// sempre percorrem a árvore (o componente antes dele precisa existir).
+Resolucao FileSystem::resolver(Sessao& s, const string& caminho) {
+    acertarSessao(s);
+    Resolucao r;
+    bool absoluto = !caminho.empty() && caminho[0] == '/';
+    RefInode dir = absoluto ? raiz : s.diretorio;
+
+    // Chave: caminho absoluto normalizado; 'ultimo' começa em inicioUltimo
+    string chave = absoluto ? string() : s.caminho;
+    string_view ultimo;
+    size_t inicioUltimo = 0;
+    bool sobe = false;
+    for (size_t i = 0; i < caminho.size();) {
+        size_t fim = min(caminho.find('/', i), caminho.size());
+        string_view comp(caminho.data() + i, fim - i);
+        if (!comp.empty() && comp != ".") {
+            sobe = sobe || comp == "..";
+            chave += '/';
+            chave += comp;
+            ultimo = comp;
+            inicioUltimo = i;
+        }
+        i = fim + 1;
+    }
+    if (ultimo.empty()) {
+        r.alvo = dir;
+        r.pai = inodes[dir].pai;
+        return r;
+    }
+
+    bool usarCache = cacheCaminhosAtivo && !sobe;
+    if (usarCache) {
+        EntradaCaminho e;
+        if (buscarCaminho(chave, e)) {
+            // Cadeia inteira já conferida: nenhuma subida. Senão (caminho
+            // relativo abaixo de um diretório sem execução), só até a partida.
+            if (s.usuario != 0 && !podeAtravessar(s, e.pai)) {
+                for (RefInode d = e.pai; d != dir && d != raiz; d = inodes[d].pai) {
+                    if (!verificarPermissao(s, inodes[d], PERM_EXEC)) {
                         cout << "Erro: Permissao negada (Execute).\n";
-                        return;
+                        return r;
                     }
-                    dir = alvo;
-                } else {
-                    cout << "Erro: '" << comp << "' nao e um diretorio.\n";
-                    return;
                 }
-            } else {
-                cout << "Erro: Diretorio '" << comp << "' nao encontrado.\n";
-                return;
             }
+            contagemCaminhos().acertos++;
+            if (imagemArvore) inodes.dadosDiretorio(e.pai).ultimoUso = ++relogioUso;
+            r.pai = e.pai;
+            r.alvo = e.alvo;
+            r.nome = ultimo;
+            return r;
         }
-    }
-    diretorioAtual = dir;
+        contagemCaminhos().faltas++;
+    }
+
+    for (size_t i = 0; i < inicioUltimo;) {
+        size_t fim = caminho.find('/', i);
+        string_view comp(caminho.data() + i, fim - i);
+        if (!comp.empty() && comp != "." && !atravessar(s, dir, comp)) return r;
+        i = fim + 1;
+    }
+    r.nome = ultimo;
+    if (ultimo == "..") {
+        if (!atravessar(s, dir, ultimo)) return r;
+        r.alvo = dir;
+        r.pai = inodes[dir].pai;
+        return r;
+    }
+    carregarFilhos(dir);
+    r.pai = dir;
+    r.alvo = inodes.filhos(dir).buscar(inodes, ultimo);
+    if (usarCache) guardarCaminho(move(chave), EntradaCaminho{r.pai, r.alvo});
+    return r;
 }
 
-// 3.2 cria FCB com metadados; 3.4 aloca bloco inicial
-void FileSystem::touch(string nome, FileType tipo) {
-    if (diretorioAtual->filhos.count(nome)) {
-        time(&diretorioAtual->filhos[nome]->modificadoEm);
-        return;
-    }
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_WRITE)) {
-        cout << "Erro: Permissao negada (Write no diretorio).\n";
-        return;
-    }
-    auto novoArquivo = make_shared<FCB>(nome, tipo, usuarioAtual, grupoAtual, 6, 4, 4, diretorioAtual);
-    try {
-        novoArquivo->indicesBlocos = disco.alocarBlocos(0); 
-        diretorioAtual->filhos[nome] = novoArquivo;
-        cout << "Arquivo criado: " << nome << " (tipo: " << tipoArquivoString(tipo) << ")\n";
-    } catch (exception& e) {
-        cout << e.what() << endl;
-    }
+// Com a árvore compartilhada (modo concorrente), resoluções buscam no cache
+// em paralelo e guardam uma de cada vez; as mudanças na árvore que apagam
+// entradas (esquecerCaminho) só acontecem com ela exclusiva
+bool FileSystem::buscarCaminho(const string& chave, EntradaCaminho& entrada) {
+    auto trava = lerCaminhos();
+    auto it = cacheCaminhos.find(chave);
+    if (it == cacheCaminhos.end()) return false;
+    entrada = it->second;
+    return true;
 }
 
-// 3.2/3.4 escreve e realoca blocos; 3.3 checa w no arquivo
-void FileSystem::echo(string nome, string conteudo) {
-    if (!diretorioAtual->filhos.count(nome)) {
-        touch(nome);
-    }
-    auto arquivo = diretorioAtual->filhos[nome];
-    if (arquivo->tipo == DIRECTORY) {
-        cout << "Erro: Nao pode escrever em um diretorio.\n";
-        return;
-    }
-    if (!verificarPermissao(arquivo, PERM_WRITE)) {
-        cout << "Erro: Permissao negada (Write).\n";
-        return;
-    }
-    vector<int> oldIndices = arquivo->indicesBlocos;
-    try {
-        vector<int> newIndices = disco.alocarBlocos(conteudo.size());
-        disco.escreverDados(newIndices, conteudo);
-        disco.liberarBlocos(oldIndices);
-        arquivo->indicesBlocos = newIndices;
-        arquivo->tamanho = conteudo.size();
-        time(&arquivo->modificadoEm);
-        cout << "Gravado com sucesso.\n";
-    } catch (exception& e) {
-        cout << e.what() << endl;
-    }
+void FileSystem::guardarCaminho(string chave, EntradaCaminho entrada) {
+    auto trava = escreverCaminhos();
+    if (cacheCaminhos.size() >= (size_t)DENTRY_CACHE_ENTRIES) cacheCaminhos.clear();
+    cacheCaminhos.emplace(move(chave), entrada);
 }
 
-// 3.2 lê conteúdo; 3.3 checa r; 3.4 lê blocos
-void FileSystem::cat(string nome) {
-    if (!diretorioAtual->filhos.count(nome)) {
-        cout << "Erro: Arquivo nao encontrado.\n";
-        return;
-    }
-    auto arquivo = diretorioAtual->filhos[nome];
-    if (arquivo->tipo == DIRECTORY) {
-        cout << "Erro: E um diretorio.\n";
-        return;
+// Caminho absoluto de f no formato das chaves do cache ("/a/b"; vazio na raiz)
+string FileSystem::caminhoDe(RefInode f) const {
+    vector<string_view> partes;
+    for (RefInode p = f; p != raiz; p = inodes[p].pai) partes.push_back(inodes.nome(p));
+    string caminho;
+    for (auto it = partes.rbegin(); it != partes.rend(); ++it) {
+        caminho += '/';
+        caminho += *it;
     }
-    if (!verificarPermissao(arquivo, PERM_READ)) {
-        cout << "Erro: Permissao negada (Read).\n";
-        return;
-    }
-    time(&arquivo->acessadoEm);
-    string conteudo = disco.lerDados(arquivo->indicesBlocos, arquivo->tamanho);
-    cout << conteudo << endl;
+    return caminho;
 }
 
-// 3.1 lista filhos do diretório; 3.3 exige r no diretório
-void FileSystem::ls() {
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_READ)) {
-        cout << "Erro: Permissao negada (Read).\n";
-        return;
-    }
-    cout << left << setw(12) << "PERM"
-         << setw(10) << "TIPO"
-         << setw(8)  << "TAM"
-         << setw(8)  << "UID"
-         << setw(8)  << "GID"
-         << setw(18) << "MODIFICADO"
-         << "NOME" << endl;
-    for (auto const& [chave, val] : diretorioAtual->filhos) {
-        string strPerm = (val->tipo == DIRECTORY) ? "d" : "-";
-        strPerm += permParaStr(val->permProprietario);
-        strPerm += permParaStr(val->permGrupo);
-        strPerm += permParaStr(val->permOutros);
-        cout << left << setw(12) << strPerm
-             << setw(10) << tipoArquivoString(val->tipo)
-             << setw(8)  << val->tamanho
-             << setw(8)  << val->idProprietario
-             << setw(8)  << val->idGrupo
-             << setw(18) << tempoParaString(val->modificadoEm)
-             << val->nome << endl;
-    }
-}
-
-// 3.3 altera permissões no formato octal
-void FileSystem::chmod(string nome, int permOctal) {
-    if (!diretorioAtual->filhos.count(nome)) {
-        cout << "Erro: Arquivo nao encontrado.\n";
-        return;
+// cd bem-sucedido: aplica os componentes de caminho à pilha do caminho
+// atual, sem subir pela árvore (".." desempilha, na raiz fica na raiz)
+void FileSystem::seguirCaminho(Sessao& s, const string& caminho) {
+    if (!caminho.empty() && caminho[0] == '/') {
+        s.caminho.clear();
+        s.inicioComponentes.clear();
+    }
+    for (size_t i = 0; i < caminho.size();) {
+        size_t fim = min(caminho.find('/', i), caminho.size());
+        string_view comp(caminho.data() + i, fim - i);
+        if (comp == "..") {
+            if (!s.inicioComponentes.empty()) {
+                s.caminho.resize(s.inicioComponentes.back());
+                s.inicioComponentes.pop_back();
+            }
+        } else if (!comp.empty() && comp != ".") {
+            s.inicioComponentes.push_back((uint32_t)s.caminho.size());
+            s.caminho += '/';
+            s.caminho += comp;
+        }
+        i = fim + 1;
     }
-    auto arquivo = diretorioAtual->filhos[nome];
-    if (usuarioAtual != 0 && arquivo->idProprietario != usuarioAtual) {
-        cout << "Erro: Apenas o dono pode mudar permissoes.\n";
-        return;
+}
+
+// Pilha refeita subindo pela árvore (um diretório acima do atual mudou de lugar)
+void FileSystem::refazerCaminho(Sessao& s) {
+    s.caminho = caminhoDe(s.diretorio);
+    s.inicioComponentes.clear();
+    for (size_t i = 0; i < s.caminho.size(); i++) {
+        if (s.caminho[i] == '/') s.inicioComponentes.push_back((uint32_t)i);
     }
-    arquivo->permOutros = permOctal % 10;
-    arquivo->permGrupo = (permOctal / 10) % 10;
-    arquivo->permProprietario = (permOctal / 100) % 10;
-    cout << "Permissoes alteradas para " << permOctal << " (";
-    cout << permParaStr(arquivo->permProprietario) << permParaStr(arquivo->permGrupo) << permParaStr(arquivo->permOutros);
-    cout << ")\n";
 }
 
-// Utilitário para remover nó e liberar blocos (usado por rm)
-void FileSystem::removerRecursivo(shared_ptr<FCB> alvo) {
-    if (alvo->tipo == DIRECTORY) {
-        for (auto& [nome, filho] : alvo->filhos) {
-            removerRecursivo(filho);
+// ==========================================
+// SESSÕES (Req 3.1/3.3)
+// ==========================================
+// Sessão nova na raiz. Só o memo da identidade pode precisar de memória
+// (a primeira sessão de cada uid/gid cria o vetor vazio).
+void FileSystem::abrirSessao(Sessao& s) {
+    ArvoreCompartilhada arvore(*this);
+    s.diretorio = raiz;
+    s.idDiretorio = inodes[raiz].inodeId;
+    s.geracaoDiretorios = geracaoDiretorios;
+    s.geracaoMontagem = geracaoMontagem;
+    identificar(s);
+}
+
+// Diretórios saíram da árvore ou mudaram de lugar desde o último comando
+// de s (outra sessão, journal, --lazy): o caminho é refeito a partir do
+// diretório; se ele não está mais na árvore, o mesmo caminho é procurado de
+// novo (o --lazy devolve o diretório descarregado) ou a sessão volta para a
+// raiz. Com a árvore trocada (load, montagem), volta para a raiz.
+void FileSystem::acertarSessao(Sessao& s) {
+    if (s.geracaoDiretorios == geracaoDiretorios && s.geracaoMontagem == geracaoMontagem) return;
+    RefInode dir = raiz;
+    if (s.geracaoMontagem == geracaoMontagem) {
+        dir = inodes.valido(s.diretorio) && inodes[s.diretorio].inodeId == s.idDiretorio ? s.diretorio
+                                                                                          : localizar(s.caminho);
+        if (dir == INODE_NULO) {
+            cout << "Aviso: Diretorio atual '" << s.caminho << "' removido; voltando para /.\n";
+            dir = raiz;
         }
-        alvo->filhos.clear();
     }
-    disco.liberarBlocos(alvo->indicesBlocos);
+    s.geracaoDiretorios = geracaoDiretorios;
+    s.geracaoMontagem = geracaoMontagem;
+    s.diretorio = dir;
+    s.idDiretorio = inodes[dir].inodeId;
+    refazerCaminho(s);
 }
 
-// 3.3 exige w no diretório e (para arquivo) no alvo; suporta -r
-void FileSystem::rm(string nome, bool recursivo) {
-    if (!diretorioAtual->filhos.count(nome)) {
-        cout << "Erro: Nao encontrado.\n";
-        return;
-    }
-    auto alvo = diretorioAtual->filhos[nome];
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_WRITE)) {
-         cout << "Erro: Permissao negada (Write no diretorio).\n";
-         return;
+// Chamado com a árvore exclusiva depois da mudança. A sessão principal é
+// acertada já aqui: ela é de todos os threads que chamam o FileSystem direto.
+void FileSystem::mudaramDiretorios() {
+    geracaoDiretorios++;
+    acertarSessao(*principal);
+}
+
+// Diretório no caminho absoluto ("/a/b"; vazio é a raiz), sem conferir
+// permissões nem imprimir erros; INODE_NULO se algum componente não existe
+RefInode FileSystem::localizar(const string& caminho) {
+    RefInode dir = raiz;
+    for (size_t i = 1; i <= caminho.size();) {
+        size_t fim = min(caminho.find('/', i), caminho.size());
+        carregarFilhos(dir);
+        dir = inodes.filhos(dir).buscar(inodes, string_view(caminho.data() + i, fim - i));
+        if (dir == INODE_NULO || inodes[dir].tipo() != DIRECTORY) return INODE_NULO;
+        i = fim + 1;
+    }
+    return dir;
+}
+
+// Entradas com chave começando por prefixo (contíguas no mapa ordenado)
+void FileSystem::esquecerAbaixo(const string& prefixo) {
+    auto it = cacheCaminhos.lower_bound(prefixo);
+    while (it != cacheCaminhos.end() && it->first.compare(0, prefixo.size(), prefixo) == 0) {
+        it = cacheCaminhos.erase(it);
     }
-    if (alvo->tipo != DIRECTORY && usuarioAtual != 0 && !verificarPermissao(alvo, PERM_WRITE)) {
-        cout << "Erro: Permissao negada (Write no arquivo).\n";
+}
+
+// A árvore muda em f (criado, removido ou movido): sai a entrada do caminho
+// de f (positiva ou negativa) e tudo que foi resolvido através dele
+void FileSystem::esquecerCaminho(RefInode f) {
+    if (cacheCaminhos.empty()) return;
+    string chave = caminhoDe(f);
+    cacheCaminhos.erase(chave);
+    esquecerAbaixo(chave + '/');
+}
+
+void FileSystem::mkdir(Sessao& s, const string& nome) {
+    ArvoreExclusiva arvore(*this);
+    Resolucao r = resolver(s, nome);
+    if (r.pai == INODE_NULO) return;
+    if (r.alvo != INODE_NULO) {
+        cout << "Erro: Diretorio ja existe.\n";
         return;
     }
-    if (alvo->tipo == DIRECTORY) {
-        if (!alvo->filhos.empty() && !recursivo) {
-            cout << "Erro: Diretorio nao esta vazio. Use 'rm -r' para remover recursivamente.\n";
-            return;
-        }
-        removerRecursivo(alvo);
-    } else {
-        disco.liberarBlocos(alvo->indicesBlocos);
+    if (s.usuario != 0 && !verificarPermissao(s, inodes[r.pai], PERM_WRITE)) {
+        cout << "Erro: Permissao negada (Write no diretorio).\n";
+        return;
     }
-    diretorioAtual->filhos.erase(nome);
-    cout << "Removido: " << nome << endl;
+    // Cria novo FCB do tipo Directory com permissões 755 (rwxr-xr-x)
+    RefInode novoDiretorio = inodes.criar(r.nome, DIRECTORY, s.usuario, s.grupo, 7, 5, 5, r.pai);
+    inodes.filhos(r.pai).inserir(inodes, novoDiretorio);
+    esquecerCaminho(novoDiretorio);
+    registrarInode(novoDiretorio);
+    cout << "Diretorio criado: " << nome << endl;
 }
 
-// 3.3 exige w no diretório e no arquivo para renomear/mover
-void FileSystem::mv(string nomeAntigo, string nomeNovo) {
-    if (!diretorioAtual->filhos.count(nomeAntigo)) {
-        cout << "Erro: Arquivo de origem nao encontrado.\n";
+// cd na sessão principal muda o diretório de todos os threads que usam o
+// FileSystem direto: árvore exclusiva. Em outra sessão, só o dela.
+void FileSystem::cd(const string& nome) {
+    ArvoreExclusiva arvore(*this);
+    mudarDiretorio(*principal, nome);
+}
+
+void FileSystem::cd(Sessao& s, const string& nome) {
+    ArvoreCompartilhada arvore(*this);
+    mudarDiretorio(s, nome);
+}
+
+void FileSystem::mudarDiretorio(Sessao& s, const string& nome) {
+    Resolucao r = resolver(s, nome);
+    if (r.pai == INODE_NULO) return;
+    if (r.alvo == INODE_NULO) {
+        cout << "Erro: Diretorio '" << r.nome << "' nao encontrado.\n";
         return;
     }
-    if (diretorioAtual->filhos.count(nomeNovo)) {
-        cout << "Erro: Destino ja existe.\n";
+    if (inodes[r.alvo].tipo() != DIRECTORY) {
+        cout << "Erro: '" << r.nome << "' nao e um diretorio.\n";
         return;
     }
-    auto arquivo = diretorioAtual->filhos[nomeAntigo];
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_WRITE)) {
-         cout << "Erro: Permissao negada (Write no diretorio).\n";
-         return;
-    }
-    if (usuarioAtual != 0 && !verificarPermissao(arquivo, PERM_WRITE)) {
-        cout << "Erro: Permissao negada (Write no arquivo).\n";
+    // Entrar no último componente exige execução (".." já foi verificado ao subir)
+    if (!r.nome.empty() && r.nome != ".." && s.usuario != 0 &&
+        !verificarPermissao(s, inodes[r.alvo], PERM_EXEC)) {
+        cout << "Erro: Permissao negada (Execute).\n";
         return;
     }
-    arquivo->nome = nomeNovo;
-    diretorioAtual->filhos[nomeNovo] = arquivo;
-    diretorioAtual->filhos.erase(nomeAntigo);
-    time(&arquivo->modificadoEm);
-    cout << "Movido/Renomeado de " << nomeAntigo << " para " << nomeNovo << endl;
+    carregarFilhos(r.alvo);
+    s.diretorio = r.alvo;
+    s.idDiretorio = inodes[r.alvo].inodeId;
+    seguirCaminho(s, nome);
+    descarregarFrios(s);
 }
 
-// 3.1/3.4 cópia recursiva de árvore de diretórios preservando metadados
-void copiarDiretorioRecursivo(shared_ptr<FCB> origem, shared_ptr<FCB> destino, int usuarioAtual, int grupoAtual,
-                              function<bool(shared_ptr<FCB>, int)> verificarPermissao) {
-    auto novoDir = make_shared<FCB>(destino->nome, DIRECTORY, usuarioAtual, grupoAtual,
-                                   origem->permProprietario, origem->permGrupo, origem->permOutros, destino->pai);
-    destino->pai.lock()->filhos[destino->nome] = novoDir;
-    for (auto& [nome, filho] : origem->filhos) {
-        if (filho->tipo == DIRECTORY) {
-            auto novoSubDir = make_shared<FCB>(nome, DIRECTORY, filho->idProprietario, filho->idGrupo,
-                                             filho->permProprietario, filho->permGrupo, filho->permOutros, novoDir);
-            copiarDiretorioRecursivo(filho, novoSubDir, usuarioAtual, grupoAtual, verificarPermissao);
-        } else {
-            auto novoArquivo = make_shared<FCB>(nome, filho->tipo, filho->idProprietario, filho->idGrupo,
-                                              filho->permProprietario, filho->permGrupo, filho->permOutros, novoDir);
-            novoArquivo->tamanho = filho->tamanho;
-            novoArquivo->indicesBlocos = filho->indicesBlocos;
-            novoDir->filhos[nome] = novoArquivo;
-        }
-    }
+// Cria arquivo com tipo especificado (Req 3.2: numérico, caractere, binário, programa)
+void FileSystem::touch(Sessao& s, const string& nome, FileType tipo) {
+    ArvoreExclusiva arvore(*this);
+    criarArquivo(s, nome, tipo);
 }
 
-// 3.2/3.3/3.4 copia arquivo ou diretório (recursivo), checando r/w
-void FileSystem::cp(string nomeOrigem, string nomeDestino) {
-    if (!diretorioAtual->filhos.count(nomeOrigem)) {
-        cout << "Erro: Arquivo de origem nao encontrado.\n";
-        return;
-    }
-    if (diretorioAtual->filhos.count(nomeDestino)) {
-        cout << "Erro: Destino ja existe.\n";
-        return;
-    }
-    auto arquivoOrigem = diretorioAtual->filhos[nomeOrigem];
-    if (usuarioAtual != 0 && !verificarPermissao(arquivoOrigem, PERM_READ)) {
-        cout << "Erro: Permissao negada (Read).\n";
+void FileSystem::criarArquivo(Sessao& s, const string& nome, FileType tipo) {
+    Resolucao r = resolver(s, nome);
+    if (r.pai == INODE_NULO) return;
+    if (r.alvo != INODE_NULO) {
+        // Atualiza timestamp se já existe
+        inodes[r.alvo].modificadoEm = agoraFS();
+        registrarInode(r.alvo);
         return;
     }
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_WRITE)) {
+    // Verifica permissão de escrita no diretório pai (root ignora)
+    if (s.usuario != 0 && !verificarPermissao(s, inodes[r.pai], PERM_WRITE)) {
         cout << "Erro: Permissao negada (Write no diretorio).\n";
         return;
     }
-    if (arquivoOrigem->tipo == DIRECTORY) {
-        auto novoDir = make_shared<FCB>(nomeDestino, DIRECTORY, usuarioAtual, grupoAtual,
-                                       arquivoOrigem->permProprietario, arquivoOrigem->permGrupo,
-                                       arquivoOrigem->permOutros, diretorioAtual);
-        copiarDiretorioRecursivo(arquivoOrigem, novoDir, usuarioAtual, grupoAtual,
-                                [this](shared_ptr<FCB> f, int p) { return verificarPermissao(f, p); });
-    } else {
-        string conteudo = disco.lerDados(arquivoOrigem->indicesBlocos, arquivoOrigem->tamanho);
-        touch(nomeDestino, arquivoOrigem->tipo);
-        echo(nomeDestino, conteudo);
+    // Cria arquivo com permissões 644 (rw-r--r--)
+    FCB novo(NOME_NULO, tipo, s.usuario, s.grupo, 6, 4, 4, r.pai);
+    novo.comprimido = compressao && (tipo == TYPE_TEXT || tipo == TYPE_NUMERIC);
+    novo.embutido = limiteEmbutido > 0;
+    RefInode novoArquivo = inodes.criar(move(novo), r.nome);
+    
+    // Aloca 1 bloco inicial vazio (Req 3.4 - Alocação); embutido, nenhum
+    try {
+        if (!inodes[novoArquivo].embutido) inodes.dadosArquivo(novoArquivo).extents = disco.alocarBlocos(0);
+        inodes.filhos(r.pai).inserir(inodes, novoArquivo);
+        esquecerCaminho(novoArquivo);
+        registrarInode(novoArquivo);
+        cout << "Arquivo criado: " << nome << " (tipo: " << tipoArquivoString(tipo) << ")\n";
+    } catch (exception& e) {
+        inodes.liberar(novoArquivo);
+        cout << e.what() << endl;
     }
-    cout << "Copiado de " << nomeOrigem << " para " << nomeDestino << endl;
 }
 
-// 3.2 exibe metadados e blocos (inode simulado)
-void FileSystem::stat(string nome) {
-    if (!diretorioAtual->filhos.count(nome)) {
-        cout << "Erro: Arquivo nao encontrado.\n";
-        return;
+// Falha antes de alterar o arquivo se o disco não comporta a escrita em
+// [offset, offset + n): blocos novos no fim + cópias de blocos compartilhados
+void FileSystem::verificarEspaco(FCB& arquivo, size_t offset, size_t n, size_t blocosFinais) {
+    const vector<Extent>& extents = inodes.dadosArquivo(arquivo).extents;
+    size_t blocosAtuais = totalBlocos(extents);
+    size_t crescimento = blocosFinais > blocosAtuais ? blocosFinais - blocosAtuais : 0;
+    size_t limite = min(offset + n, blocosAtuais * disco.obterTamanhoBloco());
+    size_t copias = limite > offset ? disco.contarCompartilhados(extents, offset, limite - offset) : 0;
+    if (crescimento + copias > disco.blocosLivres()) {
+        throw runtime_error("Erro: Espaco insuficiente no disco virtual.");
     }
-    auto f = diretorioAtual->filhos[nome];
-    cout << "  File: " << f->nome << "\n";
-    cout << "  Size: " << f->tamanho << " bytes\n";
-    cout << " Inode: " << f->inodeId << "\n";
-    cout << "  Type: " << tipoArquivoString(f->tipo) << "\n";
-    cout << "Blocks: [";
-    for(size_t i = 0; i < f->indicesBlocos.size(); i++) {
-        cout << f->indicesBlocos[i];
-        if (i < f->indicesBlocos.size() - 1) cout << ", ";
-    }
-    cout << "]\n";
-    cout << "Access: (" << f->permProprietario << f->permGrupo << f->permOutros << "/";
-    cout << permParaStr(f->permProprietario) << permParaStr(f->permGrupo) << permParaStr(f->permOutros) << ")\n";
-    cout << "   Uid: " << f->idProprietario << "  Gid: " << f->idGrupo << "\n";
-    cout << "Access: " << tempoParaString(f->acessadoEm) << "\n";
-    cout << "Modify: " << tempoParaString(f->modificadoEm) << "\n";
-    cout << " Birth: " << tempoParaString(f->criadoEm) << "\n";
-}
-
-// 3.3 comando exec exige permissão x; simula execução
-void FileSystem::executar(string nome) {
-    if (!diretorioAtual->filhos.count(nome)) {
-        cout << "Erro: Arquivo nao encontrado.\n";
+}
+
+// Toda escrita no conteúdo passa por aqui: blocos compartilhados com outros
+// arquivos (cp) são copiados antes (copy-on-write)
+void FileSystem::escreverNoArquivo(FCB& arquivo, size_t offset, const char* origem, size_t n) {
+    vector<Extent>& extents = inodes.dadosArquivo(arquivo).extents;
+    disco.separarCompartilhados(extents, offset, n);
+    disco.escreverEm(extents, offset, origem, n);
+}
+
+// Escrita posicional: grava 'conteudo' a partir de offset, tocando só os blocos
+// afetados. O arquivo cresce no lugar (último extent) quando passa do fim.
+void FileSystem::gravarArquivo(FCB& arquivo, size_t offset, const string& conteudo) {
+    if (arquivo.embutido) {
+        gravarEmbutido(arquivo, offset, conteudo, false);
         return;
     }
-    auto arquivo = diretorioAtual->filhos[nome];
-    if (arquivo->tipo == DIRECTORY) {
-        cout << "Erro: Nao pode executar um diretorio.\n";
+    if (arquivo.comprimido) {
+        gravarComprimido(arquivo, offset, conteudo, false);
         return;
     }
-    if (!verificarPermissao(arquivo, PERM_EXEC)) {
-        cout << "Erro: Permissao negada (Execute).\n";
+    vector<Extent>& extents = inodes.dadosArquivo(arquivo).extents;
+    size_t tamanhoAtual = arquivo.tamanho;
+    size_t inicio = min(offset, tamanhoAtual);
+    size_t fim = offset + conteudo.size();
+    size_t blocosAtuais = totalBlocos(extents);
+    verificarEspaco(arquivo, inicio, fim - inicio, max(blocosAtuais, disco.blocosPara(fim)));
+
+    if (disco.blocosPara(fim) > blocosAtuais) {
+        disco.estenderExtents(extents, disco.blocosPara(fim) - blocosAtuais);
+    }
+    // Escrita além do fim deixa um "buraco" preenchido com zeros
+    if (offset > tamanhoAtual) {
+        string zeros(offset - tamanhoAtual, '\0');
+        escreverNoArquivo(arquivo, tamanhoAtual, zeros.data(), zeros.size());
+    }
+    escreverNoArquivo(arquivo, offset, conteudo.data(), conteudo.size());
+    if (fim > tamanhoAtual) arquivo.tamanho = fim;
+    disco.deduplicar(extents, inicio, fim - inicio, arquivo.tamanho);
+    arquivo.modificadoEm = agoraFS();
+}
+
+// Ajusta os blocos do arquivo para comportar 'bytes' bytes, alocando ou
+// liberando só a diferença (mínimo de 1 bloco, como no touch)
+void FileSystem::redimensionarBlocos(FCB& arquivo, size_t bytes) {
+    vector<Extent>& extents = inodes.dadosArquivo(arquivo).extents;
+    size_t blocos = max<size_t>(1, disco.blocosPara(bytes));
+    size_t blocosAtuais = totalBlocos(extents);
+    if (blocos > blocosAtuais) {
+        disco.estenderExtents(extents, blocos - blocosAtuais);
+    } else if (blocos < blocosAtuais) {
+        disco.liberarBlocos(disco.cortarExtents(extents, blocos));
+    }
+}
+
+// Ajusta o arquivo para novoTamanho. Bytes após o fim não são lidos;
+// escritas além do fim zeram o intervalo explicitamente (gravarArquivo).
+void FileSystem::redimensionarArquivo(FCB& arquivo, size_t novoTamanho) {
+    redimensionarBlocos(arquivo, novoTamanho);
+    arquivo.tamanho = novoTamanho;
+}
+
+// Escrita em arquivo embutido: o conteúdo novo é montado na memória do inode.
+// Se passar do limite, vai inteiro para blocos (comprimido, se for o caso) e
+// o arquivo deixa de ser embutido; sem espaço, nada muda. 'truncar' descarta
+// o conteúdo atual (echo sem >>).
+void FileSystem::gravarEmbutido(FCB& arquivo, size_t offset, const string& conteudo, bool truncar) {
+    string novo = truncar ? string() : inodes.conteudoEmbutido(arquivo);
+    // Escrita além do fim: o intervalo até offset fica zerado
+    if (novo.size() < offset + conteudo.size()) novo.resize(offset + conteudo.size(), '\0');
+    novo.replace(offset, conteudo.size(), conteudo);
+    arquivo.modificadoEm = agoraFS();
+    if (novo.size() <= limiteEmbutido) {
+        arquivo.tamanho = novo.size();
+        inodes.conteudoEmbutido(arquivo) = move(novo);
         return;
     }
-    if (arquivo->tipo == TYPE_PROGRAM) {
-        cout << "Executando programa: " << arquivo->nome << "\n";
-        cout << "Conteudo do programa seria executado aqui...\n";
-    } else {
-        cout << "Arquivo '" << arquivo->nome << "' executado (tipo: " << tipoArquivoString(arquivo->tipo) << ")\n";
+
+    string anterior = move(inodes.conteudoEmbutido(arquivo));
+    size_t tamanhoAnterior = arquivo.tamanho;
+    inodes.definirEmbutido(arquivo, false);
+    arquivo.tamanho = 0;
+    try {
+        if (arquivo.comprimido) gravarComprimido(arquivo, 0, novo, true);
+        else gravarArquivo(arquivo, 0, novo);
+    } catch (...) {
+        inodes.definirEmbutido(arquivo, true);
+        inodes.conteudoEmbutido(arquivo) = move(anterior);
+        arquivo.tamanho = tamanhoAnterior;
+        throw;
     }
-    time(&arquivo->acessadoEm);
 }
 
-void FileSystem::trocarUsuario(int uid, int gid) {
-    usuarioAtual = uid;
-    if (gid >= 0) grupoAtual = gid;
-    cout << "Usuario alterado para UID: " << usuarioAtual << ", GID: " << grupoAtual << endl;
+// Leitura posicional: até 'tamanho' bytes a partir de offset (limitado ao fim do arquivo)
+string FileSystem::lerArquivo(RefInode ref, size_t offset, size_t tamanho) {
+    FCB& arquivo = inodes[ref];
+    tamanho = min(tamanho, SIZE_MAX - offset); // offset + tamanho sem estourar
+    descarregarEscrita(ref);
+    // Embutido: direto do inode, sem passar pelo disco
+    if (arquivo.embutido) {
+        const string& conteudo = inodes.conteudoEmbutido(arquivo);
+        return offset >= conteudo.size() ? string() : conteudo.substr(offset, tamanho);
+    }
+    anteciparLeitura(arquivo, offset, tamanho);
+    if (arquivo.comprimido) return lerComprimido(arquivo, offset, tamanho);
+    size_t tamanhoArquivo = arquivo.tamanho;
+    if (offset >= tamanhoArquivo) return "";
+    string conteudo(min(tamanho, tamanhoArquivo - offset), '\0');
+    disco.lerEm(inodes.dadosArquivo(arquivo).extents, offset, &conteudo[0], conteudo.size());
+    return conteudo;
 }
 
-void FileSystem::quemSou() {
-    cout << "UID: " << usuarioAtual << ", GID: " << grupoAtual << endl;
+// Escrita em arquivo comprimido: os chunks a partir do primeiro tocado são
+// descomprimidos, alterados, recomprimidos e regravados em sequência; os
+// anteriores ficam intactos (um append só recomprime o último chunk).
+// 'truncar' descarta o conteúdo atual (echo sem >>).
+void FileSystem::gravarComprimido(FCB& arquivo, size_t offset, const string& conteudo, bool truncar) {
+    DadosArquivo& dados = inodes.dadosArquivo(arquivo);
+    size_t tamanhoAtual = truncar ? 0 : arquivo.tamanho;
+    size_t primeiro = min(offset, tamanhoAtual) / TAMANHO_CHUNK;
+    size_t base = primeiro * TAMANHO_CHUNK;
+    string logico = lerComprimido(arquivo, base, tamanhoAtual - base);
+    size_t relativo = offset - base;
+    // Escrita além do fim: o intervalo até offset fica zerado
+    if (logico.size() < relativo + conteudo.size()) logico.resize(relativo + conteudo.size(), '\0');
+    logico.replace(relativo, conteudo.size(), conteudo);
+
+    // Monta a nova tabela de chunks antes de tocar no arquivo: se faltar
+    // espaço, o erro acontece sem nenhuma alteração
+    vector<ChunkComprimido> chunks(dados.chunks.begin(), dados.chunks.begin() + primeiro);
+    size_t inicioGravacao = chunks.empty() ? 0 : chunks.back().offset + chunks.back().tamanho;
+    string armazenado;
+    for (size_t pos = 0; pos < logico.size(); pos += TAMANHO_CHUNK) {
+        size_t n = min(TAMANHO_CHUNK, logico.size() - pos);
+        string comprimido = comprimirLZ(logico.data() + pos, n);
+        bool bruto = comprimido.size() >= n;
+        chunks.push_back({(uint32_t)(inicioGravacao + armazenado.size()), (uint32_t)(bruto ? n : comprimido.size()), bruto});
+        if (bruto) armazenado.append(logico, pos, n);
+        else armazenado += comprimido;
+    }
+    size_t fimArmazenado = inicioGravacao + armazenado.size();
+    // Os offsets dos chunks são de 32 bits (FCB, journal e imagem compacta)
+    if (fimArmazenado > UINT32_MAX) {
+        throw runtime_error("Erro: Arquivo comprimido excede 4 GiB armazenados.");
+    }
+    verificarEspaco(arquivo, inicioGravacao, armazenado.size(), max<size_t>(1, disco.blocosPara(fimArmazenado)));
+
+    redimensionarBlocos(arquivo, fimArmazenado);
+    escreverNoArquivo(arquivo, inicioGravacao, armazenado.data(), armazenado.size());
+    dados.chunks = move(chunks);
+    arquivo.tamanho = base + logico.size();
+    disco.deduplicar(dados.extents, inicioGravacao, armazenado.size(), fimArmazenado);
+    arquivo.modificadoEm = agoraFS();
 }
 
-string FileSystem::obterCaminho() {
-    if (diretorioAtual == raiz) return "/";
-    vector<string> partes;
-    shared_ptr<FCB> atual = diretorioAtual;
-    while (atual != raiz) {
-        partes.push_back(atual->nome);
-        auto paiPtr = atual->pai.lock();
-        if (!paiPtr || paiPtr == atual) break;
-        atual = paiPtr;
-    }
-    string caminho = "";
-    for (int i = partes.size() - 1; i >= 0; i--) {
-        caminho += "/" + partes[i];
+// Leitura em arquivo comprimido: só os chunks que cobrem [offset, offset + tamanho)
+// são lidos do disco; chunks guardados sem compressão são lidos só na fatia pedida
+string FileSystem::lerComprimido(FCB& arquivo, size_t offset, size_t tamanho) {
+    const DadosArquivo& dados = inodes.dadosArquivo(arquivo);
+    size_t tamanhoArquivo = arquivo.tamanho;
+    size_t fim = min(offset + tamanho, tamanhoArquivo);
+    string saida;
+    if (offset >= fim) return saida;
+    saida.reserve(fim - offset);
+    string armazenado, chunk;
+    for (size_t c = offset / TAMANHO_CHUNK; c * TAMANHO_CHUNK < fim; c++) {
+        const ChunkComprimido& info = dados.chunks[c];
+        size_t inicioChunk = c * TAMANHO_CHUNK;
+        size_t de = max(offset, inicioChunk) - inicioChunk;
+        size_t ate = min(fim, inicioChunk + TAMANHO_CHUNK) - inicioChunk;
+        if (info.bruto) {
+            size_t antes = saida.size();
+            saida.resize(antes + ate - de);
+            disco.lerEm(dados.extents, info.offset + de, &saida[antes], ate - de);
+            continue;
+        }
+        armazenado.resize(info.tamanho);
+        disco.lerEm(dados.extents, info.offset, &armazenado[0], info.tamanho);
+        chunk.resize(min(TAMANHO_CHUNK, tamanhoArquivo - inicioChunk));
+        descomprimirLZ(armazenado.data(), armazenado.size(), &chunk[0], chunk.size());
+        saida.append(chunk, de, ate - de);
     }
-    return caminho.empty() ? "/" : caminho;
+    return saida;
 }
 
-#include "../header/sistema_arquivos.h"
-#include <iostream>
-#include <iomanip>
-#include <ctime>
-#include <functional>
+// Readahead adaptativo: uma leitura que começa no início do arquivo ou onde a
+// anterior terminou é sequencial e dobra a janela (até READAHEAD_MAX_BLOCKS);
+// qualquer outra zera a janela. O disco recebe o trecho pedido mais a janela
+// de uma vez, o que vira leituras contíguas grandes no backend.
+// Leitores do mesmo arquivo em paralelo (modo concorrente) atualizam a
+// janela sem trava, com loads e stores atômicos: ela é só uma estimativa.
+void FileSystem::anteciparLeitura(FCB& arquivo, size_t offset, size_t tamanho) {
+    size_t tamanhoArquivo = arquivo.tamanho;
+    if (offset >= tamanhoArquivo || tamanho == 0) return;
+    size_t fim = min(offset + tamanho, tamanhoArquivo);
+    DadosArquivo& dados = inodes.dadosArquivo(arquivo);
+    uint32_t janela = __atomic_load_n(&dados.janelaLeitura, __ATOMIC_RELAXED);
+    bool sequencial = offset == 0 || offset == __atomic_load_n(&dados.fimUltimaLeitura, __ATOMIC_RELAXED);
+    if (!sequencial) janela = 0;
+    else if (janela == 0) janela = READAHEAD_MIN_BLOCKS;
+    else janela = min<uint32_t>(janela * 2, READAHEAD_MAX_BLOCKS);
+    __atomic_store_n(&dados.janelaLeitura, janela, __ATOMIC_RELAXED);
+    __atomic_store_n(&dados.fimUltimaLeitura, (uint64_t)fim, __ATOMIC_RELAXED);
+    size_t alem = min(fim + janela * disco.obterTamanhoBloco(), tamanhoArquivo);
+
+    if (arquivo.comprimido) {
+        // Em arquivos comprimidos, a faixa armazenada dos chunks envolvidos
+        const ChunkComprimido& primeiro = dados.chunks[offset / TAMANHO_CHUNK];
+        const ChunkComprimido& ultimo = dados.chunks[(alem - 1) / TAMANHO_CHUNK];
+        disco.anteciparLeitura(dados.extents, primeiro.offset, ultimo.offset + ultimo.tamanho - primeiro.offset);
+        return;
+    }
+    disco.anteciparLeitura(dados.extents, offset, alem - offset);
+}
 
-using namespace std;
+// Bytes de 'echo >>' ainda não gravados no arquivo
+size_t FileSystem::bytesPendentes(RefInode ref) const {
+    if (!inodes[ref].adiado) return 0;
+    auto trava = travarPendentes();
+    auto it = escritasPendentes.find(ref);
+    return it == escritasPendentes.end() ? 0 : it->second.dados.size();
+}
 
-// Constructor
-FileSystem::FileSystem() {
-    usuarioAtual = 0;  // Usuário inicial é root (UID 0)
-    grupoAtual = 0;    // Grupo inicial é root (GID 0)
-    // Cria diretório raiz com permissões 755 (rwxr-xr-x)
-    raiz = make_shared<FCB>("/", DIRECTORY, 0, 0, 7, 5, 5, nullptr);
-    raiz->pai = raiz; // Pai do root é ele mesmo
-    diretorioAtual = raiz;
+// Blocos que anexar 'bytes' ao arquivo pode consumir: os novos no fim mais a
+// cópia (copy-on-write) dos blocos compartilhados que a escrita reescreve.
+// Com deduplicação, uma escrita em outro arquivo pode passar a compartilhar
+// esses blocos antes da descarga: a cópia de todos eles fica reservada.
+size_t FileSystem::blocosParaAnexar(FCB& arquivo, size_t bytes) {
+    const DadosArquivo& dados = inodes.dadosArquivo(arquivo);
+    size_t inicio = arquivo.tamanho;
+    size_t fim = inicio + bytes;
+    if (arquivo.comprimido && !dados.chunks.empty()) {
+        // O último chunk é recomprimido junto; no pior caso nada comprime
+        inicio = dados.chunks.back().offset;
+        fim = inicio + (arquivo.tamanho - (dados.chunks.size() - 1) * TAMANHO_CHUNK) + bytes;
+    }
+    size_t atuais = totalBlocos(dados.extents);
+    size_t novos = disco.blocosPara(fim) > atuais ? disco.blocosPara(fim) - atuais : 0;
+    if (disco.deduplicacaoAtiva()) {
+        size_t limite = min(fim, atuais * disco.obterTamanhoBloco());
+        return novos + (limite > inicio ? disco.blocosPara(limite) - inicio / disco.obterTamanhoBloco() : 0);
+    }
+    return novos + disco.contarCompartilhados(dados.extents, inicio, fim - inicio);
 }
 
-// Helper: Verifica permissão (Req 3.3 - owner/group/others)
-bool FileSystem::verificarPermissao(shared_ptr<FCB> arquivo, int permRequerida) {
-    int permEfetiva;
-    
-    // Determina qual conjunto de permissões usar
-    if (arquivo->idProprietario == usuarioAtual) {
-        permEfetiva = arquivo->permProprietario;  // Owner
-    } else if (arquivo->idGrupo == grupoAtual) {
-        permEfetiva = arquivo->permGrupo;  // Group
-    } else {
-        permEfetiva = arquivo->permOutros;  // Others (public)
+// Alocação atrasada: 'echo >>' só acumula os bytes em memória e reserva os blocos
+// que vão ser necessários (o erro de espaço acontece aqui, não depois). Os
+// blocos são escolhidos quando a escrita é descarregada, todos de uma vez:
+// uma rajada de appends fica contígua mesmo intercalada com outros arquivos.
+// Arquivo embutido não tem blocos a escolher: o append vai direto para o inode
+// (e para blocos, se passar do limite).
+void FileSystem::adiarEscrita(RefInode ref, const string& conteudo) {
+    FCB& arquivo = inodes[ref];
+    if (arquivo.embutido) {
+        gravarEmbutido(arquivo, arquivo.tamanho, conteudo, false);
+        registrarInode(ref);
+        return;
     }
-    
-    // Verifica se a permissão requerida está no bitmask
-    return (permEfetiva & permRequerida) != 0;
+    // O mapa é de todos os arquivos, mas a entrada de ref só muda com a trava
+    // exclusiva de ref: basta travá-lo enquanto ele é percorrido
+    auto trava = travarPendentes();
+    auto it = escritasPendentes.find(ref);
+    size_t pendentes = it == escritasPendentes.end() ? 0 : it->second.dados.size();
+    size_t reservados = it == escritasPendentes.end() ? 0 : it->second.blocosReservados;
+    size_t necessarios = blocosParaAnexar(arquivo, pendentes + conteudo.size());
+    if (necessarios > reservados) disco.reservarBlocos(necessarios - reservados);
+    EscritaAdiada& escrita = escritasPendentes[ref];
+    escrita.blocosReservados = max(necessarios, reservados);
+    escrita.dados += conteudo;
+    arquivo.adiado = true;
+    bool cheia = escrita.dados.size() >= (size_t)DELAYED_WRITE_BYTES;
+    if (trava) trava.unlock();
+    marcarModificado(ref);
+    arquivo.modificadoEm = agoraFS();
+    if (cheia) descarregarEscrita(ref);
 }
 
-// Utilitário para formatar tempo
-string FileSystem::tempoParaString(time_t t) {
-    struct tm *tm = localtime(&t);
-    char buf[20];
-    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M", tm);
-    return string(buf);
+// Grava os bytes adiados no fim do arquivo. Chamado antes de qualquer acesso
+// ao conteúdo ou aos blocos do arquivo (leitura, pwrite, stat, cp, sync, df).
+// A entrada só sai do mapa depois que a gravação dá certo: se ela falhar, os
+// bytes continuam pendentes e a reserva é devolvida.
+void FileSystem::descarregarEscrita(RefInode ref) {
+    auto trava = travarPendentes();
+    auto it = escritasPendentes.find(ref);
+    if (it == escritasPendentes.end()) return;
+    // Nós do map não mudam de lugar, e só quem tem a trava exclusiva de ref
+    // altera ou apaga esta entrada
+    EscritaAdiada& escrita = it->second;
+    FCB& arquivo = inodes[ref];
+    // Reserva que voltou incompleta de uma falha anterior é completada antes
+    size_t necessarios = blocosParaAnexar(arquivo, escrita.dados.size());
+    if (necessarios > escrita.blocosReservados) {
+        disco.reservarBlocos(necessarios - escrita.blocosReservados);
+        escrita.blocosReservados = necessarios;
+    }
+    // A gravação usa os blocos reservados
+    disco.cancelarReserva(escrita.blocosReservados);
+    if (trava) trava.unlock();
+    try {
+        gravarArquivo(arquivo, arquivo.tamanho, escrita.dados);
+    } catch (...) {
+        if (trava.mutex()) trava.lock();
+        escrita.blocosReservados = disco.reservarDisponiveis(escrita.blocosReservados);
+        throw;
+    }
+    if (trava.mutex()) trava.lock();
+    escritasPendentes.erase(it);
+    arquivo.adiado = false;
+    if (trava) trava.unlock();
+    registrarInode(ref);
 }
 
-// Helper: Converte FileType para string
-string FileSystem::tipoArquivoString(FileType t) {
-    switch(t) {
-        case DIRECTORY: return "DIR";
-        case TYPE_TEXT: return "TEXT";
-        case TYPE_NUMERIC: return "NUMERIC";
-        case TYPE_BINARY: return "BINARY";
-        case TYPE_PROGRAM: return "PROGRAM";
-        default: return "UNKNOWN";
-    }
+// Esquece os bytes adiados e devolve a reserva (echo sem >>, rm)
+void FileSystem::descartarEscrita(RefInode ref) {
+    auto trava = travarPendentes();
+    auto it = escritasPendentes.find(ref);
+    if (it == escritasPendentes.end()) return;
+    disco.cancelarReserva(it->second.blocosReservados);
+    escritasPendentes.erase(it);
+    inodes[ref].adiado = false;
 }
 
-// Helper: Converte permissão numérica (0-7) para string rwx
-string FileSystem::permParaStr(int p) {
-    string s = "";
-    s += (p & PERM_READ)  ? "r" : "-";
-    s += (p & PERM_WRITE) ? "w" : "-";
-    s += (p & PERM_EXEC)  ? "x" : "-";
-    return s;
+void FileSystem::descarregarEscritas() {
+    while (!escritasPendentes.empty()) descarregarEscrita(escritasPendentes.begin()->first);
 }
 
-void FileSystem::mkdir(string nome) {
-    if (diretorioAtual->filhos.count(nome)) {
-        cout << "Erro: Diretorio ja existe.\n";
-        return;
+// Escrever no arquivo (Simula: echo "conteudo" > arquivo, ou >> com anexar)
+void FileSystem::echo(Sessao& s, const string& nome, const string& conteudo, bool anexar) {
+    // Modo concorrente: arquivo em blocos que já existe é reescrito só com a
+    // própria trava; criar o arquivo ou embutir o conteúdo mexe na árvore
+    if (concorrente) {
+        ArvoreCompartilhada arvore(*this);
+        Resolucao r = resolver(s, nome);
+        if (r.pai == INODE_NULO) return;
+        if (r.alvo != INODE_NULO && escritaNoLugar(r.alvo, conteudo.size(), !anexar)) {
+            auto trava = escreverInode(r.alvo);
+            escreverConteudo(s, r.alvo, conteudo, anexar);
+            return;
+        }
     }
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_WRITE)) {
-        cout << "Erro: Permissao negada (Write no diretorio).\n";
-        return;
+    ArvoreExclusiva arvore(*this);
+    Resolucao r = resolver(s, nome);
+    if (r.pai == INODE_NULO) return;
+    RefInode ref = r.alvo;
+    if (ref == INODE_NULO) {
+        criarArquivo(s, nome, TYPE_TEXT); // Cria se não existe
+        ref = resolver(s, nome).alvo;
+        if (ref == INODE_NULO) return; // touch já relatou o erro
     }
-    // Cria novo FCB do tipo Directory com permissões 755 (rwxr-xr-x)
-    auto novoDiretorio = make_shared<FCB>(nome, DIRECTORY, usuarioAtual, grupoAtual, 7, 5, 5, diretorioAtual);
-    diretorioAtual->filhos[nome] = novoDiretorio;
-    cout << "Diretorio criado: " << nome << endl;
+    escreverConteudo(s, ref, conteudo, anexar);
 }
 
-// Helper: Split string by delimiter
-vector<string> split(const string& s, char delimiter) {
-    vector<string> tokens;
-    string token;
-    for (char c : s) {
-        if (c == delimiter) {
-            if (!token.empty()) {
-                tokens.push_back(token);
-                token.clear();
-            }
-        } else {
-            token += c;
-        }
+void FileSystem::escreverConteudo(Sessao& s, RefInode ref, const string& conteudo, bool anexar) {
+    FCB& arquivo = inodes[ref];
+    if (arquivo.tipo() == DIRECTORY) {
+        cout << "Erro: Nao pode escrever em um diretorio.\n";
+        return;
     }
-    if (!token.empty()) {
-        tokens.push_back(token);
+
+    // Req 3.3: Checa permissão de Escrita
+    if (!verificarPermissao(s, arquivo, PERM_WRITE)) {
+        cout << "Erro: Permissao negada (Write).\n";
+        return;
     }
-    return tokens;
-}
 
-void FileSystem::cd(string nome) {
-    shared_ptr<FCB> dir;
-    if (!nome.empty() && nome[0] == '/') {
-        dir = raiz;
-    } else {
-        dir = diretorioAtual;
+    // Modo append: os bytes esperam na memória (alocação atrasada)
+    if (anexar) {
+        try {
+            adiarEscrita(ref, conteudo);
+            cout << "Gravado com sucesso.\n";
+        } catch (exception& e) {
+            cout << e.what() << endl;
+        }
+        return;
     }
-    vector<string> components = split(nome, '/');
-    for (const string& comp : components) {
-        if (comp == "" || comp == ".") {
-            continue;
-        } else if (comp == "..") {
-            if (dir != raiz) {
-                auto pai = dir->pai.lock();
-                // Verifica permissão de execução no diretório pai para "atravessar"
-                if (usuarioAtual != 0 && !verificarPermissao(pai, PERM_EXEC)) {
-                    cout << "Erro: Permissao negada (Execute no diretorio pai).\n";
-                    return;
-                }
-                dir = pai;
-            }
-        } else {
-            if (dir->filhos.count(comp)) {
-                auto alvo = dir->filhos[comp];
-                if (alvo->tipo == DIRECTORY) {
-                    // Verifica permissão de execução no diretório alvo para entrar
-                    if (usuarioAtual != 0 && !verificarPermissao(alvo, PERM_EXEC)) {
-                        cout << "Erro: Permissao negada (Execute).\n";
-                        return;
-                    }
-                    dir = alvo;
-                } else {
-                    cout << "Erro: '" << comp << "' nao e um diretorio.\n";
-                    return;
-                }
-            } else {
-                cout << "Erro: Diretorio '" << comp << "' nao encontrado.\n";
-                return;
-            }
+
+    // Req 3.4: Reescrita no lugar. Os blocos atuais são reaproveitados; só a
+    // diferença é alocada (arquivo cresce) ou liberada (arquivo encolhe).
+    // Se faltar espaço, o erro acontece antes de qualquer alteração.
+    try {
+        descartarEscrita(ref); // Conteúdo substituído: appends pendentes não valem mais
+        // Conteúdo que cabe no inode volta a ser embutido (os blocos são liberados)
+        if (limiteEmbutido > 0 && conteudo.size() <= limiteEmbutido && !arquivo.embutido) {
+            disco.liberarBlocos(inodes.dadosArquivo(arquivo).extents);
+            inodes.definirEmbutido(arquivo, true);
+        }
+        if (arquivo.embutido) {
+            gravarEmbutido(arquivo, 0, conteudo, true);
+            registrarInode(ref);
+            cout << "Gravado com sucesso.\n";
+            return;
+        }
+        if (arquivo.comprimido) {
+            gravarComprimido(arquivo, 0, conteudo, true);
+            registrarInode(ref);
+            cout << "Gravado com sucesso.\n";
+            return;
         }
+        verificarEspaco(arquivo, 0, conteudo.size(), max<size_t>(1, disco.blocosPara(conteudo.size())));
+        redimensionarArquivo(arquivo, conteudo.size());
+        escreverNoArquivo(arquivo, 0, conteudo.data(), conteudo.size());
+        disco.deduplicar(inodes.dadosArquivo(arquivo).extents, 0, conteudo.size(), arquivo.tamanho);
+        arquivo.modificadoEm = agoraFS();
+        registrarInode(ref);
+        cout << "Gravado com sucesso.\n";
+    } catch (exception& e) {
+        cout << e.what() << endl;
     }
-    diretorioAtual = dir;
 }
 
-// Cria arquivo com tipo especificado (Req 3.2: numérico, caractere, binário, programa)
-void FileSystem::touch(string nome, FileType tipo) {
-    if (diretorioAtual->filhos.count(nome)) {
-        // Atualiza timestamp se já existe
-        time(&diretorioAtual->filhos[nome]->modificadoEm);
+// Ler arquivo (cat)
+void FileSystem::cat(Sessao& s, const string& nome) {
+    ArvoreCompartilhada arvore(*this);
+    Resolucao r = resolver(s, nome);
+    if (r.pai == INODE_NULO) return;
+    RefInode ref = r.alvo;
+    if (ref == INODE_NULO) {
+        cout << "Erro: Arquivo nao encontrado.\n";
         return;
     }
-    // Verifica permissão de escrita no diretório atual (root ignora)
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_WRITE)) {
-        cout << "Erro: Permissao negada (Write no diretorio).\n";
+    FCB& arquivo = inodes[ref];
+    
+    if (arquivo.tipo() == DIRECTORY) {
+        cout << "Erro: E um diretorio.\n";
+        return;
+    }
+
+    // Req 3.3: Checa permissão de Leitura
+    if (!verificarPermissao(s, arquivo, PERM_READ)) {
+        cout << "Erro: Permissao negada (Read).\n";
         return;
     }
-    // Cria arquivo com permissões 644 (rw-r--r--)
-    auto novoArquivo = make_shared<FCB>(nome, tipo, usuarioAtual, grupoAtual, 6, 4, 4, diretorioAtual);
-    
-    // Aloca 1 bloco inicial vazio (Req 3.4 - Alocação)
+
+    // Atualiza data de acesso (Req 3.2)
+    TravaConteudo trava = travarConteudo(ref);
+    registrarAcesso(arquivo);
+
+    // Req 3.4: Busca dados dos blocos (segmentos sem cópia, direto do disco para a saída)
+    // Arquivos embutidos (sem blocos), comprimidos ou disco atrás do cache: leitura com cópia
     try {
-        novoArquivo->indicesBlocos = disco.alocarBlocos(0); 
-        diretorioAtual->filhos[nome] = novoArquivo;
-        cout << "Arquivo criado: " << nome << " (tipo: " << tipoArquivoString(tipo) << ")\n";
+        descarregarEscrita(ref); // Antes de ler o tamanho: appends adiados entram nele
+        if (arquivo.embutido || arquivo.comprimido || !disco.acessoDireto()) {
+            cout << lerArquivo(ref, 0, arquivo.tamanho) << endl;
+            return;
+        }
+        anteciparLeitura(arquivo, 0, arquivo.tamanho);
     } catch (exception& e) {
         cout << e.what() << endl;
+        return;
+    }
+    for (string_view segmento : disco.lerSegmentos(inodes.dadosArquivo(arquivo).extents, arquivo.tamanho)) {
+        cout.write(segmento.data(), segmento.size());
     }
+    cout << endl;
 }
 
-// Escrever no arquivo (Simula: echo "conteudo" > arquivo)
-void FileSystem::echo(string nome, string conteudo) {
-    if (!diretorioAtual->filhos.count(nome)) {
-        touch(nome); // Cria se não existe
+// pwrite: escreve no offset indicado sem reescrever o restante do arquivo
+void FileSystem::escreverEm(Sessao& s, const string& nome, size_t offset, const string& conteudo) {
+    // Modo concorrente: em blocos, só com a trava do arquivo (como no echo)
+    if (concorrente) {
+        ArvoreCompartilhada arvore(*this);
+        Resolucao r = resolver(s, nome);
+        if (r.pai == INODE_NULO) return;
+        if (r.alvo != INODE_NULO && escritaNoLugar(r.alvo, conteudo.size(), false)) {
+            auto trava = escreverInode(r.alvo);
+            escreverPosicao(s, r.alvo, offset, conteudo);
+            return;
+        }
     }
-    
-    auto arquivo = diretorioAtual->filhos[nome];
-    if (arquivo->tipo == DIRECTORY) {
-        cout << "Erro: Nao pode escrever em um diretorio.\n";
+    ArvoreExclusiva arvore(*this);
+    Resolucao r = resolver(s, nome);
+    if (r.pai == INODE_NULO) return;
+    if (r.alvo == INODE_NULO) {
+        cout << "Erro: Arquivo nao encontrado.\n";
         return;
     }
+    escreverPosicao(s, r.alvo, offset, conteudo);
+}
 
-    // Req 3.3: Checa permissão de Escrita
-    if (!verificarPermissao(arquivo, PERM_WRITE)) {
+void FileSystem::escreverPosicao(Sessao& s, RefInode ref, size_t offset, const string& conteudo) {
+    FCB& arquivo = inodes[ref];
+    if (arquivo.tipo() == DIRECTORY) {
+        cout << "Erro: Nao pode escrever em um diretorio.\n";
+        return;
+    }
+    if (!verificarPermissao(s, arquivo, PERM_WRITE)) {
         cout << "Erro: Permissao negada (Write).\n";
         return;
     }
-
-    // Req 3.4: Realocação de blocos
-    // 1. Tenta alocar novos blocos antes de liberar os antigos
-    vector<int> oldIndices = arquivo->indicesBlocos;
-    
     try {
-        // 2. Aloca novos blocos baseados no tamanho do conteúdo
-        vector<int> newIndices = disco.alocarBlocos(conteudo.size());
-        
-        // 3. Escreve no "disco"
-        disco.escreverDados(newIndices, conteudo);
-        
-        // 4. Libera blocos antigos e atualiza FCB
-        disco.liberarBlocos(oldIndices);
-        arquivo->indicesBlocos = newIndices;
-        arquivo->tamanho = conteudo.size();
-        time(&arquivo->modificadoEm);
+        descarregarEscrita(ref);
+        // O fim da escrita não pode passar da capacidade do disco (nem do
+        // tamanho atual, se um arquivo comprimido já passou dela): offsets
+        // enormes ("-1") estourariam as somas com offset adiante
+        size_t limite = max((size_t)disco.obterNumBlocos() * disco.obterTamanhoBloco(), (size_t)arquivo.tamanho);
+        if (conteudo.size() > limite || offset > limite - conteudo.size()) {
+            throw runtime_error("Erro: Offset invalido.");
+        }
+        gravarArquivo(arquivo, offset, conteudo);
+        registrarInode(ref);
         cout << "Gravado com sucesso.\n";
     } catch (exception& e) {
         cout << e.what() << endl;
     }
 }
 
-// Ler arquivo (cat)
-void FileSystem::cat(string nome) {
-    if (!diretorioAtual->filhos.count(nome)) {
+// pread: lê 'tamanho' bytes a partir do offset indicado
+void FileSystem::lerEm(Sessao& s, const string& nome, size_t offset, size_t tamanho) {
+    ArvoreCompartilhada arvore(*this);
+    Resolucao r = resolver(s, nome);
+    if (r.pai == INODE_NULO) return;
+    RefInode ref = r.alvo;
+    if (ref == INODE_NULO) {
         cout << "Erro: Arquivo nao encontrado.\n";
         return;
     }
-    auto arquivo = diretorioAtual->filhos[nome];
-    
-    if (arquivo->tipo == DIRECTORY) {
+    FCB& arquivo = inodes[ref];
+    if (arquivo.tipo() == DIRECTORY) {
         cout << "Erro: E um diretorio.\n";
         return;
     }
-
-    // Req 3.3: Checa permissão de Leitura
-    if (!verificarPermissao(arquivo, PERM_READ)) {
+    if (!verificarPermissao(s, arquivo, PERM_READ)) {
         cout << "Erro: Permissao negada (Read).\n";
         return;
     }
-
-    // Atualiza data de acesso (Req 3.2)
-    time(&arquivo->acessadoEm);
-
-    // Req 3.4: Busca dados dos blocos
-    string conteudo = disco.lerDados(arquivo->indicesBlocos, arquivo->tamanho);
-    cout << conteudo << endl;
+    TravaConteudo trava = travarConteudo(ref);
+    registrarAcesso(arquivo);
+    try {
+        cout << lerArquivo(ref, offset, tamanho) << endl;
+    } catch (exception& e) {
+        cout << e.what() << endl;
+    }
 }
 
-void FileSystem::ls() {
-    // Verifica permissão de leitura no diretório atual (root ignora)
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_READ)) {
+void FileSystem::ls(Sessao& s, const string& nome) {
+    ArvoreCompartilhada arvore(*this);
+    acertarSessao(s);
+    RefInode dir = s.diretorio;
+    if (!nome.empty()) {
+        Resolucao r = resolver(s, nome);
+        if (r.pai == INODE_NULO) return;
+        if (r.alvo == INODE_NULO) {
+            cout << "Erro: Diretorio '" << nome << "' nao encontrado.\n";
+            return;
+        }
+        if (inodes[r.alvo].tipo() != DIRECTORY) {
+            cout << "Erro: '" << nome << "' nao e um diretorio.\n";
+            return;
+        }
+        dir = r.alvo;
+        carregarFilhos(dir);
+    }
+    // Verifica permissão de leitura no diretório (root ignora)
+    if (s.usuario != 0 && !verificarPermissao(s, inodes[dir], PERM_READ)) {
         cout << "Erro: Permissao negada (Read).\n";
         return;
     }
 
-    cout << left << setw(12) << "PERM"
-         << setw(10) << "TIPO"
-         << setw(8)  << "TAM"
-         << setw(8)  << "UID"
-         << setw(8)  << "GID"
-         << setw(18) << "MODIFICADO"
-         << "NOME" << endl;
-
-    for (auto const& [chave, val] : diretorioAtual->filhos) {
+    // Listagem montada à parte e escrita de uma vez: no modo concorrente, o
+    // formato (setw, left) não é o do cout, que outros threads usam junto
+    ostringstream saida;
+    saida << left << setw(12) << "PERM"
+          << setw(10) << "TIPO"
+          << setw(8)  << "TAM"
+          << setw(8)  << "UID"
+          << setw(8)  << "GID"
+          << setw(18) << "MODIFICADO"
+          << "NOME" << '\n';
+
+    // Visão ordenada por nome, montada só aqui (e reaproveitada até a próxima
+    // mudança): no modo concorrente, com a trava exclusiva do diretório
+    auto trava = escreverInode(dir);
+    for (RefInode ref : inodes.filhos(dir).emOrdem(inodes)) {
+        auto travaFilho = lerInode(ref);
+        const FCB* val = &inodes[ref];
         // Formato: drwxr-xr-x ou -rw-r--r--
-        string strPerm = (val->tipo == DIRECTORY) ? "d" : "-";
-        strPerm += permParaStr(val->permProprietario);
-        strPerm += permParaStr(val->permGrupo);
-        strPerm += permParaStr(val->permOutros);
-
-        cout << left << setw(12) << strPerm
-             << setw(10) << tipoArquivoString(val->tipo)
-             << setw(8)  << val->tamanho
-             << setw(8)  << val->idProprietario
-             << setw(8)  << val->idGrupo
-             << setw(18) << tempoParaString(val->modificadoEm)
-             << val->nome << endl;
-    }
+        string strPerm = (val->tipo() == DIRECTORY) ? "d" : "-";
+        strPerm += permParaStr(val->permProprietario());
+        strPerm += permParaStr(val->permGrupo());
+        strPerm += permParaStr(val->permOutros());
+
+        saida << left << setw(12) << strPerm
+              << setw(10) << tipoArquivoString(val->tipo())
+              << setw(8)  << val->tamanho + bytesPendentes(ref)
+              << setw(8)  << val->idProprietario
+              << setw(8)  << val->idGrupo
+              << setw(18) << tempoParaString(deTempoFS(val->modificadoEm))
+              << inodes.nome(ref) << '\n';
+    }
+    cout << saida.str();
 }
 
 // chmod no formato octal: 755, 644, 777, etc. (Req 3.3)
-void FileSystem::chmod(string nome, int permOctal) {
-    if (!diretorioAtual->filhos.count(nome)) {
+void FileSystem::chmod(Sessao& s, const string& nome, int permOctal) {
+    ArvoreExclusiva arvore(*this);
+    Resolucao r = resolver(s, nome);
+    if (r.pai == INODE_NULO) return;
+    RefInode ref = r.alvo;
+    if (ref == INODE_NULO) {
         cout << "Erro: Arquivo nao encontrado.\n";
         return;
     }
-    auto arquivo = diretorioAtual->filhos[nome];
+    FCB& arquivo = inodes[ref];
     
     // Apenas o dono ou root (UID 0) pode mudar permissões
-    if (usuarioAtual != 0 && arquivo->idProprietario != usuarioAtual) {
+    if (s.usuario != 0 && arquivo.idProprietario != s.usuario) {
         cout << "Erro: Apenas o dono pode mudar permissoes.\n";
         return;
     }
     
     // Extrai dígitos do octal (ex: 755 -> owner=7, group=5, other=5)
-    arquivo->permOutros = permOctal % 10;
-    arquivo->permGrupo = (permOctal / 10) % 10;
-    arquivo->permProprietario = (permOctal / 100) % 10;
+    arquivo.definirPermissoes((permOctal / 100) % 10, (permOctal / 10) % 10, permOctal % 10);
+    if (arquivo.tipo() == DIRECTORY) invalidarTravessias(); // Permissão de arquivo não afeta travessia
+    registrarInode(ref);
     
     cout << "Permissoes alteradas para " << permOctal << " (";
-    cout << permParaStr(arquivo->permProprietario) << permParaStr(arquivo->permGrupo) << permParaStr(arquivo->permOutros);
+    cout << permParaStr(arquivo.permProprietario()) << permParaStr(arquivo.permGrupo()) << permParaStr(arquivo.permOutros());
     cout << ")\n";
 }
 
-// Helper: Remove recursivamente um FCB e seus filhos
-void FileSystem::removerRecursivo(shared_ptr<FCB> alvo) {
-    if (alvo->tipo == DIRECTORY) {
+// Helper: Remove recursivamente um FCB e seus filhos (os filhos saem da
+// tabela de inodes; o próprio alvo fica para quem chamou registrar a remoção)
+void FileSystem::removerRecursivo(RefInode alvo) {
+    if (inodes[alvo].tipo() == DIRECTORY) {
         // Remove todos os filhos recursivamente
-        for (auto& [nome, filho] : alvo->filhos) {
+        for (RefInode filho : inodes.filhos(alvo)) {
             removerRecursivo(filho);
+            inodes.liberar(filho);
         }
-        alvo->filhos.clear();
+        inodes.filhos(alvo).limpar();
+        return;
     }
-    // Libera blocos no disco
-    disco.liberarBlocos(alvo->indicesBlocos);
+    // Libera blocos no disco (e a reserva de appends ainda não gravados)
+    descartarEscrita(alvo);
+    if (!inodes[alvo].embutido) disco.liberarBlocos(inodes.dadosArquivo(alvo).extents);
 }
 
-void FileSystem::rm(string nome, bool recursivo) {
-    if (!diretorioAtual->filhos.count(nome)) {
+void FileSystem::rm(Sessao& s, const string& nome, bool recursivo) {
+    ArvoreExclusiva arvore(*this);
+    Resolucao r = resolver(s, nome);
+    if (r.pai == INODE_NULO) return;
+    RefInode alvo = r.alvo;
+    if (alvo == INODE_NULO) {
         cout << "Erro: Nao encontrado.\n";
         return;
     }
-    auto alvo = diretorioAtual->filhos[nome];
+    // O diretório atual da sessão e os acima dele (inclusive a raiz) ficam
+    // na árvore; o de outra sessão pode sair (ela volta para a raiz)
+    for (RefInode p = s.diretorio; ; p = inodes[p].pai) {
+        if (p == alvo) {
+            cout << "Erro: Nao e possivel remover o diretorio atual ou um acima dele.\n";
+            return;
+        }
+        if (p == raiz) break;
+    }
 
     // Verifica permissão de escrita no diretório pai (root ignora)
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_WRITE)) {
+    if (s.usuario != 0 && !verificarPermissao(s, inodes[r.pai], PERM_WRITE)) {
          cout << "Erro: Permissao negada (Write no diretorio).\n";
          return;
     }
 
     // Para arquivos, verifica também permissão de escrita no próprio arquivo (root ignora)
-    if (alvo->tipo != DIRECTORY && usuarioAtual != 0 && !verificarPermissao(alvo, PERM_WRITE)) {
+    if (inodes[alvo].tipo() != DIRECTORY && s.usuario != 0 && !verificarPermissao(s, inodes[alvo], PERM_WRITE)) {
         cout << "Erro: Permissao negada (Write no arquivo).\n";
         return;
     }
 
     // Se for diretório, verifica se está vazio ou se -r foi passado
-    if (alvo->tipo == DIRECTORY) {
-        if (!alvo->filhos.empty() && !recursivo) {
+    if (inodes[alvo].tipo() == DIRECTORY) {
+        carregarFilhos(alvo);
+        if (!inodes.filhos(alvo).vazio() && !recursivo) {
             cout << "Erro: Diretorio nao esta vazio. Use 'rm -r' para remover recursivamente.\n";
             return;
         }
+        esquecerCaminho(alvo);
         // Remove recursivamente se necessário
+        carregarTudo(alvo);
         removerRecursivo(alvo);
     } else {
+        esquecerCaminho(alvo);
         // Libera blocos no disco (Req 3.4)
-        disco.liberarBlocos(alvo->indicesBlocos);
+        descartarEscrita(alvo);
+        if (!inodes[alvo].embutido) disco.liberarBlocos(inodes.dadosArquivo(alvo).extents);
     }
 
     // Remove da árvore
-    diretorioAtual->filhos.erase(nome);
+    bool diretorio = inodes[alvo].tipo() == DIRECTORY;
+    inodes.filhos(r.pai).remover(inodes, alvo);
+    registrarRemocao(alvo);
+    inodes.liberar(alvo);
     cout << "Removido: " << nome << endl;
+    if (diretorio) mudaramDiretorios();
 }
 
-// Renomear/Mover (mv)
-void FileSystem::mv(string nomeAntigo, string nomeNovo) {
-    if (!diretorioAtual->filhos.count(nomeAntigo)) {
+// Renomear/Mover (mv), também para outro diretório
+void FileSystem::mv(Sessao& s, const string& nomeAntigo, const string& nomeNovo) {
+    ArvoreExclusiva arvore(*this);
+    Resolucao origem = resolver(s, nomeAntigo);
+    if (origem.pai == INODE_NULO) return;
+    RefInode ref = origem.alvo;
+    if (ref == INODE_NULO) {
         cout << "Erro: Arquivo de origem nao encontrado.\n";
         return;
     }
-    if (diretorioAtual->filhos.count(nomeNovo)) {
+    Resolucao destino = resolver(s, nomeNovo);
+    if (destino.pai == INODE_NULO) return;
+    if (destino.alvo != INODE_NULO) {
         cout << "Erro: Destino ja existe.\n";
         return;
     }
+    // Um diretório não vai para dentro de si mesmo (nem a raiz sai do lugar)
+    for (RefInode p = destino.pai; ; p = inodes[p].pai) {
+        if (p == ref) {
+            cout << "Erro: Nao e possivel mover um diretorio para dentro dele mesmo.\n";
+            return;
+        }
+        if (p == raiz) break;
+    }
 
-    auto arquivo = diretorioAtual->filhos[nomeAntigo];
+    FCB& arquivo = inodes[ref];
+    RefInode paiAntigo = arquivo.pai;
 
-    // Req 3.3: Checa permissão de escrita no diretório atual (root ignora)
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_WRITE)) {
+    // Req 3.3: Checa permissão de escrita nos diretórios de origem e destino (root ignora)
+    if (s.usuario != 0 && (!verificarPermissao(s, inodes[paiAntigo], PERM_WRITE) ||
+                              !verificarPermissao(s, inodes[destino.pai], PERM_WRITE))) {
          cout << "Erro: Permissao negada (Write no diretorio).\n";
          return;
     }
 
     // Verifica permissão de escrita no próprio arquivo (root ignora)
-    if (usuarioAtual != 0 && !verificarPermissao(arquivo, PERM_WRITE)) {
+    if (s.usuario != 0 && !verificarPermissao(s, arquivo, PERM_WRITE)) {
         cout << "Erro: Permissao negada (Write no arquivo).\n";
         return;
     }
 
-    // Renomeia (update key in map)
-    arquivo->nome = nomeNovo;
-    diretorioAtual->filhos[nomeNovo] = arquivo;
-    diretorioAtual->filhos.erase(nomeAntigo);
-
-    time(&arquivo->modificadoEm);
+    // Renomeia: só a referência ao nome muda (o índice é pelo nome, então
+    // a entrada sai antes e volta depois). Caminhos resolvidos através do
+    // nome antigo e o negativo do novo saem do cache.
+    esquecerCaminho(ref);
+    marcarModificado(ref); // Diretório antigo também muda (--lazy)
+    inodes.filhos(paiAntigo).remover(inodes, ref);
+    inodes.renomear(ref, destino.nome);
+    arquivo.pai = destino.pai;
+    inodes.filhos(destino.pai).inserir(inodes, ref);
+    esquecerCaminho(ref);
+    // Os diretórios abaixo do movido têm outros diretórios acima agora; se o
+    // atual de uma sessão é um deles, o caminho do prompt também muda
+    if (arquivo.tipo() == DIRECTORY) {
+        invalidarTravessias();
+        mudaramDiretorios();
+        acertarSessao(s); // Prompt de quem moveu já com o caminho novo
+    }
+
+    arquivo.modificadoEm = agoraFS();
+    registrarInode(ref);
     cout << "Movido/Renomeado de " << nomeAntigo << " para " << nomeNovo << endl;
 }
 
-// Helper: Copiar diretório recursivamente
-void copiarDiretorioRecursivo(shared_ptr<FCB> origem, shared_ptr<FCB> destino, int usuarioAtual, int grupoAtual,
-                              function<bool(shared_ptr<FCB>, int)> verificarPermissao) {
-    // Cria o diretório destino
-    auto paiDestino = destino->pai.lock();
-    auto novoDir = make_shared<FCB>(destino->nome, DIRECTORY, usuarioAtual, grupoAtual,
-                                   origem->permProprietario, origem->permGrupo, origem->permOutros, paiDestino);
-    paiDestino->filhos[destino->nome] = novoDir;
+// Helper: conteúdo de origem no arquivo recém-criado destino. Embutido é
+// copiado; em blocos, só as referências (copy-on-write: só metadados)
+static void copiarConteudo(TabelaInodes& inodes, VirtualDisk& disco, const FCB& origem, FCB& destino) {
+    destino.tamanho = origem.tamanho;
+    destino.comprimido = origem.comprimido;
+    if (origem.embutido) {
+        inodes.definirEmbutido(destino, true);
+        inodes.conteudoEmbutido(destino) = inodes.conteudoEmbutido(origem);
+        return;
+    }
+    DadosArquivo& dados = inodes.dadosArquivo(destino);
+    dados.extents = inodes.dadosArquivo(origem).extents;
+    dados.chunks = inodes.dadosArquivo(origem).chunks;
+    disco.compartilharBlocos(dados.extents);
+}
+
+// Helper: Copiar diretório recursivamente. O diretório novo (nome, dentro de
+// paiDestino) é do usuário atual; os arquivos mantêm dono e permissões.
+RefInode copiarDiretorioRecursivo(TabelaInodes& inodes, RefInode origem, RefInode paiDestino, string_view nome,
+                                  VirtualDisk& disco, int uid, int gid) {
+    const FCB& dirOrigem = inodes[origem];
+    RefInode novoDir = inodes.criar(nome, DIRECTORY, uid, gid,
+                                    dirOrigem.permProprietario(), dirOrigem.permGrupo(), dirOrigem.permOutros(), paiDestino);
+    inodes.filhos(paiDestino).inserir(inodes, novoDir);
+    inodes.filhos(novoDir).reservar(inodes.filhos(origem).quantidade());
 
     // Copia todos os filhos recursivamente
-    for (auto& [nome, filho] : origem->filhos) {
-        if (filho->tipo == DIRECTORY) {
+    for (RefInode ref : inodes.filhos(origem)) {
+        const FCB& filho = inodes[ref];
+        if (filho.tipo() == DIRECTORY) {
             // Cria subdiretório e copia recursivamente
-            auto novoSubDir = make_shared<FCB>(nome, DIRECTORY, filho->idProprietario, filho->idGrupo,
-                                             filho->permProprietario, filho->permGrupo, filho->permOutros, novoDir);
-            copiarDiretorioRecursivo(filho, novoSubDir, usuarioAtual, grupoAtual, verificarPermissao);
+            copiarDiretorioRecursivo(inodes, ref, novoDir, inodes.nome(ref), disco, uid, gid);
         } else {
             // Copia arquivo
-            auto novoArquivo = make_shared<FCB>(nome, filho->tipo, filho->idProprietario, filho->idGrupo,
-                                              filho->permProprietario, filho->permGrupo, filho->permOutros, novoDir);
-            novoArquivo->tamanho = filho->tamanho;
-            novoArquivo->indicesBlocos = filho->indicesBlocos; // Copia referências aos blocos
-            novoDir->filhos[nome] = novoArquivo;
+            RefInode novoArquivo = inodes.criar(inodes.nome(ref), filho.tipo(), filho.idProprietario, filho.idGrupo,
+                                                filho.permProprietario(), filho.permGrupo(), filho.permOutros(), novoDir);
+            copiarConteudo(inodes, disco, filho, inodes[novoArquivo]);
+            inodes.filhos(novoDir).inserir(inodes, novoArquivo);
         }
     }
+    return novoDir;
 }
 
 // Copiar (cp) - agora suporta cópia recursiva de diretórios
-void FileSystem::cp(string nomeOrigem, string nomeDestino) {
-    if (!diretorioAtual->filhos.count(nomeOrigem)) {
+void FileSystem::cp(Sessao& s, const string& nomeOrigem, const string& nomeDestino) {
+    ArvoreExclusiva arvore(*this);
+    Resolucao r = resolver(s, nomeOrigem);
+    if (r.pai == INODE_NULO) return;
+    RefInode origem = r.alvo;
+    if (origem == INODE_NULO) {
         cout << "Erro: Arquivo de origem nao encontrado.\n";
         return;
     }
-    if (diretorioAtual->filhos.count(nomeDestino)) {
+    Resolucao destino = resolver(s, nomeDestino);
+    if (destino.pai == INODE_NULO) return;
+    if (destino.alvo != INODE_NULO) {
         cout << "Erro: Destino ja existe.\n";
         return;
     }
-
-    auto arquivoOrigem = diretorioAtual->filhos[nomeOrigem];
+    // Diretório copiado para dentro dele mesmo: a cópia entraria na cópia
+    for (RefInode p = destino.pai; inodes[origem].tipo() == DIRECTORY; p = inodes[p].pai) {
+        if (p == origem) {
+            cout << "Erro: Nao e possivel copiar um diretorio para dentro dele mesmo.\n";
+            return;
+        }
+        if (p == raiz) break;
+    }
 
     // Verifica permissão de leitura no arquivo/diretório de origem (root ignora)
-    if (usuarioAtual != 0 && !verificarPermissao(arquivoOrigem, PERM_READ)) {
+    if (s.usuario != 0 && !verificarPermissao(s, inodes[origem], PERM_READ)) {
         cout << "Erro: Permissao negada (Read).\n";
         return;
     }
 
     // Verifica permissão de escrita no diretório destino (root ignora)
-    if (usuarioAtual != 0 && !verificarPermissao(diretorioAtual, PERM_WRITE)) {
+    if (s.usuario != 0 && !verificarPermissao(s, inodes[destino.pai], PERM_WRITE)) {
         cout << "Erro: Permissao negada (Write no diretorio).\n";
         return;
     }
 
-    if (arquivoOrigem->tipo == DIRECTORY) {
-        // Cópia recursiva de diretório
-        auto novoDir = make_shared<FCB>(nomeDestino, DIRECTORY, usuarioAtual, grupoAtual,
-                                       arquivoOrigem->permProprietario, arquivoOrigem->permGrupo,
-                                       arquivoOrigem->permOutros, diretorioAtual);
+    // Appends adiados entram na cópia
+    try {
+        if (inodes[origem].tipo() == DIRECTORY) descarregarEscritas();
+        else descarregarEscrita(origem);
+    } catch (exception& e) {
+        cout << e.what() << endl;
+        return;
+    }
 
-        copiarDiretorioRecursivo(arquivoOrigem, novoDir, usuarioAtual, grupoAtual,
-                                [this](shared_ptr<FCB> f, int p) { return verificarPermissao(f, p); });
+    RefInode copia;
+    if (inodes[origem].tipo() == DIRECTORY) {
+        // Cópia recursiva de diretório
+        carregarTudo(origem);
+        copia = copiarDiretorioRecursivo(inodes, origem, destino.pai, destino.nome, disco, s.usuario, s.grupo);
     } else {
-        // Cópia de arquivo regular
-        // Lê dados originais
-        string conteudo = disco.lerDados(arquivoOrigem->indicesBlocos, arquivoOrigem->tamanho);
-
-        // Cria novo arquivo
-        touch(nomeDestino, arquivoOrigem->tipo);
-
-        // Escreve dados no novo arquivo
-        echo(nomeDestino, conteudo);
+        // Cópia de arquivo regular: O(metadados). Os blocos são compartilhados
+        // e só serão copiados quando um dos lados escrever (copy-on-write)
+        copia = inodes.criar(destino.nome, inodes[origem].tipo(), s.usuario, s.grupo, 6, 4, 4, destino.pai);
+        copiarConteudo(inodes, disco, inodes[origem], inodes[copia]);
+        inodes.filhos(destino.pai).inserir(inodes, copia);
     }
+    esquecerCaminho(copia);
+    registrarArvore(copia);
 
     cout << "Copiado de " << nomeOrigem << " para " << nomeDestino << endl;
 }
 
-void FileSystem::stat(string nome) {
-    if (!diretorioAtual->filhos.count(nome)) {
+void FileSystem::stat(Sessao& s, const string& nome) {
+    ArvoreCompartilhada arvore(*this);
+    Resolucao r = resolver(s, nome);
+    if (r.pai == INODE_NULO) return;
+    RefInode ref = r.alvo;
+    if (ref == INODE_NULO) {
         cout << "Erro: Arquivo nao encontrado.\n";
         return;
     }
-    auto f = diretorioAtual->filhos[nome];
-
-    // Formato similar ao comando stat do Linux
-    cout << "  File: " << f->nome << "\n";
-    cout << "  Size: " << f->tamanho << " bytes\n";
-    cout << " Inode: " << f->inodeId << "\n";
-    cout << "  Type: " << tipoArquivoString(f->tipo) << "\n";
-    cout << "Blocks: [";
-    for(size_t i = 0; i < f->indicesBlocos.size(); i++) {
-        cout << f->indicesBlocos[i];
-        if (i < f->indicesBlocos.size() - 1) cout << ", ";
+    FCB& f = inodes[ref];
+    TravaConteudo trava = travarConteudo(ref);
+    try {
+        descarregarEscrita(ref); // Blocos definitivos antes de mostrar os extents
+    } catch (exception& e) {
+        cout << e.what() << endl;
+        return;
     }
-    cout << "]\n";
-    cout << "Access: (" << f->permProprietario << f->permGrupo << f->permOutros << "/";
-    cout << permParaStr(f->permProprietario) << permParaStr(f->permGrupo) << permParaStr(f->permOutros) << ")\n";
-    cout << "   Uid: " << f->idProprietario << "  Gid: " << f->idGrupo << "\n";
-    cout << "Access: " << tempoParaString(f->acessadoEm) << "\n";
-    cout << "Modify: " << tempoParaString(f->modificadoEm) << "\n";
-    cout << " Birth: " << tempoParaString(f->criadoEm) << "\n";
+
+    // Diretórios e arquivos embutidos não têm registro de blocos: mostram zero blocos
+    static const DadosArquivo semDados;
+    const DadosArquivo& dados = f.tipo() == DIRECTORY || f.embutido ? semDados : inodes.dadosArquivo(f);
+
+    // Formato similar ao comando stat do Linux, montado à parte e escrito de
+    // uma vez (como no ls)
+    ostringstream saida;
+    saida << "  File: " << inodes.nome(ref) << "\n";
+    saida << "  Size: " << f.tamanho << " bytes\n";
+    if (f.comprimido && !f.embutido) {
+        size_t armazenado = dados.chunks.empty() ? 0 : dados.chunks.back().offset + dados.chunks.back().tamanho;
+        saida << "Stored: " << armazenado << " bytes comprimidos em " << dados.chunks.size() << " chunks";
+        if (armazenado > 0) {
+            saida << " (razao " << fixed << setprecision(2) << (double)f.tamanho / armazenado << ")";
+        }
+        saida << "\n";
+    }
+    saida << " Inode: " << f.inodeId << "\n";
+    saida << "  Type: " << tipoArquivoString(f.tipo()) << "\n";
+    if (f.tipo() != DIRECTORY) {
+        saida << "Inline: ";
+        if (f.embutido) saida << "sim (" << f.tamanho << " de ate " << limiteEmbutido << " bytes no inode)\n";
+        else saida << "nao\n";
+    }
+    // Extents no formato inicio-fim (inclusive); extent de 1 bloco mostra só o início
+    saida << "Blocks: [";
+    for (size_t i = 0; i < dados.extents.size(); i++) {
+        const Extent& e = dados.extents[i];
+        saida << e.inicio;
+        if (e.comprimento > 1) saida << "-" << e.fim() - 1;
+        if (i < dados.extents.size() - 1) saida << ", ";
+    }
+    saida << "] (" << totalBlocos(dados.extents) << " blocos em " << dados.extents.size() << " extents)\n";
+    saida << "  Frag: " << fixed << setprecision(2) << fragmentacao(dados.extents) << "\n";
+    size_t compartilhados =
+        disco.contarCompartilhados(dados.extents, 0, totalBlocos(dados.extents) * disco.obterTamanhoBloco());
+    if (compartilhados > 0) {
+        saida << "Shared: " << compartilhados << " blocos (copy-on-write)\n";
+    }
+    saida << "Access: (" << f.permProprietario() << f.permGrupo() << f.permOutros() << "/";
+    saida << permParaStr(f.permProprietario()) << permParaStr(f.permGrupo()) << permParaStr(f.permOutros()) << ")\n";
+    saida << "   Uid: " << f.idProprietario << "  Gid: " << f.idGrupo << "\n";
+    saida << "Access: " << tempoParaString(deTempoFS(__atomic_load_n(&f.acessadoEm, __ATOMIC_RELAXED))) << "\n";
+    saida << "Modify: " << tempoParaString(deTempoFS(f.modificadoEm)) << "\n";
+    saida << " Birth: " << tempoParaString(deTempoFS(f.criadoEm)) << "\n";
+    cout << saida.str();
 }
 
 // Novo comando: executar arquivo (Req 3.3 - testar PERM_EXEC)
-void FileSystem::executar(string nome) {
-    if (!diretorioAtual->filhos.count(nome)) {
+void FileSystem::executar(Sessao& s, const string& nome) {
+    ArvoreCompartilhada arvore(*this);
+    Resolucao r = resolver(s, nome);
+    if (r.pai == INODE_NULO) return;
+    RefInode ref = r.alvo;
+    if (ref == INODE_NULO) {
         cout << "Erro: Arquivo nao encontrado.\n";
         return;
     }
-    auto arquivo = diretorioAtual->filhos[nome];
+    FCB& arquivo = inodes[ref];
 
-    if (arquivo->tipo == DIRECTORY) {
+    if (arquivo.tipo() == DIRECTORY) {
         cout << "Erro: Nao pode executar um diretorio.\n";
         return;
     }
 
     // Req 3.3: Verifica permissão de execução
-    if (!verificarPermissao(arquivo, PERM_EXEC)) {
+    if (!verificarPermissao(s, arquivo, PERM_EXEC)) {
         cout << "Erro: Permissao negada (Execute).\n";
         return;
     }
 
     // Simula execução baseada no tipo de arquivo
-    if (arquivo->tipo == TYPE_PROGRAM) {
-        cout << "Executando programa: " << arquivo->nome << "\n";
+    if (arquivo.tipo() == TYPE_PROGRAM) {
+        cout << "Executando programa: " << inodes.nome(ref) << "\n";
         cout << "Conteudo do programa seria executado aqui...\n";
     } else {
-        cout << "Arquivo '" << arquivo->nome << "' executado (tipo: " << tipoArquivoString(arquivo->tipo) << ")\n";
+        cout << "Arquivo '" << inodes.nome(ref) << "' executado (tipo: " << tipoArquivoString(arquivo.tipo()) << ")\n";
     }
 
-    // Atualiza timestamp de acesso
-    time(&arquivo->acessadoEm);
+    // Atualiza timestamp de acesso (com a trava de leitura: quem registra o
+    // inode no journal tem a exclusiva)
+    auto trava = lerInode(ref);
+    registrarAcesso(arquivo);
 }
 
-// Simula troca de usuário e grupo (Req 3.3: testar owner/group/others)
+// Simula troca de usuário e grupo (Req 3.3: testar owner/group/others).
+// Como o cd: a sessão principal com a árvore exclusiva, as outras sem.
 void FileSystem::trocarUsuario(int uid, int gid) {
-    usuarioAtual = uid;
-    if (gid >= 0) grupoAtual = gid;
-    cout << "Usuario alterado para UID: " << usuarioAtual << ", GID: " << grupoAtual << endl;
+    ArvoreExclusiva arvore(*this);
+    mudarUsuario(*principal, uid, gid);
+}
+
+void FileSystem::trocarUsuario(Sessao& s, int uid, int gid) {
+    ArvoreCompartilhada arvore(*this);
+    mudarUsuario(s, uid, gid);
+}
+
+void FileSystem::mudarUsuario(Sessao& s, int uid, int gid) {
+    s.usuario = uid;
+    if (gid >= 0) s.grupo = gid;
+    identificar(s); // O memo da identidade nova continua valendo
+    cout << "Usuario alterado para UID: " << s.usuario << ", GID: " << s.grupo << endl;
 }
 
 // Retorna info do usuário atual
-void FileSystem::quemSou() {
-    cout << "UID: " << usuarioAtual << ", GID: " << grupoAtual << endl;
+void FileSystem::quemSou(Sessao& s) {
+    ArvoreCompartilhada arvore(*this);
+    cout << "UID: " << s.usuario << ", GID: " << s.grupo << endl;
 }
 
-string FileSystem::obterCaminho() {
-    // Reconstrói o caminho completo subindo pela árvore até a raiz
-    if (diretorioAtual == raiz) return "/";
-    
-    vector<string> partes;
-    shared_ptr<FCB> atual = diretorioAtual;
-    
-    while (atual != raiz) {
-        partes.push_back(atual->nome);
-        auto paiPtr = atual->pai.lock();
-        if (!paiPtr || paiPtr == atual) break; // Segurança contra loop infinito
-        atual = paiPtr;
+void FileSystem::configurarCache(size_t orcamentoBytes, const string& politica) {
+    ArvoreExclusiva arvore(*this);
+    disco.configurarCache(orcamentoBytes, politica);
+}
+
+// Contadores do cache de blocos (comando 'cache')
+void FileSystem::estatisticasCache() {
+    ArvoreCompartilhada arvore(*this);
+    const CacheBlocos* cache = disco.obterCache();
+    if (!cache) {
+        cout << "Cache de blocos desligado (acesso direto ao disco).\n";
+        return;
     }
-    
-    // Monta o caminho na ordem correta (de raiz para atual)
-    string caminho = "";
-    for (int i = partes.size() - 1; i >= 0; i--) {
-        caminho += "/" + partes[i];
+    EstatisticasCache e = cache->estatisticas();
+    size_t acessos = e.acertos + e.faltas;
+    ostringstream saida; // Escrito de uma vez, como no ls
+    saida << "Politica: " << cache->nomePolitica() << ", " << cache->capacidadeBlocos() << " quadros x "
+          << disco.obterTamanhoBloco() << " bytes\n";
+    saida << "Acertos: " << e.acertos << "  Faltas: " << e.faltas;
+    if (acessos > 0) {
+        saida << "  Taxa de acerto: " << fixed << setprecision(1) << 100.0 * e.acertos / acessos << "%";
+    }
+    saida << "\n";
+    saida << "Expulsoes: " << e.expulsoes << "  Gravacoes: " << e.gravacoes
+          << " (" << e.gravacoesFundo << " em segundo plano)  Sujos: " << e.sujos << "\n";
+    saida << "Readahead: " << e.antecipados << " blocos antecipados, " << e.acertosAntecipados << " usados\n";
+    cout << saida.str();
+}
+
+// Ponto de sincronização explícito (cache + msync/fsync da imagem, se houver)
+void FileSystem::sincronizar() {
+    ArvoreExclusiva arvore(*this);
+    // Escritas adiadas e cache (se houver) são descarregados mesmo sem imagem
+    try {
+        descarregarEscritas();
+        if (disco.persistente()) gravarMetadados();
+        else disco.sincronizar();
+    } catch (exception& e) {
+        cout << e.what() << endl;
+        return;
     }
-    
-    return caminho.empty() ? "/" : caminho;
+    if (!disco.persistente()) cout << "Disco em memoria: nada a sincronizar.\n";
+    else cout << "Sincronizado.\n";
+}
+
+// ==========================================
+// JOURNAL DE METADADOS (WRITE-AHEAD LOG)
+// ==========================================
+int FileSystem::idPai(RefInode f) {
+    return f == raiz ? 0 : inodes[inodes[f].pai].inodeId;
+}
+
+// Registro de f: atributos, blocos ou conteúdo embutido (arquivos) e nome
+void FileSystem::codificarRegistro(RefInode f, string& destino) {
+    const FCB& fcb = inodes[f];
+    bool emBlocos = fcb.tipo() != DIRECTORY && !fcb.embutido;
+    const DadosArquivo* dados = emBlocos ? &inodes.dadosArquivo(fcb) : nullptr;
+    string_view embutido = fcb.embutido ? string_view(inodes.conteudoEmbutido(fcb)) : string_view();
+    codificarInode(destino, fcb, dados, embutido, inodes.nome(f), idPai(f));
+}
+
+// f e todos os descendentes em pré-ordem (o pai sempre antes dos filhos)
+void FileSystem::codificarArvore(RefInode f, string& destino) {
+    codificarRegistro(f, destino);
+    if (inodes[f].tipo() != DIRECTORY) return;
+    for (RefInode filho : inodes.filhos(f)) codificarArvore(filho, destino);
+}
+
+// Uma falha do journal não desfaz o comando (já aplicado em memória): só é relatada
+void FileSystem::registrarTransacao(const string& transacao) {
+    if (!journal) return;
+    try {
+        journal->registrar(transacao);
+        // O checkpoint lê a árvore inteira: com ela compartilhada (modo
+        // concorrente), fica para o próximo comando que a tem sozinho
+        if (!compartilhando() && journal->estatisticas().bytesLog >= (size_t)JOURNAL_CHECKPOINT_BYTES) checkpoint();
+    } catch (exception& e) {
+        cout << e.what() << endl;
+    }
+}
+
+void FileSystem::registrarInode(RefInode f) {
+    marcarModificado(f);
+    if (!journal) return;
+    string transacao;
+    codificarRegistro(f, transacao);
+    registrarTransacao(transacao);
+}
+
+// cp de diretório: a cópia inteira é uma transação só
+void FileSystem::registrarArvore(RefInode f) {
+    marcarModificado(f);
+    if (!journal) return;
+    string transacao;
+    codificarArvore(f, transacao);
+    registrarTransacao(transacao);
+}
+
+void FileSystem::registrarRemocao(RefInode f) {
+    marcarModificado(f);
+    if (!journal) return;
+    string transacao;
+    codificarRemocao(transacao, inodes[f].inodeId);
+    registrarTransacao(transacao);
+}
+
+// Reaplica uma transação (do checkpoint ou do log) sobre a árvore em memória.
+// Os FCBs são achados pelo índice de inodeId da tabela. Registros cujo pai não
+// existe mais são ignorados: uma remoção posterior da mesma sequência já os cobria.
+void FileSystem::aplicarTransacao(const string& transacao) {
+    // Inodes saem, mudam de lugar e de permissões sem passar pelos comandos
+    cacheCaminhos.clear();
+    invalidarTravessias();
+    LeitorRegistros leitor(transacao);
+    while (!leitor.fim()) {
+        if (leitor.lerTipo() == REGISTRO_REMOCAO) {
+            RefInode alvo = inodes.buscarId(leitor.lerRemocao());
+            if (alvo == INODE_NULO || alvo == raiz) continue;
+            inodes.filhos(inodes[alvo].pai).remover(inodes, alvo);
+            inodes.liberarSubarvore(alvo);
+            continue;
+        }
+
+        int paiId;
+        string nome;
+        DadosArquivo dados;
+        string embutido;
+        FCB lido = leitor.lerInode(paiId, nome, dados, embutido);
+        nextInodeId = max(nextInodeId.load(), lido.inodeId + 1);
+        if (paiId == 0) {
+            // Raiz: só os atributos mudam (os filhos ficam no registro do diretório)
+            lido.pai = raiz;
+            inodes.substituir(raiz, move(lido), nome);
+            continue;
+        }
+        RefInode pai = inodes.buscarId(paiId);
+        if (pai == INODE_NULO || inodes[pai].tipo() != DIRECTORY) continue;
+        RefInode f = inodes.buscarId(lido.inodeId);
+        if (f != INODE_NULO) {
+            // Atualização (inclusive mv): sai do nome antigo, mantém os filhos
+            inodes.filhos(inodes[f].pai).remover(inodes, f);
+            inodes.substituir(f, move(lido), nome);
+        } else {
+            f = inodes.criar(move(lido), nome);
+        }
+        inodes[f].pai = pai;
+        if (inodes[f].embutido) inodes.conteudoEmbutido(f) = move(embutido);
+        else if (inodes[f].tipo() != DIRECTORY) inodes.dadosArquivo(f) = move(dados);
+        // Nome ocupado por outro inode: a entrada antiga é substituída
+        RefInode anterior = inodes.filhos(pai).buscar(inodes[f].nome);
+        if (anterior != INODE_NULO && anterior != f) {
+            inodes.filhos(pai).remover(inodes, anterior);
+            inodes.liberarSubarvore(anterior);
+        }
+        inodes.filhos(pai).inserir(inodes, f);
+    }
+    mudaramDiretorios();
+}
+
+// Checkpoint: disco sincronizado (dados, mapa de bits) e árvore inteira no
+// arquivo de checkpoint (formato compacto); o log recomeça vazio
+void FileSystem::checkpoint() {
+    disco.sincronizar();
+    journal->checkpoint(serializarArvoreAtual());
+}
+
+void FileSystem::ativarJournal(const string& politica) {
+    ArvoreExclusiva arvore(*this);
+    ligarJournal(politica);
+}
+
+void FileSystem::ligarJournal(const string& politica) {
+    if (caminhoImagem.empty()) {
+        throw invalid_argument("Erro: O journal exige uma imagem de disco (--image).");
+    }
+    // A reprodução indexa todos os inodes: a montagem sob demanda vira completa
+    if (imagemArvore) {
+        carregarTudo(raiz);
+        imagemArvore.reset();
+    }
+    auto novo = make_unique<Journal>(caminhoImagem, lerPoliticaJournal(politica),
+                                     [this] { disco.descarregarCache(); });
+    // Imagem recém-criada: checkpoint e log que sobraram de outra imagem não valem
+    if (!disco.reaberto()) {
+        novo->descartar();
+    } else {
+        // O checkpoint é no mínimo tão novo quanto a árvore gravada na imagem
+        // (o log cobre tudo depois dele) e a substitui
+        string arvore;
+        bool temCheckpoint = novo->carregarCheckpoint(arvore);
+        if (temCheckpoint) montarArvoreDe(arvore);
+        size_t reaplicadas = novo->reproduzir([&](const string& t) { aplicarTransacao(t); });
+
+        // Mapa de bits e referências passam a refletir exatamente a árvore recuperada
+        size_t recuperados = recalcularOcupacao();
+        if (temCheckpoint || reaplicadas > 0) {
+            cout << "Journal: " << inodes.vivos() << " inodes restaurados, " << reaplicadas
+                 << " transacoes reaplicadas do log";
+            if (recuperados > 0) cout << ", " << recuperados << " blocos sem dono liberados";
+            cout << ".\n";
+        }
+    }
+    journal = move(novo);
+    checkpoint();
+}
+
+// Contadores do journal (comando 'journal')
+void FileSystem::estatisticasJournal() {
+    ArvoreCompartilhada arvore(*this);
+    if (!journal) {
+        cout << "Journal desligado (use --journal com --image).\n";
+        return;
+    }
+    EstatisticasJournal e = journal->estatisticas();
+    ostringstream saida; // Escrito de uma vez, como no ls
+    saida << "Politica: " << nomePoliticaJournal(journal->obterPolitica()) << "  Log: " << e.bytesLog << " bytes\n";
+    saida << "Transacoes: " << e.transacoes << "  Grupos gravados: " << e.grupos;
+    if (e.grupos > 0) {
+        saida << " (" << fixed << setprecision(1) << (double)e.transacoes / e.grupos << " por grupo)";
+    }
+    saida << "\n";
+    saida << "fdatasync: " << e.sincronizacoes << "  Checkpoints: " << e.checkpoints << "\n";
+    cout << saida.str();
+}
+
+// ==========================================
+// IMAGEM COMPACTA (SAVE/LOAD E MONTAGEM)
+// ==========================================
+void FileSystem::montarArvoreDe(string_view metadados) {
+    trocarRaiz(montarArvore(inodes, metadados));
+}
+
+// A árvore atual sai da tabela de inodes e novaRaiz passa a ser a montada
+void FileSystem::trocarRaiz(RefInode novaRaiz) {
+    escritasPendentes.clear();
+    inodes.liberarSubarvore(raiz);
+    raiz = novaRaiz;
+    cacheCaminhos.clear();
+    invalidarTravessias(); // Os inodeIds da árvore nova podem repetir os da antiga
+    geracaoMontagem++;
+    mudaramDiretorios(); // Todas as sessões voltam para a raiz
+}
+
+// Referências e mapa de bits refeitos a partir dos extents da árvore montada
+size_t FileSystem::recalcularOcupacao() {
+    vector<const vector<Extent>*> arquivos;
+    inodes.paraCada([&](RefInode, const FCB& f) {
+        if (f.tipo() != DIRECTORY && !f.embutido) arquivos.push_back(&inodes.dadosArquivo(f).extents);
+    });
+    return disco.recalcularOcupacao(arquivos);
+}
+
+// Ponto de persistência da árvore: disco sincronizado, árvore gravada depois
+// dos blocos da imagem e, com journal, num checkpoint novo (o log recomeça vazio)
+void FileSystem::gravarMetadados() {
+    if (!disco.persistente()) return;
+    disco.sincronizar();
+    vector<RefInode> ordem;
+    string arvore = serializarArvoreAtual(imagemArvore ? &ordem : nullptr);
+    disco.gravarMetadados(arvore);
+    if (journal) journal->checkpoint(arvore);
+    if (!imagemArvore) return;
+
+    // Montagem sob demanda: a árvore recém-gravada passa a ser a base. Os FCBs
+    // em memória apontam para as posições novas e deixam de estar modificados
+    // (a área antiga pode ter sido liberada, então nada mais a lê).
+    imagemArvore = make_unique<ImagemArvore>(disco.mapearMetadados());
+    for (uint32_t i = 0; i < ordem.size(); i++) {
+        if (ordem[i] == INODE_NULO) continue;
+        inodes[ordem[i]].indiceImagem = i;
+        inodes[ordem[i]].modificado = false;
+    }
+}
+
+string FileSystem::serializarArvoreAtual(vector<RefInode>* ordem) {
+    OcupacaoBlocos ocupacao;
+    ocupacao.somaMapa = disco.somaMapa();
+    ocupacao.compartilhados = disco.blocosCompartilhados();
+    return serializarArvore(inodes, raiz, ocupacao, imagemArvore.get(), ordem);
+}
+
+void FileSystem::salvar(const string& caminho) {
+    ArvoreExclusiva arvore(*this);
+    try {
+        descarregarEscritas();
+        struct stat destino, atual;
+        bool mesmaImagem = caminho.empty() ||
+            (!caminhoImagem.empty() && ::stat(caminho.c_str(), &destino) == 0 &&
+             ::stat(caminhoImagem.c_str(), &atual) == 0 &&
+             destino.st_dev == atual.st_dev && destino.st_ino == atual.st_ino);
+        if (mesmaImagem) {
+            if (!disco.persistente()) {
+                cout << "Erro: Disco em memoria: informe o arquivo da imagem (save <arquivo>).\n";
+                return;
+            }
+            gravarMetadados();
+            cout << "Imagem salva em '" << caminhoImagem << "'.\n";
+            return;
+        }
+        // Imagem nova com a mesma geometria: só os blocos ocupados são copiados
+        string arvore = serializarArvoreAtual();
+        if (::unlink(caminho.c_str()) < 0 && errno != ENOENT) {
+            cout << "Erro: Nao foi possivel substituir '" << caminho << "': " << strerror(errno) << "\n";
+            return;
+        }
+        auto imagem = ArmazenamentoArquivo::abrir(caminho, disco.obterTamanhoBloco(), disco.obterNumBlocos());
+        disco.exportar(*imagem);
+        imagem->gravarMetadados(arvore);
+        imagem->sincronizar();
+        cout << "Imagem salva em '" << caminho << "' (" << arvore.size() << " bytes de metadados).\n";
+    } catch (exception& e) {
+        cout << e.what() << endl;
+    }
+}
+
+void FileSystem::carregar(const string& caminho) {
+    ArvoreExclusiva arvore(*this);
+    try {
+        struct stat info;
+        if (::stat(caminho.c_str(), &info) < 0) {
+            cout << "Erro: Imagem '" << caminho << "' nao encontrada.\n";
+            return;
+        }
+        if (info.st_size == 0) {
+            cout << "Erro: '" << caminho << "' nao e uma imagem de disco valida.\n";
+            return;
+        }
+        struct stat atual;
+        if (!caminhoImagem.empty() && ::stat(caminhoImagem.c_str(), &atual) == 0 &&
+            info.st_dev == atual.st_dev && info.st_ino == atual.st_ino) {
+            cout << "Erro: A imagem '" << caminho << "' ja esta montada.\n";
+            return;
+        }
+
+        // A imagem nova é aberta e montada antes de mexer na atual: se ela
+        // estiver corrompida, nada muda
+        size_t tb = disco.obterTamanhoBloco();
+        size_t n = disco.obterNumBlocos();
+        unique_ptr<Armazenamento> arm;
+        if (imagemMapeada) arm = ArmazenamentoMmap::abrir(caminho, tb, n);
+        else arm = ArmazenamentoArquivo::abrir(caminho, tb, n);
+        RefInode novaRaiz = INODE_NULO;
+        unique_ptr<ImagemArvore> imagem;
+        if (auto regiao = arm->mapearMetadados()) {
+            if (sobDemanda) imagem = make_unique<ImagemArvore>(move(regiao));
+            else novaRaiz = montarArvore(inodes, regiao->dados());
+        } else {
+            novaRaiz = inodes.criar("/", DIRECTORY, 0, 0, 7, 5, 5, INODE_NULO);
+            inodes[novaRaiz].pai = novaRaiz;
+        }
+
+        // Desmontagem da atual: árvore gravada (e checkpoint, se houver journal)
+        try {
+            descarregarEscritas();
+            gravarMetadados();
+        } catch (...) {
+            if (novaRaiz != INODE_NULO) inodes.liberarSubarvore(novaRaiz);
+            throw;
+        }
+        string politicaJournal;
+        if (journal) politicaJournal = nomePoliticaJournal(journal->obterPolitica());
+        journal.reset();
+
+        disco.trocarArmazenamento(move(arm));
+        caminhoImagem = caminho;
+        imagemArvore.reset();
+        if (imagem) {
+            montarSobDemanda(move(imagem));
+        } else {
+            trocarRaiz(novaRaiz);
+            recalcularOcupacao();
+        }
+        // O journal continua ligado, agora sobre os arquivos da imagem nova
+        if (!politicaJournal.empty()) ligarJournal(politicaJournal);
+        cout << "Imagem '" << caminho << "' carregada (" << disco.obterNumBlocos() << " blocos x "
+             << disco.obterTamanhoBloco() << " bytes).\n";
+    } catch (exception& e) {
+        cout << e.what() << endl;
+    }
+}
+
+// ==========================================
+// MONTAGEM SOB DEMANDA (--lazy)
+// ==========================================
+// Só a raiz é lida. O mapa de bits reaberto e a lista de blocos compartilhados
+// gravada com a árvore dão as referências sem percorrer os extents; se o mapa
+// não é o da gravação (queda entre os dois), a árvore é lida inteira.
+void FileSystem::montarSobDemanda(unique_ptr<ImagemArvore> imagem) {
+    trocarRaiz(imagem->montarRaiz(inodes));
+    imagemArvore = move(imagem);
+    if (imagemArvore->somaMapa() == disco.somaMapa()) {
+        disco.carregarCompartilhados(imagemArvore->compartilhados());
+        carregarFilhos(raiz);
+        return;
+    }
+    if (!imagemArvore->verificarSoma()) throw runtime_error("Erro: Metadados da imagem corrompidos.");
+    carregarTudo(raiz);
+    imagemArvore.reset();
+    recalcularOcupacao();
+}
+
+void FileSystem::carregarFilhos(RefInode dir) {
+    if (!imagemArvore) return; // Sem imagem (ou toda lida), nada a carregar nem a descarregar
+    inodes.dadosDiretorio(dir).ultimoUso = ++relogioUso;
+    if (!inodes[dir].filhosCarregados) imagemArvore->carregarFilhos(inodes, dir);
+}
+
+void FileSystem::carregarTudo(RefInode dir) {
+    if (!imagemArvore) return;
+    vector<RefInode> pendentes = {dir};
+    while (!pendentes.empty()) {
+        RefInode atual = pendentes.back();
+        pendentes.pop_back();
+        carregarFilhos(atual);
+        for (RefInode filho : inodes.filhos(atual)) {
+            if (inodes[filho].tipo() == DIRECTORY) pendentes.push_back(filho);
+        }
+    }
+}
+
+// Com inodes demais em memória, descarrega os diretórios usados há mais tempo
+// que não têm mudanças (a imagem tem o mesmo conteúdo) e não estão no caminho
+// do diretório atual de s nem no da sessão principal. Os filhos saem da
+// tabela de inodes. Só roda no fim do cd: nenhum outro RefInode está em uso
+// (outras sessões procuram o seu diretório de novo, pelo caminho).
+void FileSystem::descarregarFrios(const Sessao& s) {
+    if (!imagemArvore || inodes.vivos() <= (size_t)LAZY_LOADED_INODES) return;
+    set<RefInode> caminho;
+    for (RefInode atual : {s.diretorio, principal->diretorio}) {
+        for (RefInode p = atual; ; p = inodes[p].pai) {
+            caminho.insert(p);
+            if (p == raiz) break;
+        }
+    }
+    vector<RefInode> candidatos;
+    inodes.paraCada([&](RefInode r, const FCB& f) {
+        if (f.tipo() == DIRECTORY && f.filhosCarregados && !inodes.filhos(r).vazio() && !f.modificado &&
+            f.indiceImagem != UINT32_MAX && !caminho.count(r)) {
+            candidatos.push_back(r);
+        }
+    });
+    sort(candidatos.begin(), candidatos.end(),
+         [&](RefInode a, RefInode b) {
+             return inodes.dadosDiretorio(a).ultimoUso < inodes.dadosDiretorio(b).ultimoUso;
+         });
+
+    size_t alvo = (size_t)LAZY_LOADED_INODES / 4 * 3;
+    bool descarregados = false;
+    for (RefInode dir : candidatos) {
+        if (inodes.vivos() <= alvo) break;
+        // Já saiu junto com um ancestral
+        if (!inodes.valido(dir) || !inodes[dir].filhosCarregados) continue;
+        if (!cacheCaminhos.empty()) esquecerAbaixo(caminhoDe(dir) + '/');
+        for (RefInode filho : inodes.filhos(dir)) inodes.liberarSubarvore(filho);
+        inodes.filhos(dir).limpar();
+        inodes[dir].filhosCarregados = false;
+        descarregados = true;
+    }
+    if (descarregados) mudaramDiretorios();
+}
+
+// Diretórios acima de f passam a ter mudanças que a imagem não tem (só
+// importa enquanto há diretórios a descarregar)
+void FileSystem::marcarModificado(RefInode f) {
+    if (!imagemArvore) return;
+    for (RefInode p = inodes[f].pai; p != INODE_NULO && !inodes[p].modificado; p = inodes[p].pai) {
+        inodes[p].modificado = true;
+    }
+}
+
+void FileSystem::ativarDeduplicacao(bool ativa) {
+    ArvoreExclusiva arvore(*this);
+    disco.ativarDeduplicacao(ativa);
+}
+
+void FileSystem::ativarCompressao(bool ativa) {
+    ArvoreExclusiva arvore(*this);
+    compressao = ativa;
+}
+
+void FileSystem::configurarEmbutidos(size_t limite) {
+    ArvoreExclusiva arvore(*this);
+    limiteEmbutido = limite;
+}
+
+void FileSystem::ativarCacheCaminhos(bool ativo) {
+    ArvoreExclusiva arvore(*this);
+    cacheCaminhosAtivo = ativo;
+    cacheCaminhos.clear();
+}
+
+// Espaço em disco (df): bytes lógicos (soma dos arquivos) vs físicos (blocos
+// ocupados). A diferença vem de blocos compartilhados por cp e deduplicação.
+void FileSystem::df() {
+    ArvoreExclusiva arvore(*this);
+    try {
+        descarregarEscritas();
+    } catch (exception& e) {
+        cout << e.what() << endl;
+        return;
+    }
+    size_t arquivos = 0, bytesLogicos = 0, blocosLogicos = 0;
+    inodes.paraCada([&](RefInode, const FCB& f) {
+        // Diretório ainda na imagem (--lazy): somado sem virar FCBs
+        if (f.tipo() == DIRECTORY && !f.filhosCarregados) {
+            imagemArvore->somarArquivos(f.indiceImagem, arquivos, bytesLogicos, blocosLogicos);
+            return;
+        }
+        if (f.tipo() == DIRECTORY) return;
+        arquivos++;
+        bytesLogicos += f.tamanho;
+        if (!f.embutido) blocosLogicos += totalBlocos(inodes.dadosArquivo(f).extents);
+    });
+
+    size_t tb = disco.obterTamanhoBloco();
+    size_t usados = disco.blocosUsados();
+    size_t total = disco.obterNumBlocos();
+    ostringstream saida; // Escrito de uma vez, como no ls
+    saida << "Blocos: " << total << " x " << tb << " bytes, " << usados << " usados, "
+          << disco.blocosLivres() << " livres (" << (usados * 100 / total) << "%)\n";
+    saida << "Logico: " << bytesLogicos << " bytes em " << arquivos << " arquivos ("
+          << blocosLogicos << " blocos)\n";
+    saida << "Fisico: " << usados * tb << " bytes (" << usados << " blocos)\n";
+    // Bytes, não blocos: assim a razão reflete também a compressão
+    if (usados > 0) {
+        saida << "Razao logico/fisico: " << fixed << setprecision(2)
+              << (double)bytesLogicos / (double)(usados * tb) << "\n";
+    }
+    saida << "Deduplicacao: " << (disco.deduplicacaoAtiva() ? "ativa" : "desligada");
+    if (disco.contarDeduplicados() > 0) saida << " (" << disco.contarDeduplicados() << " blocos deduplicados)";
+    saida << "\n";
+    cout << saida.str();
+}
+
+// Verificação de consistência (fsck): a árvore a partir da raiz (cada inode
+// alcançado uma vez, com o pai e o índice de nomes de acordo, inodeId único e
+// no índice da tabela), o tamanho de cada arquivo contra os seus blocos ou
+// bytes embutidos, e as referências e o mapa de bits de cada bloco contra os
+// extents de todos os arquivos, mais as reservas das escritas adiadas.
+// Diretórios ainda na imagem (--lazy) não são percorridos; enquanto houver
+// algum, as referências dos blocos não são conferidas.
+size_t FileSystem::fsck() {
+    ArvoreExclusiva arvore(*this);
+    size_t problemas = 0;
+    auto relatar = [&](RefInode r, const string& texto) {
+        cout << "fsck: ";
+        if (r != INODE_NULO) cout << (r == raiz ? "/" : caminhoDe(r)) << ": ";
+        cout << texto << "\n";
+        problemas++;
+    };
+    size_t numBlocos = disco.obterNumBlocos();
+    vector<uint32_t> referencias(numBlocos, 0);
+    size_t posicoes = 0;
+    inodes.paraCada([&](RefInode r, const FCB&) { posicoes = r + 1; });
+    vector<uint8_t> alcancado(posicoes, 0);
+    vector<uint8_t> idVisto(nextInodeId.load(), 0);
+    size_t alcancados = 0;
+    bool completo = true;
+
+    vector<RefInode> pendentes = {raiz};
+    while (!pendentes.empty()) {
+        RefInode r = pendentes.back();
+        pendentes.pop_back();
+        if (alcancado[r]++) {
+            relatar(r, "alcancado mais de uma vez");
+            continue;
+        }
+        alcancados++;
+        const FCB& f = inodes[r];
+        if (f.inodeId <= 0 || (size_t)f.inodeId >= idVisto.size()) {
+            relatar(r, "inodeId " + to_string(f.inodeId) + " fora da faixa alocada");
+        } else if (idVisto[f.inodeId]++) {
+            relatar(r, "inodeId " + to_string(f.inodeId) + " repetido");
+        }
+        if (inodes.buscarId(f.inodeId) != r) relatar(r, "fora do indice de inodeId");
+
+        if (f.tipo() == DIRECTORY) {
+            if (!f.filhosCarregados) {
+                completo = false;
+                continue;
+            }
+            for (RefInode filho : inodes.filhos(r)) {
+                if (!inodes.valido(filho)) {
+                    relatar(r, "entrada para a posicao livre " + to_string(filho));
+                    continue;
+                }
+                if (inodes[filho].pai != r) relatar(filho, "pai diferente do diretorio que o contem");
+                if (inodes.filhos(r).buscar(inodes[filho].nome) != filho) relatar(filho, "nome fora do indice do diretorio");
+                pendentes.push_back(filho);
+            }
+            continue;
+        }
+        if (f.adiado != (escritasPendentes.count(r) > 0)) relatar(r, "marca de escrita adiada diferente do mapa");
+        if (f.embutido) {
+            size_t bytes = inodes.conteudoEmbutido(f).size();
+            if (bytes != f.tamanho) {
+                relatar(r, "tamanho " + to_string(f.tamanho) + " com " + to_string(bytes) + " bytes embutidos");
+            }
+            continue;
+        }
+        const DadosArquivo& dados = inodes.dadosArquivo(f);
+        size_t armazenado = f.tamanho;
+        if (f.comprimido) {
+            size_t chunks = (f.tamanho + TAMANHO_CHUNK - 1) / TAMANHO_CHUNK;
+            if (dados.chunks.size() != chunks) {
+                relatar(r, to_string(dados.chunks.size()) + " chunks para " + to_string(f.tamanho) + " bytes");
+            }
+            armazenado = dados.chunks.empty() ? 0 : dados.chunks.back().offset + dados.chunks.back().tamanho;
+        }
+        if (totalBlocos(dados.extents) * disco.obterTamanhoBloco() < armazenado) {
+            relatar(r, to_string(armazenado) + " bytes em " + to_string(totalBlocos(dados.extents)) + " blocos");
+        }
+        for (const Extent& e : dados.extents) {
+            if (e.inicio < 0 || e.comprimento <= 0 || (size_t)e.fim() > numBlocos) {
+                relatar(r, "extent fora do disco");
+                continue;
+            }
+            for (int b = e.inicio; b < e.fim(); b++) referencias[b]++;
+        }
+    }
+
+    if (completo) {
+        if (alcancados != inodes.vivos()) relatar(INODE_NULO, to_string(inodes.vivos() - alcancados) + " inodes fora da arvore");
+        size_t divergentes = 0, primeiro = 0;
+        for (size_t b = 0; b < numBlocos; b++) {
+            if (referencias[b] == disco.contarReferencias((int)b) && disco.blocoOcupado(b) == (referencias[b] > 0)) {
+                continue;
+            }
+            if (divergentes++ == 0) primeiro = b;
+        }
+        if (divergentes > 0) {
+            relatar(INODE_NULO, to_string(divergentes) + " blocos com referencias diferentes dos extents (primeiro: " +
+                                    to_string(primeiro) + ")");
+        }
+    }
+    size_t reservados = 0;
+    for (auto& [ref, escrita] : escritasPendentes) {
+        if (!inodes.valido(ref) || inodes[ref].tipo() == DIRECTORY || inodes[ref].embutido) {
+            relatar(INODE_NULO, "escrita adiada para a posicao " + to_string(ref) + ", que nao e arquivo em blocos");
+        }
+        reservados += escrita.blocosReservados;
+    }
+    if (reservados != disco.blocosReservados()) {
+        relatar(INODE_NULO, "disco com " + to_string(disco.blocosReservados()) + " blocos reservados, escritas adiadas com " +
+                                to_string(reservados));
+    }
+
+    cout << "fsck: " << alcancados << " inodes, " << disco.blocosUsados() << " blocos em uso, " << problemas
+         << " problemas";
+    if (!completo) cout << " (blocos nao conferidos: diretorios ainda na imagem)";
+    cout << "\n";
+    return problemas;
+}
+
+// Memória em uso (meminfo): FCBs e tabelas laterais, índices de diretório,
+// arena de nomes e estruturas do disco. Estimativa pelas capacidades dos
+// contêineres, sem o cabeçalho de cada bloco do malloc.
+void FileSystem::meminfo() {
+    ArvoreExclusiva arvore(*this);
+    size_t tabela = inodes.bytesTabela();
+    size_t arquivos = inodes.bytesArquivos();
+    size_t embutidos = inodes.bytesEmbutidos();
+    size_t diretorios = inodes.bytesDiretorios();
+    size_t indices = inodes.bytesIndices();
+    const ArenaNomes& nomes = inodes.arenaNomes();
+    size_t pendentes = 0;
+    for (auto& [ref, escrita] : escritasPendentes) pendentes += escrita.dados.capacity() + sizeof(escrita);
+    size_t metadadosDisco = disco.bytesMetadados();
+    const CacheBlocos* cache = disco.obterCache();
+    size_t bytesCache = cache ? cache->capacidadeBlocos() * disco.obterTamanhoBloco() : 0;
+    // Cache de caminhos: nó da árvore do map + texto da chave fora do SSO
+    size_t caminhos = 0;
+    for (auto& [chave, entrada] : cacheCaminhos) {
+        caminhos += sizeof(chave) + sizeof(entrada) + 4 * sizeof(void*);
+        if (chave.capacity() > string().capacity()) caminhos += chave.capacity() + 1;
+    }
+    size_t total = tabela + arquivos + embutidos + diretorios + indices + nomes.bytes() + caminhos + pendentes +
+                   metadadosDisco + bytesCache;
+
+    ostringstream saida; // Escrito de uma vez, como no ls
+    saida << "Inodes: " << inodes.vivos() << " (" << inodes.numArquivos() << " arquivos, " << inodes.numDiretorios()
+          << " diretorios; FCB de " << sizeof(FCB) << " bytes)\n";
+    saida << "  Tabela de inodes:     " << tabela << " bytes\n";
+    saida << "  Dados de arquivos:    " << arquivos << " bytes (" << sizeof(DadosArquivo)
+          << " por arquivo + extents e chunks)\n";
+    saida << "  Dados embutidos:      " << embutidos << " bytes (" << inodes.numEmbutidos()
+          << " arquivos de ate " << limiteEmbutido << " bytes)\n";
+    saida << "  Dados de diretorios:  " << diretorios << " bytes (" << sizeof(DadosDiretorio) << " por diretorio)\n";
+    saida << "Indices de diretorio:   " << indices << " bytes\n";
+    saida << "Nomes:                  " << nomes.bytes() << " bytes (" << nomes.nomesDistintos() << " distintos, "
+          << nomes.referencias() << " referencias, " << nomes.bytesTexto() << " de " << nomes.bytesTextoSemInternar()
+          << " bytes de texto)\n";
+    if (cacheCaminhosAtivo) {
+        size_t acertos = 0, faltas = 0;
+        for (const ContagemCaminhos& c : contagensCaminhos) {
+            acertos += c.acertos;
+            faltas += c.faltas;
+        }
+        saida << "Cache de caminhos:      " << caminhos << " bytes (" << cacheCaminhos.size() << " entradas, "
+              << acertos << " acertos, " << faltas << " faltas)\n";
+    }
+    if (pendentes > 0) saida << "Escritas adiadas:       " << pendentes << " bytes\n";
+    saida << "Disco: " << disco.obterNumBlocos() << " blocos x " << disco.obterTamanhoBloco() << " bytes ("
+          << (disco.persistente() ? "na imagem" : "em memoria") << "), " << disco.blocosUsados() * disco.obterTamanhoBloco()
+          << " bytes em " << disco.blocosUsados() << " blocos usados\n";
+    saida << "  Metadados do disco:   " << metadadosDisco << " bytes (mapa de bits, referencias, livres, deduplicacao)\n";
+    if (cache) saida << "  Cache de blocos:      " << bytesCache << " bytes\n";
+    saida << "Total (sem os blocos):  " << total << " bytes";
+    if (inodes.vivos() > 0) saida << " (" << fixed << setprecision(1) << (double)total / inodes.vivos() << " por inode)";
+    saida << "\n";
+    cout << saida.str();
+}
+
+bool FileSystem::lerConteudo(Sessao& s, const string& nome, string& destino) {
+    ArvoreCompartilhada arvore(*this);
+    RefInode ref = resolver(s, nome).alvo;
+    if (ref == INODE_NULO || inodes[ref].tipo() == DIRECTORY || !verificarPermissao(s, inodes[ref], PERM_READ)) {
+        return false;
+    }
+    TravaConteudo trava = travarConteudo(ref);
+    try {
+        destino = lerArquivo(ref, 0, SIZE_MAX);
+    } catch (exception&) {
+        return false;
+    }
+    return true;
+}
+
+RefInode FileSystem::procurar(const string& nome) const {
+    return inodes.filhos(principal->diretorio).buscar(inodes, nome);
+}
+
+RefInode FileSystem::procurar(Sessao& s, const string& nome) {
+    ArvoreCompartilhada arvore(*this);
+    acertarSessao(s);
+    return inodes.filhos(s.diretorio).buscar(inodes, nome);
 }
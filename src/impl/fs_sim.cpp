@@ -1,5 +1,6 @@
 #include <iostream>
 #include <sstream>
+#include <memory>
 #include "../header/constantes.h"
 #include "../header/disco_virtual.h"
 #include "../header/bloco_controle.h"
@@ -8,124 +9,160 @@
 
 using namespace std;
 
-int main() {
-    FileSystem fs;
-    string comando, arg1, arg2;
-    string linha;
 
-    cout << "=== Mini Sistema de Arquivos em Memoria (Simulador) ===\n";
-    cout << "Trabalho M3 - Sistemas Operacionais - UNIVALI\n";
-    cout << "Digite 'help' para ver os comandos disponiveis.\n\n";
+// Converte tamanhos como "4096", "64K", "2G" para bytes (0 se inválido)
+static size_t lerTamanho(const string& texto) {
+    size_t pos = 0;
+    unsigned long long valor;
+    try {
+        valor = stoull(texto, &pos);
+    } catch (exception&) {
+        return 0;
+    }
+    string sufixo = texto.substr(pos);
+    int deslocamento = 0;
+    if (sufixo == "K" || sufixo == "k") deslocamento = 10;
+    else if (sufixo == "M" || sufixo == "m") deslocamento = 20;
+    else if (sufixo == "G" || sufixo == "g") deslocamento = 30;
+    else if (!sufixo.empty()) return 0;
+    // Valor que não cabe num size_t depois do sufixo é inválido (0)
+    if (valor > SIZE_MAX >> deslocamento) return 0;
+    return (size_t)valor << deslocamento;
+}
 
-    while (true) {
-        cout << "user@" << fs.obterCaminho() << "$ ";
-        if (!getline(cin, linha)) break;
-        
-        stringstream ss(linha);
-        ss >> comando;
+// ==========================================
+// PROGRAMA PRINCIPAL (CLI)
+// ==========================================
 
-        if (comando == "exit") break;
-        else if (comando == "help") printHelp();
-        else if (comando == "ls") fs.ls();
-        else if (comando == "whoami") fs.quemSou();
-        else if (comando == "mkdir") {
-            ss >> arg1;
-            if (!arg1.empty()) fs.mkdir(arg1);
+int main(int argc, char* argv[]) {
+    // Geometria do disco: --block-size <bytes>, --blocks <n> ou --disk-size <bytes>
+    // Persistência: --image <arquivo> (imagem mmap no host); --lazy monta a
+    // árvore da imagem sob demanda, diretório por diretório
+    // Deduplicação de blocos por conteúdo: --dedup
+    // Compressão de arquivos texto/numéricos: --compress
+    // Arquivos embutidos: --inline <bytes> (conteúdo até esse tamanho fica no inode; 0 desliga)
+    // Cache de caminhos: --no-dcache resolve todo caminho percorrendo a árvore
+    // Cache de blocos: --cache <lru|arc> [--cache-size <bytes>]; com --image,
+    // a imagem passa a ser acessada com pread/pwrite através do cache
+    // Journal de metadados da imagem: --journal <sync|group|async>
+    size_t tamanhoBloco = BLOCK_SIZE;
+    size_t numBlocos = DISK_SIZE_BLOCKS;
+    size_t tamanhoDisco = 0;
+    string caminhoImagem;
+    bool dedup = false;
+    bool compressao = false;
+    bool sobDemanda = false;
+    bool cacheCaminhos = true;
+    string politicaCache;
+    size_t tamanhoCache = CACHE_SIZE_BYTES;
+    string politicaJournal;
+    size_t limiteEmbutido = INLINE_DATA_BYTES;
+    for (int i = 1; i < argc; i++) {
+        string opcao = argv[i];
+        if (opcao == "--dedup") {
+            dedup = true;
+            continue;
         }
-        else if (comando == "cd") {
-            ss >> arg1;
-            if (!arg1.empty()) fs.cd(arg1);
+        if (opcao == "--compress") {
+            compressao = true;
+            continue;
         }
-        else if (comando == "touch") {
-            ss >> arg1;
-            string tipoStr;
-            ss >> tipoStr;
-            
-            FileType tipo = TYPE_TEXT;
-            if (tipoStr == "num" || tipoStr == "numeric") tipo = TYPE_NUMERIC;
-            else if (tipoStr == "bin" || tipoStr == "binary") tipo = TYPE_BINARY;
-            else if (tipoStr == "prog" || tipoStr == "program") tipo = TYPE_PROGRAM;
-            
-            if (!arg1.empty()) fs.touch(arg1, tipo);
+        if (opcao == "--lazy") {
+            sobDemanda = true;
+            continue;
         }
-        else if (comando == "cat") {
-            ss >> arg1;
-            if (!arg1.empty()) fs.cat(arg1);
+        if (opcao == "--no-dcache") {
+            cacheCaminhos = false;
+            continue;
         }
-        else if (comando == "rm") {
-            ss >> arg1;
-            bool recursivo = false;
-            if (arg1 == "-r" || arg1 == "-rf") {
-                recursivo = true;
-                ss >> arg1;
-            }
-            if (!arg1.empty()) fs.rm(arg1, recursivo);
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
         }
-        else if (comando == "mv") {
-            ss >> arg1 >> arg2;
-            if (!arg1.empty() && !arg2.empty()) fs.mv(arg1, arg2);
+        string argumento = argv[++i];
+        if (opcao == "--image") {
+            caminhoImagem = argumento;
+            continue;
         }
-        else if (comando == "cp") {
-            ss >> arg1 >> arg2;
-            if (!arg1.empty() && !arg2.empty()) fs.cp(arg1, arg2);
+        if (opcao == "--cache") {
+            politicaCache = argumento;
+            continue;
         }
-        else if (comando == "stat") {
-            ss >> arg1;
-            if (!arg1.empty()) fs.stat(arg1);
-        }
-        else if (comando == "exec") {
-            ss >> arg1;
-            if (!arg1.empty()) fs.executar(arg1);
-        }
-        else if (comando == "echo") {
-            ss >> arg1;
-            string conteudo;
-            getline(ss, conteudo);
-            size_t first = conteudo.find_first_not_of(' ');
-            if (string::npos != first) conteudo = conteudo.substr(first);
-            if (!arg1.empty()) fs.echo(arg1, conteudo);
+        if (opcao == "--journal") {
+            politicaJournal = argumento;
+            continue;
         }
-        else if (comando == "chmod") {
-            int perm;
-            ss >> arg1 >> perm;
-            if (!arg1.empty()) fs.chmod(arg1, perm);
+        // 0 é um valor válido aqui (desliga)
+        if (opcao == "--inline") {
+            limiteEmbutido = lerTamanho(argumento);
+            if (limiteEmbutido == 0 && argumento != "0") {
+                cout << "Erro: Valor invalido para " << opcao << ".\n";
+                return 1;
+            }
+            continue;
         }
-        else if (comando == "su") {
-            int uid, gid = -1;
-            ss >> uid;
-            ss >> gid;
-            fs.trocarUsuario(uid, gid);
+        size_t valor = lerTamanho(argumento);
+        if (valor == 0) {
+            cout << "Erro: Valor invalido para " << opcao << ".\n";
+            return 1;
         }
+        if (opcao == "--block-size") tamanhoBloco = valor;
+        else if (opcao == "--blocks") numBlocos = valor;
+        else if (opcao == "--disk-size") tamanhoDisco = valor;
+        else if (opcao == "--cache-size") tamanhoCache = valor;
         else {
-            if (!comando.empty()) cout << "Comando desconhecido. Digite 'help'.\n";
+            printUsage(argv[0]);
+            return 1;
         }
     }
+    if (tamanhoDisco > 0) {
+        numBlocos = tamanhoDisco / tamanhoBloco + (tamanhoDisco % tamanhoBloco != 0);
+    }
 
-    return 0;
-}
-
-#include <iostream>
-#include <sstream>
-#include "../header/constantes.h"
-#include "../header/disco_virtual.h"
-#include "../header/bloco_controle.h"
-#include "../header/sistema_arquivos.h"
-#include "../header/cliente.h"
-
-using namespace std;
-
-
-// ==========================================
-// PROGRAMA PRINCIPAL (CLI)
-// ==========================================
-
-int main() {
-    FileSystem fs;
+    unique_ptr<FileSystem> sistema;
+    try {
+        if (caminhoImagem.empty()) {
+            sistema = make_unique<FileSystem>(tamanhoBloco, numBlocos);
+        } else {
+            sistema = make_unique<FileSystem>(caminhoImagem, tamanhoBloco, numBlocos, politicaCache.empty(),
+                                                   sobDemanda);
+        }
+        if (!politicaCache.empty()) sistema->configurarCache(tamanhoCache, politicaCache);
+    } catch (bad_alloc&) {
+        cout << "Erro: Memoria insuficiente para o disco virtual.\n";
+        return 1;
+    } catch (exception& e) {
+        cout << e.what() << endl;
+        return 1;
+    }
+    FileSystem& fs = *sistema;
+    fs.ativarDeduplicacao(dedup);
+    fs.ativarCompressao(compressao);
+    fs.configurarEmbutidos(limiteEmbutido);
+    fs.ativarCacheCaminhos(cacheCaminhos);
     string comando, arg1, arg2;
     string linha;
 
     cout << "=== Mini Sistema de Arquivos em Memoria (Simulador) ===\n";
     cout << "Trabalho M3 - Sistemas Operacionais - UNIVALI\n";
+    cout << "Disco virtual: " << fs.numBlocos() << " blocos x " << fs.tamanhoBloco() << " bytes";
+    if (!caminhoImagem.empty()) cout << " (imagem: " << caminhoImagem << ")";
+    if (dedup) cout << " [dedup]";
+    if (compressao) cout << " [compress]";
+    if (sobDemanda && !caminhoImagem.empty()) cout << " [lazy]";
+    if (!cacheCaminhos) cout << " [no-dcache]";
+    if (!politicaCache.empty()) cout << " [cache " << politicaCache << ", " << tamanhoCache << " bytes]";
+    if (!politicaJournal.empty()) cout << " [journal " << politicaJournal << "]";
+    cout << "\n";
+    // Recuperação do journal depois do cache configurado (o commit descarrega o cache)
+    if (!politicaJournal.empty()) {
+        try {
+            fs.ativarJournal(politicaJournal);
+        } catch (exception& e) {
+            cout << e.what() << endl;
+            return 1;
+        }
+    }
     cout << "Digite 'help' para ver os comandos disponiveis.\n\n";
 
     while (true) {
@@ -137,8 +174,29 @@ int main() {
 
         if (comando == "exit") break;
         else if (comando == "help") printHelp();
-        else if (comando == "ls") fs.ls();
+        else if (comando == "ls") {
+            string caminho;
+            ss >> caminho;
+            fs.ls(caminho);
+        }
         else if (comando == "whoami") fs.quemSou();
+        else if (comando == "sync") fs.sincronizar();
+        else if (comando == "df") fs.df();
+        else if (comando == "meminfo") fs.meminfo();
+        else if (comando == "fsck") fs.fsck();
+        else if (comando == "cache") fs.estatisticasCache();
+        else if (comando == "journal") fs.estatisticasJournal();
+        else if (comando == "save") {
+            string arquivo;
+            ss >> arquivo;
+            fs.salvar(arquivo);
+        }
+        else if (comando == "load") {
+            string arquivo;
+            ss >> arquivo;
+            if (arquivo.empty()) cout << "Uso: load <arquivo>\n";
+            else fs.carregar(arquivo);
+        }
         else if (comando == "mkdir") {
             ss >> arg1;
             if (!arg1.empty()) fs.mkdir(arg1);
@@ -189,7 +247,12 @@ int main() {
             if (!arg1.empty()) fs.executar(arg1);
         }
         else if (comando == "echo") {
-            ss >> arg1; // arquivo
+            ss >> arg1; // arquivo (ou ">>" para anexar)
+            bool anexar = false;
+            if (arg1 == ">>") {
+                anexar = true;
+                ss >> arg1;
+            }
             
             // Pega o resto da linha como conteudo
             string conteudo;
@@ -199,7 +262,24 @@ int main() {
             size_t first = conteudo.find_first_not_of(' ');
             if (string::npos != first) conteudo = conteudo.substr(first);
             
-            if (!arg1.empty()) fs.echo(arg1, conteudo);
+            if (!arg1.empty()) fs.echo(arg1, conteudo, anexar);
+        }
+        else if (comando == "pwrite") {
+            size_t offset;
+            if (!(ss >> arg1 >> offset)) {
+                cout << "Uso: pwrite <arq> <offset> <conteudo>\n";
+            } else {
+                string conteudo;
+                getline(ss, conteudo);
+                size_t first = conteudo.find_first_not_of(' ');
+                if (string::npos != first) conteudo = conteudo.substr(first);
+                fs.escreverEm(arg1, offset, conteudo);
+            }
+        }
+        else if (comando == "pread") {
+            size_t offset, tamanho;
+            if (!(ss >> arg1 >> offset >> tamanho)) cout << "Uso: pread <arq> <offset> <tamanho>\n";
+            else fs.lerEm(arg1, offset, tamanho);
         }
         else if (comando == "chmod") {
             int perm;
@@ -0,0 +1,122 @@
+// Requisito 3.1: índice hash das entradas de diretório
+#include "../header/indice_diretorio.h"
+#include "../header/tabela_inodes.h"
+#include "../header/hash.h"
+#include <algorithm>
+
+namespace {
+
+const size_t CAPACIDADE_MINIMA = 8;
+
+// Nomes internados são únicos por RefNome: basta espalhar o offset
+size_t posicaoIdeal(RefNome nome, size_t mascara) {
+    return misturar64(nome) & mascara;
+}
+
+} // namespace
+
+RefInode IndiceDiretorio::buscar(const TabelaInodes& inodes, string_view nome) const {
+    if (numEntradas == 0) return INODE_NULO;
+    // Nome que nenhum FCB usa não está em diretório nenhum
+    return buscar(inodes.arenaNomes().buscar(nome));
+}
+
+RefInode IndiceDiretorio::buscar(RefNome nome) const {
+    if (numEntradas == 0 || nome == NOME_NULO) return INODE_NULO;
+    size_t mascara = posicoes.size() - 1;
+    for (size_t i = posicaoIdeal(nome, mascara);; i = (i + 1) & mascara) {
+        const Posicao& p = posicoes[i];
+        if (p.ref == INODE_NULO) return INODE_NULO;
+        if (p.nome == nome) return p.ref;
+    }
+}
+
+bool IndiceDiretorio::inserir(const TabelaInodes& inodes, RefInode ref) {
+    // Carga máxima de 3/4: com sondagem linear as sequências continuam curtas
+    if ((numEntradas + 1) * 4 > posicoes.size() * 3) redimensionar(max(CAPACIDADE_MINIMA, posicoes.size() * 2));
+    RefNome nome = inodes[ref].nome;
+    size_t mascara = posicoes.size() - 1;
+    size_t i = posicaoIdeal(nome, mascara);
+    for (; posicoes[i].ref != INODE_NULO; i = (i + 1) & mascara) {
+        if (posicoes[i].nome == nome) return false;
+    }
+    posicoes[i] = {nome, ref};
+    numEntradas++;
+    ordem.reset();
+    return true;
+}
+
+bool IndiceDiretorio::remover(const TabelaInodes& inodes, RefInode ref) {
+    if (numEntradas == 0) return false;
+    size_t mascara = posicoes.size() - 1;
+    size_t i = posicaoIdeal(inodes[ref].nome, mascara);
+    for (; posicoes[i].ref != ref; i = (i + 1) & mascara) {
+        if (posicoes[i].ref == INODE_NULO) return false;
+    }
+    // Desloca para trás as entradas seguintes que não estão na posição ideal,
+    // para que nenhuma sequência de sondagem fique com buraco
+    for (size_t j = (i + 1) & mascara; posicoes[j].ref != INODE_NULO; j = (j + 1) & mascara) {
+        size_t ideal = posicaoIdeal(posicoes[j].nome, mascara);
+        // ideal fora do intervalo circular (i, j]: a entrada pode ir para i
+        bool podeMover = i <= j ? (ideal <= i || ideal > j) : (ideal <= i && ideal > j);
+        if (podeMover) {
+            posicoes[i] = posicoes[j];
+            i = j;
+        }
+    }
+    posicoes[i].ref = INODE_NULO;
+    numEntradas--;
+    ordem.reset();
+    if (numEntradas == 0) {
+        limpar();
+    } else if (posicoes.size() > CAPACIDADE_MINIMA && numEntradas * 8 < posicoes.size()) {
+        redimensionar(posicoes.size() / 2);
+    }
+    return true;
+}
+
+void IndiceDiretorio::limpar() {
+    vector<Posicao>().swap(posicoes);
+    numEntradas = 0;
+    ordem.reset();
+}
+
+void IndiceDiretorio::reservar(size_t n) {
+    size_t capacidade = CAPACIDADE_MINIMA;
+    while (n * 4 > capacidade * 3) capacidade *= 2;
+    if (capacidade > posicoes.size()) redimensionar(capacidade);
+}
+
+// Reinsere pelo RefNome guardado: não precisa ler os nomes
+void IndiceDiretorio::redimensionar(size_t capacidade) {
+    vector<Posicao> antigas(capacidade, Posicao{NOME_NULO, INODE_NULO});
+    antigas.swap(posicoes);
+    size_t mascara = capacidade - 1;
+    for (const Posicao& p : antigas) {
+        if (p.ref == INODE_NULO) continue;
+        size_t i = posicaoIdeal(p.nome, mascara);
+        while (posicoes[i].ref != INODE_NULO) i = (i + 1) & mascara;
+        posicoes[i] = p;
+    }
+}
+
+const vector<RefInode>& IndiceDiretorio::emOrdem(const TabelaInodes& inodes) {
+    if (!ordem) {
+        // Os nomes vêm da arena (o RefNome está na posição): ordenar não toca nos FCBs
+        const ArenaNomes& nomes = inodes.arenaNomes();
+        vector<pair<string_view, RefInode>> chaves;
+        chaves.reserve(numEntradas);
+        for (const Posicao& p : posicoes) {
+            if (p.ref != INODE_NULO) chaves.emplace_back(nomes.texto(p.nome), p.ref);
+        }
+        sort(chaves.begin(), chaves.end());
+        ordem = make_unique<vector<RefInode>>();
+        ordem->reserve(numEntradas);
+        for (auto& [nome, filho] : chaves) ordem->push_back(filho);
+    }
+    return *ordem;
+}
+
+size_t IndiceDiretorio::bytes() const {
+    return posicoes.capacity() * sizeof(Posicao) + (ordem ? ordem->capacity() * sizeof(RefInode) : 0);
+}
@@ -0,0 +1,463 @@
+// Requisitos 3.1/3.4: journal de metadados com group commit, checkpoint e reprodução
+#include "../header/journal.h"
+#include "../header/constantes.h"
+#include "../header/hash.h"
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+
+const char MAGICO_LOG[8] = {'M', '3', 'F', 'S', 'W', 'A', 'L', '1'};
+const char MAGICO_CHECKPOINT[8] = {'M', '3', 'F', 'S', 'C', 'K', 'P', '2'};
+
+// Byte de flags do REGISTRO_INODE (o bit 0 era o antigo 'comprimido': logs
+// de antes dos arquivos embutidos continuam válidos)
+const uint8_t FLAG_COMPRIMIDO = 1;
+const uint8_t FLAG_EMBUTIDO = 2;
+
+struct CabecalhoLog {
+    char magico[8];
+    uint64_t geracao;
+};
+
+struct CabecalhoCheckpoint {
+    char magico[8];
+    uint64_t geracao;
+    uint64_t tamanho;
+    uint32_t soma;
+    uint32_t reservado;
+};
+
+// Cada transação no log: [tamanho][soma][registros]
+struct CabecalhoQuadro {
+    uint32_t tamanho;
+    uint32_t soma;
+};
+
+// A geração entra na semente: quadros de um log antigo não validam
+uint32_t somaVerificacao(const string& dados, uint64_t geracao) {
+    return (uint32_t)hashDados(dados.data(), dados.size(), geracao);
+}
+
+runtime_error erroSistema(const string& operacao, const string& caminho) {
+    return runtime_error("Erro: " + operacao + " '" + caminho + "': " + strerror(errno));
+}
+
+void escreverTudo(int fd, const char* origem, size_t n, size_t offset, const string& caminho) {
+    while (n > 0) {
+        ssize_t r = pwrite(fd, origem, n, offset);
+        if (r <= 0) throw erroSistema("Escrita no journal", caminho);
+        origem += r;
+        n -= r;
+        offset += r;
+    }
+}
+
+// Conteúdo inteiro de um arquivo aberto
+string lerConteudo(int fd, const string& caminho) {
+    struct stat info;
+    if (fstat(fd, &info) < 0) throw erroSistema("fstat no journal", caminho);
+    string conteudo(info.st_size, '\0');
+    size_t lidos = 0;
+    while (lidos < conteudo.size()) {
+        ssize_t r = pread(fd, &conteudo[lidos], conteudo.size() - lidos, lidos);
+        if (r < 0) throw erroSistema("Leitura do journal", caminho);
+        if (r == 0) break;
+        lidos += r;
+    }
+    conteudo.resize(lidos);
+    return conteudo;
+}
+
+// Sincroniza o diretório que contém caminho (o rename passa a ser durável)
+void sincronizarDiretorio(const string& caminho) {
+    size_t barra = caminho.rfind('/');
+    string diretorio = barra == string::npos ? "." : (barra == 0 ? "/" : caminho.substr(0, barra));
+    int fd = ::open(diretorio.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    ::close(fd);
+}
+
+template <typename T>
+void anexar(string& destino, T valor) {
+    destino.append(reinterpret_cast<const char*>(&valor), sizeof(T));
+}
+
+} // namespace
+
+PoliticaJournal lerPoliticaJournal(const string& nome) {
+    if (nome == "sync") return JOURNAL_SYNC;
+    if (nome == "group") return JOURNAL_GROUP;
+    if (nome == "async") return JOURNAL_ASYNC;
+    throw invalid_argument("Erro: Politica de journal desconhecida '" + nome + "' (use sync, group ou async).");
+}
+
+string nomePoliticaJournal(PoliticaJournal politica) {
+    switch (politica) {
+        case JOURNAL_SYNC: return "sync";
+        case JOURNAL_GROUP: return "group";
+        default: return "async";
+    }
+}
+
+// ==========================================
+// CODIFICAÇÃO DOS REGISTROS
+// ==========================================
+void codificarInode(string& destino, const FCB& f, const DadosArquivo* arquivo, string_view embutido,
+                    string_view nome, int paiId) {
+    anexar<uint8_t>(destino, REGISTRO_INODE);
+    anexar<int32_t>(destino, f.inodeId);
+    anexar<int32_t>(destino, paiId);
+    anexar<uint32_t>(destino, nome.size());
+    destino += nome;
+    anexar<uint8_t>(destino, f.tipo());
+    anexar<int64_t>(destino, f.tamanho);
+    anexar<int32_t>(destino, f.idProprietario);
+    anexar<int32_t>(destino, f.idGrupo);
+    anexar<uint8_t>(destino, f.permProprietario());
+    anexar<uint8_t>(destino, f.permGrupo());
+    anexar<uint8_t>(destino, f.permOutros());
+    anexar<int64_t>(destino, deTempoFS(f.criadoEm));
+    anexar<int64_t>(destino, deTempoFS(f.modificadoEm));
+    anexar<int64_t>(destino, deTempoFS(f.acessadoEm));
+    anexar<uint8_t>(destino, (f.comprimido ? FLAG_COMPRIMIDO : 0) | (f.embutido ? FLAG_EMBUTIDO : 0));
+    static const DadosArquivo semDados;
+    const DadosArquivo& dados = arquivo ? *arquivo : semDados;
+    anexar<uint32_t>(destino, dados.extents.size());
+    for (const Extent& e : dados.extents) {
+        anexar<int32_t>(destino, e.inicio);
+        anexar<int32_t>(destino, e.comprimento);
+    }
+    anexar<uint32_t>(destino, dados.chunks.size());
+    for (const ChunkComprimido& c : dados.chunks) {
+        anexar<uint32_t>(destino, c.offset);
+        anexar<uint32_t>(destino, c.tamanho);
+        anexar<uint8_t>(destino, c.bruto);
+    }
+    if (f.embutido) {
+        anexar<uint32_t>(destino, embutido.size());
+        destino += embutido;
+    }
+}
+
+void codificarRemocao(string& destino, int inodeId) {
+    anexar<uint8_t>(destino, REGISTRO_REMOCAO);
+    anexar<int32_t>(destino, inodeId);
+}
+
+void LeitorRegistros::ler(void* destino, size_t n) {
+    if (n > dados.size() - pos) throw runtime_error("Erro: Registro de journal corrompido.");
+    memcpy(destino, dados.data() + pos, n);
+    pos += n;
+}
+
+TipoRegistro LeitorRegistros::lerTipo() {
+    uint8_t tipo = ler<uint8_t>();
+    if (tipo != REGISTRO_INODE && tipo != REGISTRO_REMOCAO) {
+        throw runtime_error("Erro: Registro de journal corrompido.");
+    }
+    return (TipoRegistro)tipo;
+}
+
+FCB LeitorRegistros::lerInode(int& paiId, string& nome, DadosArquivo& arquivo, string& embutido) {
+    int inodeId = ler<int32_t>();
+    paiId = ler<int32_t>();
+    nome.assign(ler<uint32_t>(), '\0');
+    ler(&nome[0], nome.size());
+    uint8_t tipo = ler<uint8_t>();
+    if (tipo > TYPE_PROGRAM || inodeId <= 0) throw runtime_error("Erro: Registro de journal corrompido.");
+    FCB f(NOME_NULO, (FileType)tipo, 0, 0, 0, 0, 0, INODE_NULO, inodeId);
+    f.tamanho = (uint64_t)ler<int64_t>();
+    f.idProprietario = ler<int32_t>();
+    f.idGrupo = ler<int32_t>();
+    int dono = ler<uint8_t>();
+    int grupo = ler<uint8_t>();
+    f.definirPermissoes(dono, grupo, ler<uint8_t>());
+    f.criadoEm = paraTempoFS((time_t)ler<int64_t>());
+    f.modificadoEm = paraTempoFS((time_t)ler<int64_t>());
+    f.acessadoEm = paraTempoFS((time_t)ler<int64_t>());
+    uint8_t flags = ler<uint8_t>();
+    f.comprimido = (flags & FLAG_COMPRIMIDO) != 0;
+    f.embutido = (flags & FLAG_EMBUTIDO) != 0 && tipo != DIRECTORY;
+    // Contagens são limitadas pelos bytes restantes antes de reservar memória
+    uint32_t numExtents = ler<uint32_t>();
+    if (numExtents > (dados.size() - pos) / 8) throw runtime_error("Erro: Registro de journal corrompido.");
+    arquivo.extents.resize(numExtents);
+    for (Extent& e : arquivo.extents) {
+        e.inicio = ler<int32_t>();
+        e.comprimento = ler<int32_t>();
+    }
+    uint32_t numChunks = ler<uint32_t>();
+    if (numChunks > (dados.size() - pos) / 9) throw runtime_error("Erro: Registro de journal corrompido.");
+    arquivo.chunks.resize(numChunks);
+    for (ChunkComprimido& c : arquivo.chunks) {
+        c.offset = ler<uint32_t>();
+        c.tamanho = ler<uint32_t>();
+        c.bruto = ler<uint8_t>() != 0;
+    }
+    if (flags & FLAG_EMBUTIDO) {
+        uint32_t n = ler<uint32_t>();
+        if (n != f.tamanho || n > dados.size() - pos) throw runtime_error("Erro: Registro de journal corrompido.");
+        embutido.assign(n, '\0');
+        ler(&embutido[0], n);
+    }
+    return f;
+}
+
+int LeitorRegistros::lerRemocao() {
+    return ler<int32_t>();
+}
+
+// ==========================================
+// JOURNAL
+// ==========================================
+Journal::Journal(const string& caminhoImagem, PoliticaJournal p, function<void()> antes)
+    : caminhoLog(caminhoImagem + ".wal"), caminhoCheckpoint(caminhoImagem + ".ckpt"),
+      politica(p), antesDeGravar(move(antes)) {
+    // Geração do checkpoint atual (0 = nenhum)
+    int c = ::open(caminhoCheckpoint.c_str(), O_RDONLY);
+    if (c >= 0) {
+        CabecalhoCheckpoint cab;
+        if (pread(c, &cab, sizeof(cab), 0) == (ssize_t)sizeof(cab) &&
+            memcmp(cab.magico, MAGICO_CHECKPOINT, sizeof(MAGICO_CHECKPOINT)) == 0) {
+            geracao = cab.geracao;
+        }
+        ::close(c);
+    }
+    fd = ::open(caminhoLog.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) throw erroSistema("Nao foi possivel abrir o journal", caminhoLog);
+    struct stat info;
+    if (fstat(fd, &info) == 0) estatisticasAtuais.bytesLog = info.st_size;
+    if (politica != JOURNAL_SYNC) comprometedor = thread(&Journal::executarComprometedor, this);
+}
+
+Journal::~Journal() {
+    {
+        lock_guard<mutex> guarda(trava);
+        parar = true;
+    }
+    sinal.notify_all();
+    if (comprometedor.joinable()) comprometedor.join();
+    try {
+        unique_lock<mutex> guarda(trava);
+        gravarGrupo(guarda);
+    } catch (exception&) {
+        // Destrutor não propaga erros de I/O
+    }
+    if (fd >= 0) ::close(fd);
+}
+
+// Log vazio da geração atual
+void Journal::gravarCabecalhoLog() {
+    CabecalhoLog cab;
+    memcpy(cab.magico, MAGICO_LOG, sizeof(MAGICO_LOG));
+    cab.geracao = geracao;
+    if (ftruncate(fd, 0) < 0) throw erroSistema("Nao foi possivel truncar o journal", caminhoLog);
+    escreverTudo(fd, reinterpret_cast<const char*>(&cab), sizeof(cab), 0, caminhoLog);
+    if (fdatasync(fd) < 0) throw erroSistema("fdatasync do journal", caminhoLog);
+    estatisticasAtuais.bytesLog = sizeof(cab);
+}
+
+bool Journal::carregarCheckpoint(string& arvore) {
+    int c = ::open(caminhoCheckpoint.c_str(), O_RDONLY);
+    if (c < 0) return false;
+    string conteudo;
+    try {
+        conteudo = lerConteudo(c, caminhoCheckpoint);
+    } catch (...) {
+        ::close(c);
+        throw;
+    }
+    ::close(c);
+    CabecalhoCheckpoint cab;
+    if (conteudo.size() < sizeof(cab)) throw runtime_error("Erro: Checkpoint do journal corrompido.");
+    memcpy(&cab, conteudo.data(), sizeof(cab));
+    if (memcmp(cab.magico, MAGICO_CHECKPOINT, sizeof(MAGICO_CHECKPOINT)) != 0 ||
+        cab.tamanho != conteudo.size() - sizeof(cab)) {
+        throw runtime_error("Erro: Checkpoint do journal corrompido.");
+    }
+    arvore = conteudo.substr(sizeof(cab));
+    if (somaVerificacao(arvore, cab.geracao) != cab.soma) {
+        throw runtime_error("Erro: Checkpoint do journal corrompido.");
+    }
+    return true;
+}
+
+size_t Journal::reproduzir(const function<void(const string&)>& aplicar) {
+    lock_guard<mutex> guarda(trava);
+    string conteudo = lerConteudo(fd, caminhoLog);
+    CabecalhoLog cab;
+    bool valido = conteudo.size() >= sizeof(cab);
+    if (valido) {
+        memcpy(&cab, conteudo.data(), sizeof(cab));
+        valido = memcmp(cab.magico, MAGICO_LOG, sizeof(MAGICO_LOG)) == 0 && cab.geracao == geracao;
+    }
+    if (!valido) {
+        // Log vazio ou de outro checkpoint: nada a reaplicar
+        gravarCabecalhoLog();
+        return 0;
+    }
+    size_t pos = sizeof(cab);
+    size_t aplicadas = 0;
+    while (conteudo.size() - pos >= sizeof(CabecalhoQuadro)) {
+        CabecalhoQuadro quadro;
+        memcpy(&quadro, conteudo.data() + pos, sizeof(quadro));
+        if (quadro.tamanho > conteudo.size() - pos - sizeof(quadro)) break;
+        string transacao = conteudo.substr(pos + sizeof(quadro), quadro.tamanho);
+        if (somaVerificacao(transacao, geracao) != quadro.soma) break;
+        aplicar(transacao);
+        aplicadas++;
+        pos += sizeof(quadro) + quadro.tamanho;
+    }
+    // Cauda inválida (escrita interrompida): as próximas transações entram no lugar dela
+    if (pos < conteudo.size() && ftruncate(fd, pos) < 0) {
+        throw erroSistema("Nao foi possivel truncar o journal", caminhoLog);
+    }
+    estatisticasAtuais.bytesLog = pos;
+    return aplicadas;
+}
+
+void Journal::descartar() {
+    lock_guard<mutex> guarda(trava);
+    unlink(caminhoCheckpoint.c_str());
+    geracao = 0;
+    grupo.clear();
+    transacoesNoGrupo = 0;
+    gravarCabecalhoLog();
+}
+
+void Journal::registrar(const string& transacao) {
+    unique_lock<mutex> guarda(trava);
+    if (!erro.empty()) {
+        string mensagem = move(erro);
+        erro.clear();
+        throw runtime_error(mensagem);
+    }
+    CabecalhoQuadro quadro{(uint32_t)transacao.size(), somaVerificacao(transacao, geracao)};
+    anexar(grupo, quadro);
+    grupo += transacao;
+    transacoesNoGrupo++;
+    estatisticasAtuais.transacoes++;
+    if (politica == JOURNAL_SYNC) {
+        gravarGrupo(guarda);
+        return;
+    }
+    // Primeira transação abre a janela do grupo; grupo cheio é gravado já
+    if (transacoesNoGrupo == 1 || transacoesNoGrupo >= (size_t)JOURNAL_GROUP_OPS) sinal.notify_one();
+}
+
+// Chamado com a trava adquirida. Grava o grupo aberto numa escrita só; a trava
+// é solta durante o I/O, então novas transações já entram no próximo grupo.
+void Journal::gravarGrupo(unique_lock<mutex>& guarda) {
+    gravado.wait(guarda, [&] { return !gravando; });
+    if (grupo.empty()) return;
+    string lote = move(grupo);
+    grupo.clear();
+    transacoesNoGrupo = 0;
+    size_t offset = estatisticasAtuais.bytesLog;
+    gravando = true;
+    guarda.unlock();
+    try {
+        if (antesDeGravar) antesDeGravar();
+        escreverTudo(fd, lote.data(), lote.size(), offset, caminhoLog);
+        if (politica != JOURNAL_ASYNC && fdatasync(fd) < 0) throw erroSistema("fdatasync do journal", caminhoLog);
+    } catch (...) {
+        // O lote volta para a frente do grupo: a próxima gravação reescreve no mesmo offset
+        guarda.lock();
+        grupo = lote + grupo;
+        gravando = false;
+        gravado.notify_all();
+        throw;
+    }
+    guarda.lock();
+    estatisticasAtuais.bytesLog = offset + lote.size();
+    estatisticasAtuais.grupos++;
+    if (politica != JOURNAL_ASYNC) estatisticasAtuais.sincronizacoes++;
+    gravando = false;
+    gravado.notify_all();
+}
+
+// Thread de commit (GROUP/ASYNC): espera a primeira transação de um grupo, dá
+// JOURNAL_GROUP_MS para outras chegarem (ou até o grupo encher) e grava tudo junto
+void Journal::executarComprometedor() {
+    unique_lock<mutex> guarda(trava);
+    while (true) {
+        sinal.wait(guarda, [&] { return parar || !grupo.empty(); });
+        if (parar) return;
+        sinal.wait_for(guarda, chrono::milliseconds(JOURNAL_GROUP_MS),
+                       [&] { return parar || transacoesNoGrupo >= (size_t)JOURNAL_GROUP_OPS; });
+        try {
+            gravarGrupo(guarda);
+        } catch (exception& e) {
+            // O grupo continua pendente; quem registrar a próxima transação vê o erro
+            erro = e.what();
+            sinal.wait_for(guarda, chrono::milliseconds(JOURNAL_GROUP_MS), [&] { return parar; });
+        }
+    }
+}
+
+void Journal::comprometer() {
+    unique_lock<mutex> guarda(trava);
+    if (!erro.empty()) {
+        string mensagem = move(erro);
+        erro.clear();
+        throw runtime_error(mensagem);
+    }
+    gravarGrupo(guarda);
+    if (politica == JOURNAL_ASYNC) {
+        if (fdatasync(fd) < 0) throw erroSistema("fdatasync do journal", caminhoLog);
+        estatisticasAtuais.sincronizacoes++;
+    }
+}
+
+// O checkpoint vai para um arquivo temporário e substitui o anterior com
+// rename (atômico): uma queda no meio deixa o checkpoint antigo e o log intacto
+void Journal::checkpoint(const string& arvore) {
+    unique_lock<mutex> guarda(trava);
+    gravado.wait(guarda, [&] { return !gravando; });
+    uint64_t nova = geracao + 1;
+    CabecalhoCheckpoint cab;
+    memcpy(cab.magico, MAGICO_CHECKPOINT, sizeof(MAGICO_CHECKPOINT));
+    cab.geracao = nova;
+    cab.tamanho = arvore.size();
+    cab.soma = somaVerificacao(arvore, nova);
+    cab.reservado = 0;
+
+    string temporario = caminhoCheckpoint + ".tmp";
+    int c = ::open(temporario.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (c < 0) throw erroSistema("Nao foi possivel criar o checkpoint", temporario);
+    try {
+        escreverTudo(c, reinterpret_cast<const char*>(&cab), sizeof(cab), 0, temporario);
+        escreverTudo(c, arvore.data(), arvore.size(), sizeof(cab), temporario);
+        if (fsync(c) < 0) throw erroSistema("fsync do checkpoint", temporario);
+    } catch (...) {
+        ::close(c);
+        unlink(temporario.c_str());
+        throw;
+    }
+    ::close(c);
+    if (rename(temporario.c_str(), caminhoCheckpoint.c_str()) < 0) {
+        throw erroSistema("Nao foi possivel gravar o checkpoint", caminhoCheckpoint);
+    }
+    sincronizarDiretorio(caminhoCheckpoint);
+
+    // O checkpoint contém tudo o que foi registrado: o grupo aberto é descartado
+    geracao = nova;
+    grupo.clear();
+    transacoesNoGrupo = 0;
+    gravarCabecalhoLog();
+    estatisticasAtuais.checkpoints++;
+}
+
+EstatisticasJournal Journal::estatisticas() const {
+    lock_guard<mutex> guarda(trava);
+    return estatisticasAtuais;
+}
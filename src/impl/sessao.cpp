@@ -0,0 +1,31 @@
+// Requisitos 3.1/3.3: sessão de um cliente sobre um FileSystem compartilhado
+#include "../header/sessao.h"
+#include "../header/sistema_arquivos.h"
+
+using namespace std;
+
+Sessao::Sessao(FileSystem& fs, int uid, int gid) : fs(fs), usuario(uid), grupo(gid) {
+    fs.abrirSessao(*this);
+}
+
+// Os comandos são os do FileSystem, com o usuário e o diretório desta sessão
+void Sessao::mkdir(const string& nome) { fs.mkdir(*this, nome); }
+void Sessao::cd(const string& nome) { fs.cd(*this, nome); }
+void Sessao::touch(const string& nome, FileType tipo) { fs.touch(*this, nome, tipo); }
+void Sessao::echo(const string& nome, const string& conteudo, bool anexar) { fs.echo(*this, nome, conteudo, anexar); }
+void Sessao::cat(const string& nome) { fs.cat(*this, nome); }
+void Sessao::escreverEm(const string& nome, size_t offset, const string& conteudo) {
+    fs.escreverEm(*this, nome, offset, conteudo);
+}
+void Sessao::lerEm(const string& nome, size_t offset, size_t tamanho) { fs.lerEm(*this, nome, offset, tamanho); }
+void Sessao::ls(const string& nome) { fs.ls(*this, nome); }
+void Sessao::chmod(const string& nome, int permOctal) { fs.chmod(*this, nome, permOctal); }
+void Sessao::rm(const string& nome, bool recursivo) { fs.rm(*this, nome, recursivo); }
+void Sessao::mv(const string& nomeAntigo, const string& nomeNovo) { fs.mv(*this, nomeAntigo, nomeNovo); }
+void Sessao::cp(const string& nomeOrigem, const string& nomeDestino) { fs.cp(*this, nomeOrigem, nomeDestino); }
+void Sessao::stat(const string& nome) { fs.stat(*this, nome); }
+void Sessao::executar(const string& nome) { fs.executar(*this, nome); }
+void Sessao::trocarUsuario(int uid, int gid) { fs.trocarUsuario(*this, uid, gid); }
+void Sessao::quemSou() { fs.quemSou(*this); }
+bool Sessao::lerConteudo(const string& nome, string& destino) { return fs.lerConteudo(*this, nome, destino); }
+RefInode Sessao::procurar(const string& nome) { return fs.procurar(*this, nome); }